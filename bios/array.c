@@ -51,7 +51,7 @@ static char* mallocErrorMsg = "array: malloc/realloc/calloc failed." ;
 static int nArrays = 0 ;
 
 
-Array uArrayCreate(int n, int size)
+Array uArrayCreate(int64_t n, int size)
 { 
   Array new = (Array) malloc(sizeof(struct ArrayStruct)) ;
 
@@ -73,31 +73,33 @@ Array uArrayCreate(int n, int size)
 
 
 
-static void arrayExtend (Array a, int n)
+/* grow geometrically: doubling for small arrays, by half beyond
+   1M elements, so that appending n elements costs O(n) copies
+   without overcommitting huge arrays
+*/
+static void arrayExtend (Array a, int64_t n)
 {
   char *new ;
-  int oldsize, newsize ;
+  int64_t oldsize, newsize ;
 
   if (!a || n < a->dim)
     return ;
 
-  if (a->dim < 1 << 20)  /* 1 megabyte */
+  if (a->dim < 1 << 20)
     a->dim *= 2 ;
   else
-    a->dim += 1 << 20 ;
+    a->dim += a->dim >> 1 ;
   if (n >= a->dim)
     a->dim = n + 1 ;
 
   newsize = a->dim * a->size ;
   oldsize = a->size*a->max ;
-  if (newsize <= oldsize) 
-    die("arrayExtend: oldsize %d, newsize %d", oldsize, newsize) ;
-  new = malloc(newsize) ;
+  if (newsize <= oldsize || newsize / a->size != a->dim || (size_t)newsize != newsize) 
+    die("arrayExtend: oldsize %lld, newsize %lld", (long long)oldsize, (long long)newsize) ;
+  new = realloc(a->base, newsize) ;
   if (!new)
     die(mallocErrorMsg) ;
-  memcpy(new, a->base, oldsize) ;
   memset(new+oldsize, 0, newsize-oldsize) ;
-  free(a->base) ;
   a->base = new ;
 }
 
@@ -135,7 +137,7 @@ int arrayNumber(void)
 
 
 
-char *uArray(Array a, int i) 
+char *uArray(Array a, int64_t i) 
 {
   if (i >= a->max) { 
     if (i >= a->dim)
@@ -147,21 +149,21 @@ char *uArray(Array a, int i)
 
 
 
-char *uArrayCheck(Array a, int i)
+char *uArrayCheck(Array a, int64_t i)
 {
   if (i < 0)
-    die ("array: referencing array element %d < 0", i) ;
+    die ("array: referencing array element %lld < 0", (long long)i) ;
 
   return uArray(a, i) ;
 }
 
 
 
-char *uArrCheck(Array a, int i)
+char *uArrCheck(Array a, int64_t i)
 {
   if (i >= a->max || i < 0)
-    die ("array index %d out of bounds [0,%d]",
-	       i, a->max - 1) ;
+    die ("array index %lld out of bounds [0,%lld]",
+	       (long long)i, (long long)(a->max - 1)) ;
   return a->base + i*a->size ;
 }
 
@@ -169,7 +171,7 @@ char *uArrCheck(Array a, int i)
 
 char *uArrPop(Array a)
 {
-  int i = --a->max ;
+  int64_t i = --a->max ;
   if (i < 0)
     die ("stackPop: empty stack") ;
   return a->base + i*a->size ;
@@ -206,22 +208,22 @@ Array arrayCopy(Array a)
  */
 void arrayMove(Array from, int start, int end, Array to) 
 { 
-  int i ;
-  int mf ; /* number of elements in 'from' */
-  int n ;  /* number of elements to move */
-  int nb ; /* number of bytes to move from 'from' to 'to' */
-  int mb ; /* number of bytes to move down within 'from' */
+  int64_t i ;
+  int64_t mf ; /* number of elements in 'from' */
+  int64_t n ;  /* number of elements to move */
+  int64_t nb ; /* number of bytes to move from 'from' to 'to' */
+  int64_t mb ; /* number of bytes to move down within 'from' */
   char *fromp ; /* pointer to start position in 'from' */
   char *fromp2 ; /* beginning of area to shift in 'from' */
   char *fromp3 ; /* beginning of area to clear in 'from' */
   char *top ;   /* pointer to target position in 'to' */
 
   if (!from || start < 0 || end >= arrayMax(from) || start > end)
-    die("arrayMove: max=%d start=%d end=%d",
-        from ? arrayMax(from) : -1, start, end) ;
+    die("arrayMove: max=%lld start=%d end=%d",
+        from ? (long long)arrayMax(from) : -1LL, start, end) ;
   if (to && to->size != from->size)
-    die("arrayMove: size mismatch %d/%d",
-        from->size, to->size) ;
+    die("arrayMove: size mismatch %lld/%lld",
+        (long long)from->size, (long long)to->size) ;
   if (to == from)
     die("arrayMove: from and to are the same.") ;
 
@@ -230,7 +232,7 @@ void arrayMove(Array from, int start, int end, Array to)
   nb = n * from->size ; /* number of bytes to move and set to zero */
   fromp = from->base + start*from->size ;
   if (to) {
-    int mt = arrayMax(to) ;  /* number of elements in 'to' */
+    int64_t mt = arrayMax(to) ;  /* number of elements in 'to' */
     uArray(to, mt + n - 1) ; /* allocate target space */
     top = to->base + mt*to->size ;
     memcpy(top, fromp, nb) ;
@@ -258,7 +260,7 @@ void arrayMove(Array from, int start, int end, Array to)
  */
 void arrayByteUniq(Array a)
 { 
-  int i, j, k , as ;
+  int64_t i, j, k , as ;
   char *x, *y, *ab  ;
   
   if (!a || !a->size || arrayMax(a) < 2 )
@@ -295,7 +297,7 @@ void arrayByteUniq(Array a)
  */
 void arrayUniq(Array a, Array b, int (*order)(void*,void*))
 { 
-  int i, j, k;
+  int64_t i, j, k;
   char *to ; 
   char *from ;
   char *r ;
@@ -340,8 +342,8 @@ void arrayUniq(Array a, Array b, int (*order)(void*,void*))
  */
 void arraySort (Array a, int (*order)(void*,void*))
 {
-  unsigned int n = a->max,
-               s = a->size ;
+  size_t n = a->max,
+         s = a->size ;
   void *v = a->base ;
 
   if (n > 1) 
@@ -358,6 +360,80 @@ void arraySort (Array a, int (*order)(void*,void*))
 
 
 
+/* element key and position, sorted by arraySortByKey64() */
+typedef struct
+{ uint64_t key ;
+  int64_t  index ;
+} ArrayKeyIndex ;
+
+
+
+/**
+ * Sort an Array a in ascending order of the unsigned 64-bit key 
+ * computed by key() for each element. 
+ * This is an LSD radix sort: key() is called once per element, no 
+ * comparison function is needed and the running time is linear in 
+ * the number of elements. Byte positions that are equal in all keys 
+ * are skipped. 
+ * The sort is stable, so several keys can be sorted on by sorting 
+ * on the least significant one first.
+ * @note Signed values must have their sign bit flipped to sort correctly, 
+   e.g. (uint32_t)x ^ 0x80000000
+ */
+void arraySortByKey64 (Array a, uint64_t (*key)(void*))
+{
+  int64_t n = a->max ;
+  int64_t count[256] ;
+  int64_t i, sum, c ;
+  ArrayKeyIndex *items, *other, *swap ;
+  uint64_t diff ;
+  int shift ;
+  char *sorted ;
+
+  if (n < 2)
+    return ;
+  items = malloc(n * sizeof(ArrayKeyIndex)) ;
+  other = malloc(n * sizeof(ArrayKeyIndex)) ;
+  if (!items || !other)
+    die(mallocErrorMsg) ;
+  diff = 0 ;
+  for (i = 0 ; i < n ; i++) {
+    items[i].key = key(a->base + i*a->size) ;
+    items[i].index = i ;
+    diff |= items[i].key ^ items[0].key ;
+  }
+  for (shift = 0 ; shift < 64 ; shift += 8) {
+    if (((diff >> shift) & 0xff) == 0)
+      continue ; /* all keys share this byte */
+    memset(count, 0, sizeof(count)) ;
+    for (i = 0 ; i < n ; i++)
+      count[(items[i].key >> shift) & 0xff]++ ;
+    sum = 0 ;
+    for (i = 0 ; i < 256 ; i++) {
+      c = count[i] ;
+      count[i] = sum ;
+      sum += c ;
+    }
+    for (i = 0 ; i < n ; i++)
+      other[count[(items[i].key >> shift) & 0xff]++] = items[i] ;
+    swap = items ;
+    items = other ;
+    other = swap ;
+  }
+  free(other) ;
+  /* sort in place like arraySort(): pointers to elements stay valid */
+  sorted = malloc(n * a->size) ;
+  if (!sorted)
+    die(mallocErrorMsg) ;
+  for (i = 0 ; i < n ; i++)
+    memcpy(sorted + i*a->size, a->base + items[i].index*a->size, a->size) ;
+  memcpy(a->base, sorted, n * a->size) ;
+  free(sorted) ;
+  free(items) ;
+}
+
+
+
 /**
  * Check if s is an entry in a.
  * @return TRUE if arru(a,i,) matches *s, else FALSE
@@ -449,7 +525,7 @@ int arrayRemove (Array a, void * s, int (* order)(void*,void*))
        * and memcpy is said to fail with some compilers
        */
       char *cp = uArray(a,i),  *cq = cp + a->size ;
-      int j = (arrayMax(a) - i)*(a->size) ;
+      int64_t j = (arrayMax(a) - i)*(a->size) ;
       while(j--)
 	*cp++ = *cq++;
 
@@ -472,7 +548,7 @@ int arrayRemoveD (Array a, int i)
      * and memcpy is said to fail with some compilers
      */
     char *cp = uArray(a,i),  *cq = cp + a->size ;
-    int j = (arrayMax(a) - i)*(a->size) ;
+    int64_t j = (arrayMax(a) - i)*(a->size) ;
     while(j--)
       *cp++ = *cq++;
 
@@ -493,7 +569,8 @@ int arrayRemoveD (Array a, int i)
 */
 int arrayFindInsert(Array a, void * s, int *ip, int (*order)(void*,void*)) 
 {
-  int i, j, k ;
+  int i ;
+  int64_t j, k ;
   int *ip2 = ip ? ip : &i ;
   char *cp, *cq ;
 
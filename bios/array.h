@@ -41,6 +41,8 @@
 
 #ifndef DEF_ARRAY_H
 #define DEF_ARRAY_H
+
+#include <stdint.h>
  
 /* #define ARRAY_CHECK either here or in a single file to
    check the bounds on arru() and arrp() calls
@@ -54,21 +56,21 @@
  * Array.
  */
 typedef struct ArrayStruct
-{ char* base ;    // char* since need to do pointer arithmetic in bytes 
-  int   dim ;     // length of alloc'ed space 
-  int   size ;
-  int   max ;     // largest element accessed via array() -1 
+{ char*   base ;  // char* since need to do pointer arithmetic in bytes 
+  int64_t dim ;   // length of alloc'ed space 
+  int64_t size ;  // 64 bits, so that byte offsets i*size cannot overflow
+  int64_t max ;   // largest element accessed via array() -1 
 } *Array ;
  
 /* NB we need the full definition for arru() for macros to work
    do not use it in user programs - it is private.
 */
 
-extern Array   uArrayCreate (int n, int size) ;
+extern Array   uArrayCreate (int64_t n, int size) ;
 extern void    uArrayDestroy (Array a) ;
-extern char    *uArray (Array a, int index) ;
-extern char    *uArrCheck (Array a, int index) ;
-extern char    *uArrayCheck (Array a, int index) ;
+extern char    *uArray (Array a, int64_t index) ;
+extern char    *uArrCheck (Array a, int64_t index) ;
+extern char    *uArrayCheck (Array a, int64_t index) ;
 extern char    *uArrPop(Array a) ;
 
 /**
@@ -82,7 +84,8 @@ extern char    *uArrPop(Array a) ;
 #define arrayDestroy(a)		((a) ? uArrayDestroy(a), a=NULL, 1 : 0)
 
 /**
- * Return the number of elements in the array.
+ * Return the number of elements in the array (int64_t).
+ * @note Indices beyond 2^31 need int64_t loop variables; arrayFind() and friends use int indices.
  */
 #define arrayMax(ar)   ((ar)->max)
 
@@ -113,11 +116,13 @@ extern int arrayNumber(void) ;
 
 /* JTM's package to hold sorted arrays of ANY TYPE, extended by Roche */
 #define ARRAYORDERF int(*)(void *,void *)
+#define ARRAYKEYF uint64_t(*)(void *)
 #define arrayInsert(a,elem,order) arrayFindInsert(a,elem,NULL,order) 
 extern int     arrayFindInsert(Array a, void *s, int *ip, int (*order)(void*,void*));
 extern int     arrayRemove(Array a, void * s, int (*order)(void*,void*));
 extern int     arrayRemoveD(Array a,int i);
 extern void    arraySort(Array a, int (*order)(void*,void*)) ;
+extern void    arraySortByKey64(Array a, uint64_t (*key)(void*)) ;
 extern int     arrayFind(Array a, void *s, int *ip, int (*order)(void*,void*));
 extern int     arrayIsEntry(Array a, int i, void *s);
 extern int     arrayStrcmp(char **s1, char **s2) ; 
@@ -13,6 +13,7 @@
 
 
 static LineStream ls = NULL;
+static Arena arena = NULL;
 
 
 
@@ -51,27 +52,56 @@ void bgrParser_deInit (void)
 
 
 /**
- * Retrieve the next entry in the bedGraph file.
+ * Make the parser allocate the chromosome names of the entries in an arena instead of individually on the heap.
+ * @param[in] callerArena Arena supplied by the caller, who owns it. NULL restores individual allocation.
+ * @note While an arena is set, bgrParser_freeBedGraphs() leaves the chromosome names to the arena.
  */
-BedGraph* bgrParser_nextEntry (void)
+void bgrParser_setArena (Arena callerArena)
+{
+  arena = callerArena;
+}
+
+
+
+/**
+ * Read the next data line into a BedGraph, skipping track lines.
+ * @return 1 if an entry was read, 0 at the end of the input
+ */
+static int bgrParser_readEntry (BedGraph *currBedGraph)
 {
   char *line;
-  static BedGraph *currBedGraph = NULL;
   WordIter w;
-  line = ls_nextLine (ls);
-  if ( !(ls_isEof( ls ) ) ) {	 
-    if ( !strStartsWithC (line,"track") ) {
-      AllocVar( currBedGraph );
-      w = wordIterCreate (line,"\t",1);
-      currBedGraph->chromosome = hlr_strdup (wordNext (w));
-      currBedGraph->start = atoi (wordNext (w));
-      currBedGraph->end = atoi (wordNext (w));
-      currBedGraph->value = atof (wordNext (w));
-      wordIterDestroy (w);
-    } else {
-      bgrParser_nextEntry ( );
+
+  while (line = ls_nextLine (ls)) {
+    if (!strStartsWithC (line,"track")) {
+      break;
     }
-  } else {
+  }
+  if (line == NULL) {
+    return 0;
+  }
+  w = wordIterCreate (line,"\t",1);
+  currBedGraph->chromosome = arena != NULL ? arena_strdup (arena,wordNext (w)) : hlr_strdup (wordNext (w));
+  currBedGraph->start = atoi (wordNext (w));
+  currBedGraph->end = atoi (wordNext (w));
+  currBedGraph->value = atof (wordNext (w));
+  wordIterDestroy (w);
+  return 1;
+}
+
+
+
+/**
+ * Retrieve the next entry in the bedGraph file.
+ * @return The entry, which belongs to the user, or NULL at the end of the input
+ */
+BedGraph* bgrParser_nextEntry (void)
+{
+  BedGraph *currBedGraph;
+
+  AllocVar (currBedGraph);
+  if (!bgrParser_readEntry (currBedGraph)) {
+    freeMem (currBedGraph);
     return NULL;
   }
   return currBedGraph;
@@ -85,14 +115,11 @@ BedGraph* bgrParser_nextEntry (void)
 Array bgrParser_getAllEntries ( void ) 
 {
   Array bedGraphs;
-  BedGraph *currBedGraph;
+  BedGraph currBedGraph;
   
   bedGraphs = arrayCreate (1000000, BedGraph);
-  int i=0;
-  while (currBedGraph = bgrParser_nextEntry () ) {
-    array(bedGraphs, arrayMax (bedGraphs),BedGraph) = *currBedGraph;
-    freeMem ( currBedGraph );
-    i++;
+  while (bgrParser_readEntry (&currBedGraph)) {
+    array (bedGraphs,arrayMax (bedGraphs),BedGraph) = currBedGraph;
   }
   return bedGraphs;
 }
@@ -127,9 +154,11 @@ void bgrParser_freeBedGraphs (Array bedGraphs)
   BedGraph *currBedGraph;
   int i;
   
-  for (i = 0; i < arrayMax (bedGraphs); i++) {
-    currBedGraph = arrp (bedGraphs,i,BedGraph);
-    hlr_free (currBedGraph->chromosome);
+  if (arena == NULL) {
+    for (i = 0; i < arrayMax (bedGraphs); i++) {
+      currBedGraph = arrp (bedGraphs,i,BedGraph);
+      hlr_free (currBedGraph->chromosome);
+    }
   }
   arrayDestroy (bedGraphs);
 }
@@ -156,7 +185,7 @@ Array bgrParser_getValuesForRegion (Array bedGraphs, char *chromosome, int start
   else {
     arrayClear (bedGraphPtrs);
   }
-  testBedGraph.chromosome = hlr_strdup (chromosome);
+  testBedGraph.chromosome = chromosome;
   testBedGraph.start = start;
   testBedGraph.end = end;
   arrayFind (bedGraphs,&testBedGraph,&index,(ARRAYORDERF)bgrParser_sort); 
@@ -191,6 +220,5 @@ Array bgrParser_getValuesForRegion (Array bedGraphs, char *chromosome, int start
       die ("Expected only one BedGraph overlap per position");
     }
   }
-  hlr_free (testBedGraph.chromosome);
   return entries;
 }
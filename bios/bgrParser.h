@@ -7,6 +7,9 @@
  */
 
 
+#include "common.h"
+
+
 /**
  * BedGraph.
  */
@@ -23,6 +26,7 @@ extern void bgrParser_initFromFile (char *fileName);
 extern void bgrParser_initFromPipe (char *command);
 extern void bgrParser_deInit (void);
 
+extern void bgrParser_setArena (Arena callerArena);
 extern BedGraph* bgrParser_nextEntry (void);
 extern Array bgrParser_getAllEntries ( void ); 
 
@@ -0,0 +1,795 @@
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <zlib.h>
+#include "log.h"
+#include "format.h"
+#include "hlrmisc.h"
+#include "common.h"
+#include "bgzf.h"
+
+
+
+/**
+ *   \file bgzf.c Read and write block-compressed gzip (BGZF) files.
+ *   A BGZF file is a series of gzip members of at most 64 kB each. The header of every member carries
+ *   an extra field 'BC' with the size of the compressed block, and the file ends with an empty block.
+ *   Plain gzip tools (zcat, gunzip) read BGZF files like any other multi-member gzip file.
+ *   Positions are given as virtual file offsets: the file offset of a compressed block shifted left by 16 bits,
+ *   combined with an offset into the uncompressed data of that block, see bgzf_makeVirtualOffset().
+ *   Since every block is compressed independently, blocks can be located by seeking and inflated separately,
+ *   also in parallel. The reader also accepts plain gzip files, which are inflated sequentially.
+ */
+
+
+
+#define BGZF_HEADER_SIZE 18
+#define BGZF_FOOTER_SIZE 8
+
+#define BGZF_SLOT_FREE 0
+#define BGZF_SLOT_READING 1
+#define BGZF_SLOT_READY 2
+#define BGZF_SLOT_FILLED 3
+#define BGZF_SLOT_COMPRESSING 4
+
+
+
+typedef struct {
+  char *compressed;
+  char *uncompressed;
+  int blockLength;          // -1 marks the end of the file
+  off_t blockAddress;
+  int blockSize;            // writer: size of the compressed block
+  int state;                // BGZF_SLOT_*
+} BgzfSlot;
+
+
+
+typedef struct {
+  pthread_t *threads;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;      // signalled whenever the state of a slot changes
+  BgzfSlot *slots;          // ring buffer, slot i % numSlots holds block number i
+  int numSlots;
+  long nextRead;            // reader: number of the next block to be read from the file
+  long nextDeliver;         // reader: number of the next block to be handed to the consumer
+  off_t readAddress;        // reader: file offset of block nextRead
+  int atEnd;
+  long nextFill;            // writer: number of the next block to be filled by the producer
+  long nextCompress;        // writer: number of the next block to be compressed
+  long nextWrite;           // writer: number of the next block to be written to the file
+  int stop;
+} BgzfPipeline;
+
+
+
+struct _bgzfStruct_ {
+  FILE *fp;
+  int isWriter;
+  int isBlocked;            // reader: 1 for BGZF, 0 for plain gzip, which is inflated as a stream
+  int level;
+  z_stream stream;
+  char *compressed;         // current compressed block
+  char *uncompressed;       // uncompressed data of the current block
+  int blockLength;          // number of uncompressed bytes in the current block
+  int blockOffset;          // reading or writing position within the uncompressed data
+  off_t blockAddress;       // file offset of the current block
+  off_t nextBlockAddress;   // file offset of the next block
+  unsigned char header[BGZF_HEADER_SIZE];
+  int numPeeked;            // number of bytes of the first header that were read by bgzf_createReader()
+  int atMemberEnd;          // plain gzip: the last gzip member was inflated completely
+  int numThreads;           // number of inflating or deflating threads, 0 works in the calling thread
+  BgzfPipeline *pipeline;   // NULL until the first block is read with numThreads > 0
+};
+
+
+
+static unsigned char bgzf_eofBlock[28] = {
+  0x1f,0x8b,0x08,0x04,0x00,0x00,0x00,0x00,0x00,0xff,0x06,0x00,0x42,0x43,0x02,0x00,
+  0x1b,0x00,0x03,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00
+};
+
+
+
+static Bgzf bgzf_create (FILE *fp)
+{
+  Bgzf bgzf;
+
+  AllocVar (bgzf);
+  bgzf->fp = fp;
+  bgzf->compressed = hlr_malloc (BGZF_MAX_BLOCK_SIZE);
+  bgzf->uncompressed = hlr_malloc (BGZF_MAX_BLOCK_SIZE);
+  return bgzf;
+}
+
+
+
+/* ----------------------------------- reader ----------------------------------- */
+
+
+
+static int bgzf_isBlockHeader (unsigned char *header)
+{
+  return header[0] == 0x1f && header[1] == 0x8b && header[2] == 8 && (header[3] & 4) != 0 &&
+    header[10] == 6 && header[11] == 0 && header[12] == 'B' && header[13] == 'C';
+}
+
+
+
+static int bgzf_getDefaultNumThreads (void)
+{
+  return MAX (0,MIN (sysconf (_SC_NPROCESSORS_ONLN) - 1,BGZF_MAX_THREADS));
+}
+
+
+
+/**
+ * Create a reader for a gzip file. BGZF files are read block by block, using several threads if 
+ * more than one core is available, see bgzf_setNumThreads(). 
+ * Other gzip files, including multi-member files, are inflated sequentially and cannot be positioned.
+ * @param[in] fp File positioned at the start of a gzip member; seekable if bgzf_seek() is used
+ */
+Bgzf bgzf_createReader (FILE *fp)
+{
+  Bgzf bgzf;
+
+  bgzf = bgzf_create (fp);
+  bgzf->numPeeked = fread (bgzf->header,1,BGZF_HEADER_SIZE,fp);
+  bgzf->isBlocked = bgzf->numPeeked == BGZF_HEADER_SIZE && bgzf_isBlockHeader (bgzf->header);
+  bgzf->numThreads = bgzf->isBlocked ? bgzf_getDefaultNumThreads () : 0;
+  if (inflateInit2 (&bgzf->stream,bgzf->isBlocked ? -15 : 15 + 16) != Z_OK) {
+    die ("bgzf_createReader: %s",bgzf->stream.msg ? bgzf->stream.msg : "inflateInit2 failed");
+  }
+  if (!bgzf->isBlocked) {
+    memcpy (bgzf->compressed,bgzf->header,bgzf->numPeeked);
+    bgzf->stream.next_in = (Bytef*)bgzf->compressed;
+    bgzf->stream.avail_in = bgzf->numPeeked;
+    bgzf->numPeeked = 0;
+  }
+  return bgzf;
+}
+
+
+
+/**
+ * Set the number of threads that inflate BGZF blocks ahead of a reader, or that deflate the blocks of a writer. 
+ * By default, one thread per additional core is used (at most BGZF_MAX_THREADS).
+ * @param[in] bgzf A BGZF reader or writer, before the first block is read or written
+ * @param[in] numThreads Number of threads; 0 works in the calling thread
+ */
+void bgzf_setNumThreads (Bgzf bgzf, int numThreads)
+{
+  if (bgzf->pipeline != NULL) {
+    die ("bgzf_setNumThreads: I/O has already started");
+  }
+  bgzf->numThreads = bgzf->isWriter || bgzf->isBlocked ? numThreads : 0;
+}
+
+
+
+/**
+ * Read the compressed block at the current file position into buffer.
+ * @return The size of the block, 0 at the end of the file
+ */
+static int bgzf_readCompressedBlock (Bgzf bgzf, char *buffer, off_t blockAddress)
+{
+  unsigned char *header;
+  int blockSize;
+  int count;
+
+  header = (unsigned char*)buffer;
+  if (bgzf->numPeeked > 0) {
+    memcpy (header,bgzf->header,bgzf->numPeeked);
+    count = bgzf->numPeeked + fread (header + bgzf->numPeeked,1,BGZF_HEADER_SIZE - bgzf->numPeeked,bgzf->fp);
+    bgzf->numPeeked = 0;
+  }
+  else {
+    count = fread (header,1,BGZF_HEADER_SIZE,bgzf->fp);
+  }
+  if (count == 0) {
+    return 0;
+  }
+  if (count != BGZF_HEADER_SIZE || !bgzf_isBlockHeader (header)) {
+    die ("Not a block-compressed gzip (BGZF) file");
+  }
+  blockSize = (header[16] | header[17] << 8) + 1;
+  if (blockSize < BGZF_HEADER_SIZE + BGZF_FOOTER_SIZE) {
+    die ("Invalid BGZF block at offset %lld",(long long)blockAddress);
+  }
+  if (fread (buffer + BGZF_HEADER_SIZE,1,blockSize - BGZF_HEADER_SIZE,bgzf->fp) != blockSize - BGZF_HEADER_SIZE) {
+    die ("Truncated BGZF block at offset %lld",(long long)blockAddress);
+  }
+  return blockSize;
+}
+
+
+
+/**
+ * Inflate a compressed block.
+ * @return The number of uncompressed bytes
+ */
+static int bgzf_inflateBlock (z_stream *stream, char *compressed, int blockSize, char *uncompressed, off_t blockAddress)
+{
+  unsigned char *footer;
+  int blockLength;
+
+  inflateReset (stream);
+  stream->next_in = (Bytef*)compressed + BGZF_HEADER_SIZE;
+  stream->avail_in = blockSize - BGZF_HEADER_SIZE - BGZF_FOOTER_SIZE;
+  stream->next_out = (Bytef*)uncompressed;
+  stream->avail_out = BGZF_MAX_BLOCK_SIZE;
+  if (inflate (stream,Z_FINISH) != Z_STREAM_END) {
+    die ("Corrupt BGZF block at offset %lld: %s",(long long)blockAddress,stream->msg ? stream->msg : "");
+  }
+  blockLength = BGZF_MAX_BLOCK_SIZE - stream->avail_out;
+  footer = (unsigned char*)compressed + blockSize - 4;
+  if (blockLength != (footer[0] | footer[1] << 8 | footer[2] << 16 | (unsigned int)footer[3] << 24)) {
+    die ("Corrupt BGZF block at offset %lld: wrong length",(long long)blockAddress);
+  }
+  return blockLength;
+}
+
+
+
+static void* bgzf_inflateThread (void *data)
+{
+  Bgzf bgzf;
+  BgzfPipeline *pipeline;
+  BgzfSlot *currSlot;
+  z_stream stream;
+  int blockSize;
+
+  bgzf = (Bgzf)data;
+  pipeline = bgzf->pipeline;
+  memset (&stream,0,sizeof (stream));
+  if (inflateInit2 (&stream,-15) != Z_OK) {
+    die ("bgzf_inflateThread: inflateInit2 failed");
+  }
+  pthread_mutex_lock (&pipeline->mutex);
+  while (!pipeline->stop) {
+    if (pipeline->atEnd || pipeline->nextRead - pipeline->nextDeliver >= pipeline->numSlots) {
+      pthread_cond_wait (&pipeline->cond,&pipeline->mutex);
+      continue;
+    }
+    // blocks are read in order while holding the lock, and inflated concurrently
+    currSlot = &pipeline->slots[pipeline->nextRead % pipeline->numSlots];
+    pipeline->nextRead++;
+    currSlot->state = BGZF_SLOT_READING;
+    currSlot->blockAddress = pipeline->readAddress;
+    blockSize = bgzf_readCompressedBlock (bgzf,currSlot->compressed,currSlot->blockAddress);
+    if (blockSize == 0) {
+      pipeline->atEnd = 1;
+      currSlot->blockLength = -1;
+    }
+    else {
+      pipeline->readAddress += blockSize;
+      pthread_mutex_unlock (&pipeline->mutex);
+      currSlot->blockLength = bgzf_inflateBlock (&stream,currSlot->compressed,blockSize,currSlot->uncompressed,currSlot->blockAddress);
+      pthread_mutex_lock (&pipeline->mutex);
+    }
+    currSlot->state = BGZF_SLOT_READY;
+    pthread_cond_broadcast (&pipeline->cond);
+  }
+  pthread_mutex_unlock (&pipeline->mutex);
+  inflateEnd (&stream);
+  return NULL;
+}
+
+
+
+static void bgzf_startPipeline (Bgzf bgzf, void* (*threadFunction)(void*))
+{
+  BgzfPipeline *pipeline;
+  int i;
+
+  AllocVar (pipeline);
+  bgzf->pipeline = pipeline;
+  pipeline->numSlots = 4 * bgzf->numThreads;
+  pipeline->slots = needMem (pipeline->numSlots * sizeof (BgzfSlot));
+  for (i = 0; i < pipeline->numSlots; i++) {
+    pipeline->slots[i].compressed = hlr_malloc (BGZF_MAX_BLOCK_SIZE);
+    pipeline->slots[i].uncompressed = hlr_malloc (BGZF_MAX_BLOCK_SIZE);
+  }
+  pipeline->readAddress = bgzf->nextBlockAddress;
+  pthread_mutex_init (&pipeline->mutex,NULL);
+  pthread_cond_init (&pipeline->cond,NULL);
+  pipeline->threads = needMem (bgzf->numThreads * sizeof (pthread_t));
+  for (i = 0; i < bgzf->numThreads; i++) {
+    if (pthread_create (&pipeline->threads[i],NULL,threadFunction,bgzf) != 0) {
+      die ("Unable to create BGZF thread");
+    }
+  }
+}
+
+
+
+/**
+ * Stop the inflate threads. The file position is undefined afterwards.
+ */
+static void bgzf_stopPipeline (Bgzf bgzf)
+{
+  BgzfPipeline *pipeline;
+  int i;
+
+  pipeline = bgzf->pipeline;
+  pthread_mutex_lock (&pipeline->mutex);
+  pipeline->stop = 1;
+  pthread_cond_broadcast (&pipeline->cond);
+  pthread_mutex_unlock (&pipeline->mutex);
+  for (i = 0; i < bgzf->numThreads; i++) {
+    pthread_join (pipeline->threads[i],NULL);
+  }
+  pthread_mutex_destroy (&pipeline->mutex);
+  pthread_cond_destroy (&pipeline->cond);
+  for (i = 0; i < pipeline->numSlots; i++) {
+    hlr_free (pipeline->slots[i].compressed);
+    hlr_free (pipeline->slots[i].uncompressed);
+  }
+  freeMem (pipeline->slots);
+  freeMem (pipeline->threads);
+  freeMem (pipeline);
+  bgzf->pipeline = NULL;
+}
+
+
+
+/**
+ * Take the next inflated block from the pipeline.
+ * @return 1 if a block was delivered, 0 at the end of the file
+ */
+static int bgzf_deliverBlock (Bgzf bgzf)
+{
+  BgzfPipeline *pipeline;
+  BgzfSlot *currSlot;
+
+  if (bgzf->pipeline == NULL) {
+    bgzf_startPipeline (bgzf,bgzf_inflateThread);
+  }
+  pipeline = bgzf->pipeline;
+  currSlot = &pipeline->slots[pipeline->nextDeliver % pipeline->numSlots];
+  pthread_mutex_lock (&pipeline->mutex);
+  while (pipeline->nextDeliver == pipeline->nextRead || currSlot->state != BGZF_SLOT_READY) {
+    pthread_cond_wait (&pipeline->cond,&pipeline->mutex);
+  }
+  pthread_mutex_unlock (&pipeline->mutex);
+  if (currSlot->blockLength < 0) {
+    return 0;
+  }
+  memcpy (bgzf->uncompressed,currSlot->uncompressed,currSlot->blockLength);
+  bgzf->blockAddress = currSlot->blockAddress;
+  bgzf->blockLength = currSlot->blockLength;
+  pthread_mutex_lock (&pipeline->mutex);
+  currSlot->state = BGZF_SLOT_FREE;
+  pipeline->nextDeliver++;
+  bgzf->nextBlockAddress = pipeline->nextDeliver < pipeline->nextRead ? 
+    pipeline->slots[pipeline->nextDeliver % pipeline->numSlots].blockAddress : pipeline->readAddress;
+  pthread_cond_broadcast (&pipeline->cond);
+  pthread_mutex_unlock (&pipeline->mutex);
+  return 1;
+}
+
+
+
+/**
+ * Inflate the next chunk of a plain gzip stream into the uncompressed buffer.
+ * @return 1 if data was inflated, 0 at the end of the file
+ */
+static int bgzf_inflateStream (Bgzf bgzf)
+{
+  z_stream *stream;
+  int count;
+  int ret;
+
+  stream = &bgzf->stream;
+  stream->next_out = (Bytef*)bgzf->uncompressed;
+  stream->avail_out = BGZF_MAX_BLOCK_SIZE;
+  while (stream->avail_out == BGZF_MAX_BLOCK_SIZE) {
+    if (stream->avail_in == 0) {
+      count = fread (bgzf->compressed,1,BGZF_MAX_BLOCK_SIZE,bgzf->fp);
+      if (count == 0) {
+        if (!bgzf->atMemberEnd) {
+          die ("Truncated gzip file");
+        }
+        return 0;
+      }
+      stream->next_in = (Bytef*)bgzf->compressed;
+      stream->avail_in = count;
+    }
+    bgzf->atMemberEnd = 0;
+    ret = inflate (stream,Z_NO_FLUSH);
+    if (ret == Z_STREAM_END) {
+      // another gzip member may follow
+      bgzf->atMemberEnd = 1;
+      inflateReset (stream);
+    }
+    else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+      die ("Corrupt gzip file: %s",stream->msg ? stream->msg : "");
+    }
+  }
+  bgzf->blockLength = BGZF_MAX_BLOCK_SIZE - stream->avail_out;
+  return 1;
+}
+
+
+
+/**
+ * Read and inflate the next block.
+ * @return 1 if a block was read, 0 at the end of the file
+ */
+static int bgzf_readBlock (Bgzf bgzf)
+{
+  int blockSize;
+
+  bgzf->blockLength = 0;
+  bgzf->blockOffset = 0;
+  if (!bgzf->isBlocked) {
+    return bgzf_inflateStream (bgzf);
+  }
+  if (bgzf->numThreads > 0) {
+    return bgzf_deliverBlock (bgzf);
+  }
+  bgzf->blockAddress = bgzf->nextBlockAddress;
+  blockSize = bgzf_readCompressedBlock (bgzf,bgzf->compressed,bgzf->blockAddress);
+  if (blockSize == 0) {
+    return 0;
+  }
+  bgzf->blockLength = bgzf_inflateBlock (&bgzf->stream,bgzf->compressed,blockSize,bgzf->uncompressed,bgzf->blockAddress);
+  bgzf->nextBlockAddress = bgzf->blockAddress + blockSize;
+  return 1;
+}
+
+
+
+/**
+ * Read the next line. Same semantics as getLine() in format.c.
+ * @param[in] bgzf A BGZF reader
+ * @param[in] buffer Pointer to a string, might be re-allocated
+ * @param[in] buflen Current length of buffer
+ * @return Number of chars put into buffer, including trailing \n (except for the last line), 0 at the end of the file
+ */
+int bgzf_getLine (Bgzf bgzf, char **buffer, int *buflen)
+{
+  char *start;
+  char *newline;
+  int length;
+  int count;
+
+  if (*buffer == NULL) {
+    *buflen = 1000;
+    *buffer = hlr_malloc (*buflen);
+  }
+  count = 0;
+  while (1) {
+    if (bgzf->blockOffset == bgzf->blockLength) {
+      if (!bgzf_readBlock (bgzf)) {
+        break;
+      }
+      continue;
+    }
+    start = bgzf->uncompressed + bgzf->blockOffset;
+    newline = memchr (start,'\n',bgzf->blockLength - bgzf->blockOffset);
+    length = newline != NULL ? newline - start + 1 : bgzf->blockLength - bgzf->blockOffset;
+    if (count + length + 1 > *buflen) {
+      *buflen = 2 * (count + length + 1);
+      if (!(*buffer = realloc (*buffer,*buflen))) {
+        die ("bgzf_getLine: realloc");
+      }
+    }
+    memcpy (*buffer + count,start,length);
+    count += length;
+    bgzf->blockOffset += length;
+    if (newline != NULL) {
+      break;
+    }
+  }
+  (*buffer)[count] = '\0';
+  return count;
+}
+
+
+
+/**
+ * Virtual file offset of the next byte to be read.
+ * @return The offset, -1 if the file is plain gzip rather than BGZF
+ */
+off_t bgzf_tell (Bgzf bgzf)
+{
+  if (!bgzf->isBlocked) {
+    return -1;
+  }
+  return bgzf_makeVirtualOffset (bgzf->blockAddress,bgzf->blockOffset);
+}
+
+
+
+/**
+ * Position a reader at a virtual file offset obtained from bgzf_tell().
+ */
+void bgzf_seek (Bgzf bgzf, off_t virtualOffset)
+{
+  off_t blockAddress;
+  int blockOffset;
+  int numThreads;
+
+  if (!bgzf->isBlocked) {
+    die ("bgzf_seek: only BGZF files can be positioned");
+  }
+  blockAddress = virtualOffset >> 16;
+  blockOffset = virtualOffset & 0xffff;
+  if (blockAddress != bgzf->blockAddress || bgzf->blockLength == 0) {
+    if (bgzf->pipeline != NULL) {
+      bgzf_stopPipeline (bgzf);
+    }
+    bgzf->numPeeked = 0;
+    if (fseeko (bgzf->fp,blockAddress,SEEK_SET) != 0) {
+      die ("bgzf_seek: %s",strerror (errno));
+    }
+    bgzf->nextBlockAddress = blockAddress;
+    // the first block is read in the calling thread, the pipeline restarts after it
+    numThreads = bgzf->numThreads;
+    bgzf->numThreads = 0;
+    bgzf_readBlock (bgzf);
+    bgzf->numThreads = numThreads;
+  }
+  if (blockOffset > bgzf->blockLength) {
+    die ("bgzf_seek: invalid virtual offset %lld",(long long)virtualOffset);
+  }
+  bgzf->blockOffset = blockOffset;
+}
+
+
+
+/* ----------------------------------- writer ----------------------------------- */
+
+
+
+/**
+ * Create a writer for a BGZF file. Blocks are compressed by several threads if more than one core is available, 
+ * see bgzf_setNumThreads(); they are written in order, so the output does not depend on the number of threads.
+ * @param[in] fp Output file
+ * @param[in] level zlib compression level (0-9, or -1 for the default)
+ */
+Bgzf bgzf_createWriter (FILE *fp, int level)
+{
+  Bgzf bgzf;
+
+  bgzf = bgzf_create (fp);
+  bgzf->isWriter = 1;
+  bgzf->level = level;
+  bgzf->numThreads = bgzf_getDefaultNumThreads ();
+  if (deflateInit2 (&bgzf->stream,level,Z_DEFLATED,-15,8,Z_DEFAULT_STRATEGY) != Z_OK) {
+    die ("bgzf_createWriter: %s",bgzf->stream.msg ? bgzf->stream.msg : "deflateInit2 failed");
+  }
+  return bgzf;
+}
+
+
+
+static int bgzf_deflateBlock (z_stream *stream, char *uncompressed, int length, char *compressed)
+{
+  deflateReset (stream);
+  stream->next_in = (Bytef*)uncompressed;
+  stream->avail_in = length;
+  stream->next_out = (Bytef*)compressed + BGZF_HEADER_SIZE;
+  stream->avail_out = BGZF_MAX_BLOCK_SIZE - BGZF_HEADER_SIZE - BGZF_FOOTER_SIZE;
+  return deflate (stream,Z_FINISH) == Z_STREAM_END;
+}
+
+
+
+/**
+ * Compress a block including the BGZF header and the gzip footer.
+ * @return The size of the compressed block
+ */
+static int bgzf_compressBlock (z_stream *stream, int level, char *uncompressed, int length, char *compressed)
+{
+  unsigned char *header;
+  unsigned char *footer;
+  unsigned int crc;
+  int blockSize;
+
+  if (bgzf_deflateBlock (stream,uncompressed,length,compressed)) {
+    blockSize = BGZF_HEADER_SIZE + stream->total_out + BGZF_FOOTER_SIZE;
+  }
+  else {
+    // incompressible data: stored blocks always fit into BGZF_MAX_BLOCK_SIZE
+    deflateReset (stream);
+    deflateParams (stream,Z_NO_COMPRESSION,Z_DEFAULT_STRATEGY);
+    if (!bgzf_deflateBlock (stream,uncompressed,length,compressed)) {
+      die ("bgzf_compressBlock: deflate failed");
+    }
+    blockSize = BGZF_HEADER_SIZE + stream->total_out + BGZF_FOOTER_SIZE;
+    deflateReset (stream);
+    deflateParams (stream,level,Z_DEFAULT_STRATEGY);
+  }
+  header = (unsigned char*)compressed;
+  memcpy (header,bgzf_eofBlock,BGZF_HEADER_SIZE);
+  header[16] = (blockSize - 1) & 0xff;
+  header[17] = (blockSize - 1) >> 8;
+  crc = crc32 (crc32 (0L,Z_NULL,0),(Bytef*)uncompressed,length);
+  footer = header + blockSize - BGZF_FOOTER_SIZE;
+  footer[0] = crc & 0xff;
+  footer[1] = (crc >> 8) & 0xff;
+  footer[2] = (crc >> 16) & 0xff;
+  footer[3] = (crc >> 24) & 0xff;
+  footer[4] = length & 0xff;
+  footer[5] = (length >> 8) & 0xff;
+  footer[6] = 0;
+  footer[7] = 0;
+  return blockSize;
+}
+
+
+
+static void bgzf_writeCompressedBlock (Bgzf bgzf, char *compressed, int blockSize)
+{
+  if (fwrite (compressed,1,blockSize,bgzf->fp) != blockSize) {
+    die ("bgzf_writeBlock: %s",strerror (errno));
+  }
+  bgzf->blockAddress += blockSize;
+}
+
+
+
+static void* bgzf_deflateThread (void *data)
+{
+  Bgzf bgzf;
+  BgzfPipeline *pipeline;
+  BgzfSlot *currSlot;
+  z_stream stream;
+
+  bgzf = (Bgzf)data;
+  pipeline = bgzf->pipeline;
+  memset (&stream,0,sizeof (stream));
+  if (deflateInit2 (&stream,bgzf->level,Z_DEFLATED,-15,8,Z_DEFAULT_STRATEGY) != Z_OK) {
+    die ("bgzf_deflateThread: deflateInit2 failed");
+  }
+  pthread_mutex_lock (&pipeline->mutex);
+  while (!pipeline->stop) {
+    if (pipeline->nextCompress == pipeline->nextFill) {
+      pthread_cond_wait (&pipeline->cond,&pipeline->mutex);
+      continue;
+    }
+    currSlot = &pipeline->slots[pipeline->nextCompress % pipeline->numSlots];
+    pipeline->nextCompress++;
+    currSlot->state = BGZF_SLOT_COMPRESSING;
+    pthread_mutex_unlock (&pipeline->mutex);
+    currSlot->blockSize = bgzf_compressBlock (&stream,bgzf->level,currSlot->uncompressed,currSlot->blockLength,currSlot->compressed);
+    pthread_mutex_lock (&pipeline->mutex);
+    currSlot->state = BGZF_SLOT_READY;
+    // blocks are written in order by whichever thread completes the next one
+    while (pipeline->nextWrite < pipeline->nextCompress && 
+           (currSlot = &pipeline->slots[pipeline->nextWrite % pipeline->numSlots])->state == BGZF_SLOT_READY) {
+      bgzf_writeCompressedBlock (bgzf,currSlot->compressed,currSlot->blockSize);
+      currSlot->state = BGZF_SLOT_FREE;
+      pipeline->nextWrite++;
+    }
+    pthread_cond_broadcast (&pipeline->cond);
+  }
+  pthread_mutex_unlock (&pipeline->mutex);
+  deflateEnd (&stream);
+  return NULL;
+}
+
+
+
+/**
+ * Hand the pending data to the compressing threads. The buffer is exchanged with that of a free slot.
+ */
+static void bgzf_submitBlock (Bgzf bgzf)
+{
+  BgzfPipeline *pipeline;
+  BgzfSlot *currSlot;
+  char *buffer;
+
+  if (bgzf->pipeline == NULL) {
+    bgzf_startPipeline (bgzf,bgzf_deflateThread);
+  }
+  pipeline = bgzf->pipeline;
+  currSlot = &pipeline->slots[pipeline->nextFill % pipeline->numSlots];
+  pthread_mutex_lock (&pipeline->mutex);
+  while (currSlot->state != BGZF_SLOT_FREE) {
+    pthread_cond_wait (&pipeline->cond,&pipeline->mutex);
+  }
+  buffer = currSlot->uncompressed;
+  currSlot->uncompressed = bgzf->uncompressed;
+  bgzf->uncompressed = buffer;
+  currSlot->blockLength = bgzf->blockLength;
+  currSlot->state = BGZF_SLOT_FILLED;
+  pipeline->nextFill++;
+  pthread_cond_broadcast (&pipeline->cond);
+  pthread_mutex_unlock (&pipeline->mutex);
+  bgzf->blockLength = 0;
+}
+
+
+
+static void bgzf_writeBlock (Bgzf bgzf)
+{
+  int blockSize;
+
+  if (bgzf->numThreads > 0) {
+    bgzf_submitBlock (bgzf);
+    return;
+  }
+  blockSize = bgzf_compressBlock (&bgzf->stream,bgzf->level,bgzf->uncompressed,bgzf->blockLength,bgzf->compressed);
+  bgzf_writeCompressedBlock (bgzf,bgzf->compressed,blockSize);
+  bgzf->blockLength = 0;
+}
+
+
+
+/**
+ * Append data to a BGZF writer. Full blocks are compressed and written immediately, or handed to the compressing threads.
+ */
+void bgzf_write (Bgzf bgzf, char *data, int length)
+{
+  int count;
+
+  while (length > 0) {
+    count = MIN (length,BGZF_MAX_BLOCK_INPUT - bgzf->blockLength);
+    memcpy (bgzf->uncompressed + bgzf->blockLength,data,count);
+    bgzf->blockLength += count;
+    data += count;
+    length -= count;
+    if (bgzf->blockLength == BGZF_MAX_BLOCK_INPUT) {
+      bgzf_writeBlock (bgzf);
+    }
+  }
+}
+
+
+
+/**
+ * Compress and write the pending data of a BGZF writer as a (possibly short) block. 
+ * Returns after all blocks have been written.
+ */
+void bgzf_flush (Bgzf bgzf)
+{
+  BgzfPipeline *pipeline;
+
+  if (bgzf->blockLength > 0) {
+    bgzf_writeBlock (bgzf);
+  }
+  if ((pipeline = bgzf->pipeline) != NULL) {
+    pthread_mutex_lock (&pipeline->mutex);
+    while (pipeline->nextWrite < pipeline->nextFill) {
+      pthread_cond_wait (&pipeline->cond,&pipeline->mutex);
+    }
+    pthread_mutex_unlock (&pipeline->mutex);
+  }
+  fflush (bgzf->fp);
+}
+
+
+
+/**
+ * Destroy a BGZF reader or writer. A writer writes its pending data and the end-of-file block.
+ * @note The file is not closed.
+ */
+void bgzf_destroy (Bgzf bgzf)
+{
+  if (bgzf == NULL) {
+    return;
+  }
+  if (bgzf->isWriter) {
+    bgzf_flush (bgzf);
+    if (bgzf->pipeline != NULL) {
+      bgzf_stopPipeline (bgzf);
+    }
+    if (fwrite (bgzf_eofBlock,1,sizeof (bgzf_eofBlock),bgzf->fp) != sizeof (bgzf_eofBlock)) {
+      die ("bgzf_destroy: %s",strerror (errno));
+    }
+    fflush (bgzf->fp);
+    deflateEnd (&bgzf->stream);
+  }
+  else {
+    if (bgzf->pipeline != NULL) {
+      bgzf_stopPipeline (bgzf);
+    }
+    inflateEnd (&bgzf->stream);
+  }
+  hlr_free (bgzf->compressed);
+  hlr_free (bgzf->uncompressed);
+  freeMem (bgzf);
+}
@@ -0,0 +1,58 @@
+#ifndef DEF_BGZF_H
+#define DEF_BGZF_H
+
+
+
+/**
+ *   \file bgzf.h
+ */
+
+
+
+#include <stdio.h>
+#include <sys/types.h>
+
+
+
+/**
+ * Maximum number of uncompressed bytes per block.
+ */
+#define BGZF_MAX_BLOCK_INPUT 0xff00
+
+/**
+ * Maximum size of a compressed block.
+ */
+#define BGZF_MAX_BLOCK_SIZE 0x10000
+
+/**
+ * Maximum number of threads that inflate blocks ahead of a reader, see bgzf_setNumThreads().
+ */
+#define BGZF_MAX_THREADS 8
+
+/**
+ * Build a virtual file offset from the file offset of a compressed block and an offset within its uncompressed data.
+ */
+#define bgzf_makeVirtualOffset(blockAddress,blockOffset) (((off_t)(blockAddress) << 16) | (blockOffset))
+
+
+
+/**
+ * Bgzf.
+ */
+typedef struct _bgzfStruct_ *Bgzf;
+
+
+
+extern Bgzf bgzf_createReader (FILE *fp);
+extern void bgzf_setNumThreads (Bgzf bgzf, int numThreads);
+extern int bgzf_getLine (Bgzf bgzf, char **buffer, int *buflen);
+extern off_t bgzf_tell (Bgzf bgzf);
+extern void bgzf_seek (Bgzf bgzf, off_t virtualOffset);
+extern Bgzf bgzf_createWriter (FILE *fp, int level);
+extern void bgzf_write (Bgzf bgzf, char *data, int length);
+extern void bgzf_flush (Bgzf bgzf);
+extern void bgzf_destroy (Bgzf bgzf);
+
+
+
+#endif
@@ -18,6 +18,7 @@
 
 
 static LineStream ls = NULL;
+static Arena arena = NULL;
 
 
 
@@ -65,6 +66,26 @@ void blatParser_deInit (void)
 
 
 
+/**
+ * Make the parser allocate the query and target names in an arena instead of individually on the heap.
+ * @param[in] callerArena Arena supplied by the caller, who owns it. NULL restores individual allocation.
+ * @note The parser resets the arena whenever it releases the previous query, 
+   i.e. at the next call of blatParser_nextQuery(). The arena must not be used for anything else in the meantime.
+ */
+void blatParser_setArena (Arena callerArena)
+{
+  arena = callerArena;
+}
+
+
+
+static char* blatParser_strdup (char *s)
+{
+  return arena != NULL ? arena_strdup (arena,s) : hlr_strdup (s);
+}
+
+
+
 static void blatParser_freeQuery (BlatQuery *currBlatQuery) 
 {
   int i;
@@ -73,10 +94,17 @@ static void blatParser_freeQuery (BlatQuery *currBlatQuery)
   if (currBlatQuery == NULL) {
     return;
   }
-  hlr_free (currBlatQuery->qName);
+  if (arena != NULL) {
+    arena_reset (arena);
+  }
+  else {
+    hlr_free (currBlatQuery->qName);
+  }
   for (i = 0; i < arrayMax (currBlatQuery->entries); i++) {
     currPslEntry = arrp (currBlatQuery->entries,i,PslEntry);
-    hlr_free (currPslEntry->tName);
+    if (arena == NULL) {
+      hlr_free (currPslEntry->tName);
+    }
     arrayDestroy (currPslEntry->blockSizes);
     arrayDestroy (currPslEntry->tStarts);
     arrayDestroy (currPslEntry->qStarts);
@@ -155,7 +183,7 @@ BlatQuery* blatParser_nextQuery (void)
 	currPslEntry->qSize = atoi (wordNext (w));
 	currPslEntry->qStart = atoi (wordNext (w));
 	currPslEntry->qEnd = atoi (wordNext (w));
-	currPslEntry->tName = hlr_strdup (wordNext (w));
+	currPslEntry->tName = blatParser_strdup (wordNext (w));
 	currPslEntry->tSize = atoi (wordNext (w));
 	currPslEntry->tStart = atoi (wordNext (w));
 	currPslEntry->tEnd = atoi (wordNext (w));
@@ -172,7 +200,7 @@ BlatQuery* blatParser_nextQuery (void)
 	return currBlatQuery;
       }
       if (first == 1) {
-	currBlatQuery->qName = hlr_strdup (queryName);
+	currBlatQuery->qName = blatParser_strdup (queryName);
 	first = 0;
       }
       strReplace(&prevBlatQueryName,queryName);
@@ -10,6 +10,10 @@
 
 
 
+#include "common.h"
+
+
+
 /**
  * BlatQuery.
  */
@@ -51,6 +55,7 @@ typedef struct {
 extern void blatParser_initFromFile (char* fileName);
 extern void blatParser_initFromPipe (char* command);
 extern void blatParser_deInit (void);
+extern void blatParser_setArena (Arena callerArena);
 extern BlatQuery* blatParser_nextQuery (void);
 
 
@@ -14,6 +14,7 @@
 
 
 static LineStream ls = NULL;
+static Arena arena = NULL;
 
 
 
@@ -51,6 +52,27 @@ void bowtieParser_deInit (void)
 
 
 
+/**
+ * Make the parser allocate the strings of the queries it returns in an arena instead of individually on the heap.
+ * @param[in] callerArena Arena supplied by the caller, who owns it. NULL restores individual allocation.
+ * @note bowtieParser_nextQuery() resets the arena when it releases the previous query, 
+   so the arena must not be used for anything else in the meantime. Queries returned by the parser must then 
+   not be passed to bowtieParser_freeQuery(); copies made with bowtieParser_copyQuery() are unaffected.
+ */
+void bowtieParser_setArena (Arena callerArena)
+{
+  arena = callerArena;
+}
+
+
+
+static char* bowtieParser_strdup (char *s)
+{
+  return arena != NULL ? arena_strdup (arena,s) : hlr_strdup (s);
+}
+
+
+
 /**
  * Deinitialize the BowtieQuery.
  */
@@ -76,6 +98,30 @@ void bowtieParser_freeQuery (BowtieQuery *currBowtieQuery)
   freeMem (currBowtieQuery);
 }
 
+
+
+/**
+ * Release a query returned by the parser, whose strings may live in the arena.
+ */
+static void bowtieParser_releaseQuery (BowtieQuery *currBowtieQuery) 
+{
+  int i;
+
+  if (arena == NULL) {
+    bowtieParser_freeQuery (currBowtieQuery);
+    return;
+  }
+  if (currBowtieQuery == NULL) {
+    return;
+  }
+  for (i = 0; i < arrayMax (currBowtieQuery->entries); i++) {
+    arrayDestroy (arrp (currBowtieQuery->entries,i,BowtieEntry)->mismatches);
+  }
+  arrayDestroy (currBowtieQuery->entries);
+  freeMem (currBowtieQuery);
+  arena_reset (arena);
+}
+
  
 
 static void bowtieParser_copyEntry (BowtieEntry *dest, BowtieEntry *orig) 
@@ -152,10 +198,10 @@ static void bowtieParser_processLine (char* line, BowtieQuery* currBowtieQuery)
   currEntry = arrayp (currBowtieQuery->entries,arrayMax (currBowtieQuery->entries),BowtieEntry);
   w = wordIterCreate (line,"\t",0);
   currEntry->strand = (wordNext (w))[0];
-  currEntry->chromosome = hlr_strdup (wordNext (w));
+  currEntry->chromosome = bowtieParser_strdup (wordNext (w));
   currEntry->position = atoi (wordNext (w));
-  currEntry->sequence = hlr_strdup (wordNext (w));
-  currEntry->quality = hlr_strdup (wordNext (w));
+  currEntry->sequence = bowtieParser_strdup (wordNext (w));
+  currEntry->quality = bowtieParser_strdup (wordNext (w));
   wordNext (w);
   bowtieParser_processMismatches (currEntry,wordNext (w));
   wordIterDestroy (w);
@@ -173,7 +219,7 @@ static BowtieQuery* bowtieParser_processNextQuery (int freeMemory)
 
   if (!ls_isEof (ls)) {
     if (freeMemory) {
-      bowtieParser_freeQuery (currBowtieQuery);
+      bowtieParser_releaseQuery (currBowtieQuery);
       currBowtieQuery = NULL;
     }
     AllocVar (currBowtieQuery);
@@ -194,7 +240,7 @@ static BowtieQuery* bowtieParser_processNextQuery (int freeMemory)
 	return currBowtieQuery;
       }
       if (first == 1) {
-	currBowtieQuery->sequenceName = hlr_strdup (queryName);
+	currBowtieQuery->sequenceName = bowtieParser_strdup (queryName);
 	first = 0;
       }
       strReplace(&prevBowtieQueryName,queryName);
@@ -207,7 +253,7 @@ static BowtieQuery* bowtieParser_processNextQuery (int freeMemory)
     }
   }
   if (freeMemory) {
-    bowtieParser_freeQuery (currBowtieQuery);
+    bowtieParser_releaseQuery (currBowtieQuery);
     currBowtieQuery = NULL;
   }
   return NULL;  
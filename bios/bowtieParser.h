@@ -10,6 +10,10 @@
 
 
 
+#include "common.h"
+
+
+
 
 /**
  * BowtieQuery.
@@ -51,6 +55,7 @@ extern void bowtieParser_initFromPipe (char* command);
 extern void bowtieParser_deInit (void);
 extern void bowtieParser_copyQuery (BowtieQuery **dest, BowtieQuery *orig);
 extern void bowtieParser_freeQuery (BowtieQuery *currBowtieQuery);
+extern void bowtieParser_setArena (Arena callerArena);
 extern BowtieQuery* bowtieParser_nextQuery (void);
 extern Array  bowtieParser_getAllQueries ();
 
@@ -71,6 +71,26 @@ void freez (void *ppt);
 
 
 
+/**
+ * Arena: region allocator for many small, short-lived objects that are freed together.
+ */
+typedef struct _arenaStruct_ *Arena;
+
+
+/**
+ * Default block size of an arena, see arena_create().
+ */
+#define ARENA_DEFAULT_BLOCK_SIZE 1048576
+
+
+Arena arena_create (size_t blockSize, int useHugePages);
+void *arena_alloc (Arena arena, size_t size);
+char *arena_strdup (Arena arena, char *s);
+void arena_reset (Arena arena);
+void arena_destroy (Arena arena);
+
+
+
 
 /****************************************************************************************
 * Other Functions
@@ -152,7 +152,7 @@ void stringAdjust(Array s1) {
   }
   l = strlen(string(s1)) ;
   if (l >= arrayMax(s1))
-    die("stringAdjust: memory allocation error? actual string length is %d, but array knows only about %d chars", l, arrayMax(s1)-1) ;
+    die("stringAdjust: memory allocation error? actual string length is %d, but array knows only about %d chars", l, (int)(arrayMax(s1)-1)) ;
   arraySetMax(s1, l+1) ;
 }
 
@@ -1152,7 +1152,8 @@ int getLine(FILE *stream, char **buffer, int *buflen)
   bufp = *buffer ;
   startp = bufp ;
 
-  while ((c = getc(stream)) != EOF) {
+  flockfile(stream) ; /* lock once per line rather than once per character */
+  while ((c = getc_unlocked(stream)) != EOF) {
 
     if (! --buffree) {
       *buflen = *buflen + GETLINE_INC ;
@@ -1167,6 +1168,7 @@ int getLine(FILE *stream, char **buffer, int *buflen)
     *(bufp++) = c ;          /* append char to buffer */
     if (c == '\n') break ;
   }
+  funlockfile(stream) ;
 
   *bufp = '\0' ;
   return bufp - startp ;
@@ -1325,6 +1327,192 @@ char *wordNextG(WordIter this1, int *lenP)
   return word ;
 }
 
+
+/**
+ * Start iterating over the fields of 's', separated by any char from 'seps'.
+   Like wordFldIterCreate(), every separator ends a field, so there are empty fields 
+   and the empty string has one empty field. Unlike WordIter, nothing is allocated 
+   and 's' is not modified by fieldNext().
+ * @param[in] fc Cursor, typically a local variable
+ * @param[in] s String to split; must stay stable during the scan
+ * @param[in] seps Set of separator chars, not empty; a single separator is fastest
+ */
+void fieldCursorInit(FieldCursor *fc, char *s, char *seps)
+{
+  if (!s || !seps || !*seps)
+    die("fieldCursorInit: some null/empty input") ;
+  fc->pos = s ;
+  fc->seps = seps ;
+}
+
+
+/**
+ * Get the next field.
+ * @param[in] fc Initialized by fieldCursorInit()
+ * @param[out] f The field, a view into the string
+ * @return 1 if there was another field, 0 if the string is exhausted
+ */
+int fieldNext(FieldCursor *fc, Field *f)
+{
+  char *cp ;
+  if (!fc->pos)
+    return 0 ;
+  if (fc->seps[1] == '\0') {
+    cp = strchr(fc->pos, fc->seps[0]) ;
+    if (!cp)
+      cp = fc->pos + strlen(fc->pos) ;
+  }
+  else
+    cp = fc->pos + strcspn(fc->pos, fc->seps) ;
+  f->s = fc->pos ;
+  f->len = cp - fc->pos ;
+  fc->pos = *cp ? cp + 1 : NULL ;
+  return 1 ;
+}
+
+
+/**
+ * Get the next field as a null-terminated string, by overwriting the separator 
+   that ends it with '\0' (like wordNext()).
+ * @param[in] fc Initialized by fieldCursorInit()
+ * @return The field, pointing into the string; NULL if the string is exhausted
+ */
+char *fieldNextZ(FieldCursor *fc)
+{
+  Field f ;
+  if (!fieldNext(fc, &f))
+    return NULL ;
+  f.s[f.len] = '\0' ;
+  return f.s ;
+}
+
+
+/**
+ * Compare a field with a null-terminated string.
+ * @return 1 if equal, 0 otherwise
+ */
+int fieldEqual(Field f, char *s)
+{
+  return strncmp(f.s, s, f.len) == 0 && s[f.len] == '\0' ;
+}
+
+
+/**
+ * Copy a field into a null-terminated string.
+ * @return The copy, to be freed with hlr_free()
+ */
+char *fieldDup(Field f)
+{
+  char *s = hlr_malloc(f.len + 1) ;
+  memcpy(s, f.s, f.len) ;
+  s[f.len] = '\0' ;
+  return s ;
+}
+
+
+/**
+ * Parse the decimal integer at the start of a field, like atoi(): 
+   an optional sign followed by digits; parsing stops at the first other char.
+ * @return The number, 0 if the field does not start with one
+ */
+int parseInt(Field f)
+{
+  char *cp = f.s ;
+  char *end = f.s + f.len ;
+  long long n = 0 ;
+  int negative = 0 ;
+  while (cp < end && (*cp == ' ' || *cp == '\t'))
+    ++cp ;
+  if (cp < end && (*cp == '-' || *cp == '+'))
+    negative = *cp++ == '-' ;
+  while (cp < end && *cp >= '0' && *cp <= '9')
+    n = n * 10 + (*cp++ - '0') ;
+  return (int)(negative ? -n : n) ;
+}
+
+
+/**
+ * Parse the floating point number at the start of a field, like atof().
+   Numbers with at most 15 significant digits and a small decimal exponent are 
+   converted directly, which gives the same, correctly rounded result as strtod(); 
+   anything else is handed to strtod().
+ * @return The number, 0.0 if the field does not start with one
+ */
+double parseDouble(Field f)
+{
+  static double powersOf10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 
+                                1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 
+                                1e20, 1e21, 1e22} ;
+  char buffer[64] ;
+  char *copy ;
+  char *cp = f.s ;
+  char *end = f.s + f.len ;
+  unsigned long long mantissa = 0 ;
+  int numDigits = 0 ;
+  int exponent = 0 ;
+  int expNumber = 0 ;
+  int expNegative = 0 ;
+  int negative = 0 ;
+  int hasDigits = 0 ;
+  double value ;
+
+  if (cp < end && (*cp == '-' || *cp == '+'))
+    negative = *cp++ == '-' ;
+  for (; cp < end && *cp >= '0' && *cp <= '9'; ++cp) {
+    hasDigits = 1 ;
+    if (mantissa == 0 && *cp == '0')
+      continue ;
+    mantissa = mantissa * 10 + (*cp - '0') ;
+    ++numDigits ;
+    if (numDigits > 15)
+      goto slowPath ;
+  }
+  if (cp < end && *cp == '.') {
+    for (++cp; cp < end && *cp >= '0' && *cp <= '9'; ++cp) {
+      hasDigits = 1 ;
+      --exponent ;
+      if (mantissa == 0 && *cp == '0')
+        continue ;
+      mantissa = mantissa * 10 + (*cp - '0') ;
+      ++numDigits ;
+      if (numDigits > 15)
+        goto slowPath ;
+    }
+  }
+  if (!hasDigits)
+    goto slowPath ; /* leading white space, inf, nan, hex or no number at all */
+  if (cp < end && (*cp == 'e' || *cp == 'E')) {
+    ++cp ;
+    if (cp < end && (*cp == '-' || *cp == '+'))
+      expNegative = *cp++ == '-' ;
+    if (cp == end || *cp < '0' || *cp > '9')
+      goto slowPath ;
+    for (; cp < end && *cp >= '0' && *cp <= '9'; ++cp) {
+      expNumber = expNumber * 10 + (*cp - '0') ;
+      if (expNumber > 1000)
+        goto slowPath ;
+    }
+    exponent += expNegative ? -expNumber : expNumber ;
+  }
+  if (exponent < -22 || exponent > 22)
+    goto slowPath ;
+  value = (double)mantissa ;
+  if (exponent < 0)
+    value /= powersOf10[-exponent] ;
+  else
+    value *= powersOf10[exponent] ;
+  return negative ? -value : value ;
+
+ slowPath:
+  copy = f.len < (int)sizeof(buffer) ? buffer : hlr_malloc(f.len + 1) ;
+  memcpy(copy, f.s, f.len) ;
+  copy[f.len] = '\0' ;
+  value = strtod(copy, NULL) ;
+  if (copy != buffer)
+    hlr_free(copy) ;
+  return value ;
+}
+
 /* does s1 start with s2?
    strStartsWith() always works, but is slower than strStartsWithC()
                    s2 must not be an expression with side effects
@@ -279,6 +279,44 @@ char *wordNextG(WordIter this1, int *lenP) ;
   wordIterDestroy(wi) ;
 */
 
+
+/* --- FieldCursor: splitting into fields without allocating or copying --- */
+
+/**
+ * Field: a view on a part of a string, given by its start and length; 
+ * the characters are not null-terminated.
+ */
+typedef struct {
+  char *s ;
+  int len ;
+} Field ;
+
+/**
+ * FieldCursor: iterates over the fields of a string. It lives on the stack, 
+ * so there is nothing to create or destroy.
+ */
+typedef struct {
+  char *pos ;   /* start of the next field, NULL after the last field */
+  char *seps ;
+} FieldCursor ;
+
+extern void fieldCursorInit(FieldCursor *fc, char *s, char *seps) ;
+extern int fieldNext(FieldCursor *fc, Field *f) ;
+extern char *fieldNextZ(FieldCursor *fc) ;
+extern int fieldEqual(Field f, char *s) ;
+extern char *fieldDup(Field f) ;
+extern int parseInt(Field f) ;
+extern double parseDouble(Field f) ;
+
+/* usage:
+  FieldCursor fc ;
+  Field f ;
+  fieldCursorInit(&fc, "chr1\t100\t0.5", "\t") ;
+  fieldNext(&fc, &f) ;                       f.s points to "chr1...", f.len is 4
+  fieldNext(&fc, &f) ; start = parseInt(f) ;
+  fieldNext(&fc, &f) ; value = parseDouble(f) ;
+*/
+
 /* --------- getLine(): like gets(), but with arbitrary length lines ------
   usage:
     static char *line = 0 ;
@@ -1,6 +1,7 @@
 #include "log.h"
 #include "format.h"
 #include "linestream.h"
+#include "hashTable.h"
 #include "geneOntology.h"
 #include <gsl/gsl_randist.h>
 
@@ -29,6 +30,7 @@ typedef struct {
 
 static Array goTerms = NULL; // of type GoTerm
 static Array goNodes = NULL; // of type GoNode
+static HashTable goNodesById = NULL; // id -> GoNode*
 static Array genericGoSlimNodes = NULL; // of type GoNode*
 static Array goGeneAssociations = NULL; // of type GoGeneAssociation
 static Texta genesOfInterest = NULL;
@@ -364,16 +366,7 @@ static int sortGoNodesById (GoNode* a, GoNode* b)
  */
 GoNode* geneOntology_findGoNode (char* id) 
 {
-  GoNode testGoNode;
-  int index,foundGoNode;
-
-  testGoNode.id = hlr_strdup (id);
-  foundGoNode = arrayFind (goNodes,&testGoNode,&index,(ARRAYORDERF)sortGoNodesById);
-  hlr_free (testGoNode.id);
-  if (foundGoNode == 1) {
-    return arrp (goNodes,index,GoNode);
-  }
-  return NULL;
+  return hashTable_getString (goNodesById,id);
 }
 
 
@@ -424,6 +417,11 @@ static void goTerms2goNodes (void)
     }
   }
   arraySort (goNodes,(ARRAYORDERF)sortGoNodesById);
+  goNodesById = hashTable_create (HASH_TABLE_STRING_KEYS,arrayMax (goNodes));
+  for (i = 0; i < arrayMax (goNodes); i++) {
+    currGoNode = arrp (goNodes,i,GoNode);
+    hashTable_putString (goNodesById,currGoNode->id,currGoNode);
+  }
   for (i = 0; i < arrayMax (goNodes); i++) {
     currGoNode = arrp (goNodes,i,GoNode);
     if (currGoNode->goTerm->parents == NULL) {
@@ -0,0 +1,277 @@
+#include "log.h"
+#include "format.h"
+#include "common.h"
+#include "hashTable.h"
+
+
+
+/**
+ *   \file hashTable.c Hash table with string or integer keys and pointer values.
+ *   Open addressing with linear probing: all entries are kept in one array of slots,
+ *   so a lookup usually touches a single cache line.
+ *   String keys are copied into one growing character buffer owned by the table.
+ *   Entries cannot be removed. The table is not thread-safe.
+ */
+
+
+
+typedef struct {
+  uint64_t hash;   // 0 marks an empty slot
+  int64_t key;     // the key itself, or the offset of a string key in keyBuffer
+  void *value;
+} HashTableSlot;
+
+
+
+struct _hashTableStruct_ {
+  int keyType;             // HASH_TABLE_*_KEYS
+  HashTableSlot *slots;
+  uint64_t mask;           // number of slots - 1, the number of slots is a power of two
+  int numEntries;
+  Array keyBuffer;         // of type char, the string keys separated by '\0'
+};
+
+
+
+static uint64_t hashTable_hashString (char *key)
+{
+  uint64_t hash;
+
+  // FNV-1a
+  hash = 14695981039346656037ULL;
+  while (*key != '\0') {
+    hash ^= (unsigned char)*key++;
+    hash *= 1099511628211ULL;
+  }
+  return hash != 0 ? hash : 1;
+}
+
+
+
+static uint64_t hashTable_hashInt (int64_t key)
+{
+  uint64_t hash;
+
+  // finalizer of splitmix64
+  hash = (uint64_t)key;
+  hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+  hash ^= hash >> 31;
+  return hash != 0 ? hash : 1;
+}
+
+
+
+static void hashTable_allocateSlots (HashTable table, uint64_t numSlots)
+{
+  table->slots = needMem (numSlots * sizeof (HashTableSlot));
+  table->mask = numSlots - 1;
+}
+
+
+
+/**
+ * Create a hash table.
+ * @param[in] keyType HASH_TABLE_STRING_KEYS or HASH_TABLE_INT_KEYS
+ * @param[in] expectedSize Expected number of entries; the table grows as needed
+ * @return A hash table; free it with hashTable_destroy()
+ */
+HashTable hashTable_create (int keyType, int expectedSize)
+{
+  HashTable table;
+  uint64_t numSlots;
+
+  if (keyType != HASH_TABLE_STRING_KEYS && keyType != HASH_TABLE_INT_KEYS) {
+    die ("hashTable_create: invalid key type %d",keyType);
+  }
+  AllocVar (table);
+  table->keyType = keyType;
+  numSlots = 16;
+  while (numSlots < 2 * (uint64_t)expectedSize) {
+    numSlots *= 2;
+  }
+  hashTable_allocateSlots (table,numSlots);
+  if (keyType == HASH_TABLE_STRING_KEYS) {
+    table->keyBuffer = arrayCreate (16 * numSlots,char);
+  }
+  return table;
+}
+
+
+
+/**
+ * Find the slot of a key.
+ * @return The slot of the key, or the empty slot where it would be inserted
+ */
+static HashTableSlot* hashTable_findSlot (HashTable table, uint64_t hash, char *stringKey, int64_t intKey)
+{
+  HashTableSlot *currSlot;
+  uint64_t i;
+
+  i = hash & table->mask;
+  for (;;) {
+    currSlot = &table->slots[i];
+    if (currSlot->hash == 0) {
+      return currSlot;
+    }
+    if (currSlot->hash == hash) {
+      if (stringKey != NULL) {
+        if (strEqual (arrp (table->keyBuffer,currSlot->key,char),stringKey)) {
+          return currSlot;
+        }
+      }
+      else if (currSlot->key == intKey) {
+        return currSlot;
+      }
+    }
+    i = (i + 1) & table->mask;
+  }
+}
+
+
+
+/**
+ * Double the number of slots. The load factor is kept at most 1/2, which keeps probe sequences short.
+ */
+static void hashTable_grow (HashTable table)
+{
+  HashTableSlot *oldSlots;
+  uint64_t numOldSlots;
+  uint64_t i,j;
+
+  oldSlots = table->slots;
+  numOldSlots = table->mask + 1;
+  hashTable_allocateSlots (table,2 * numOldSlots);
+  for (i = 0; i < numOldSlots; i++) {
+    if (oldSlots[i].hash != 0) {
+      j = oldSlots[i].hash & table->mask;
+      while (table->slots[j].hash != 0) {
+        j = (j + 1) & table->mask;
+      }
+      table->slots[j] = oldSlots[i];
+    }
+  }
+  freeMem (oldSlots);
+}
+
+
+
+static void* hashTable_put (HashTable table, uint64_t hash, char *stringKey, int64_t intKey, void *value)
+{
+  HashTableSlot *currSlot;
+  void *oldValue;
+  int64_t offset;
+  int length;
+
+  if (value == NULL) {
+    die ("hashTable_put: NULL value");
+  }
+  currSlot = hashTable_findSlot (table,hash,stringKey,intKey);
+  if (currSlot->hash != 0) {
+    oldValue = currSlot->value;
+    currSlot->value = value;
+    return oldValue;
+  }
+  if (stringKey != NULL) {
+    offset = arrayMax (table->keyBuffer);
+    length = strlen (stringKey);
+    array (table->keyBuffer,offset + length,char) = '\0';
+    memcpy (arrp (table->keyBuffer,offset,char),stringKey,length);
+    intKey = offset;
+  }
+  currSlot->hash = hash;
+  currSlot->key = intKey;
+  currSlot->value = value;
+  table->numEntries++;
+  if (2 * (uint64_t)table->numEntries > table->mask + 1) {
+    hashTable_grow (table);
+  }
+  return NULL;
+}
+
+
+
+/**
+ * Insert or replace the value of a string key. The table keeps its own copy of the key.
+ * @param[in] table A hash table created with HASH_TABLE_STRING_KEYS
+ * @param[in] key The key
+ * @param[in] value The value, must not be NULL
+ * @return The previous value of the key, NULL if the key is new
+ */
+void* hashTable_putString (HashTable table, char *key, void *value)
+{
+  if (table->keyType != HASH_TABLE_STRING_KEYS) {
+    die ("hashTable_putString: table has integer keys");
+  }
+  return hashTable_put (table,hashTable_hashString (key),key,0,value);
+}
+
+
+
+/**
+ * Look up a string key.
+ * @return The value of the key, NULL if the key is not present
+ */
+void* hashTable_getString (HashTable table, char *key)
+{
+  if (table->keyType != HASH_TABLE_STRING_KEYS) {
+    die ("hashTable_getString: table has integer keys");
+  }
+  return hashTable_findSlot (table,hashTable_hashString (key),key,0)->value;
+}
+
+
+
+/**
+ * Insert or replace the value of an integer key. Pointers can be used as keys by casting them to intptr_t.
+ * @param[in] table A hash table created with HASH_TABLE_INT_KEYS
+ * @param[in] key The key
+ * @param[in] value The value, must not be NULL
+ * @return The previous value of the key, NULL if the key is new
+ */
+void* hashTable_putInt (HashTable table, int64_t key, void *value)
+{
+  if (table->keyType != HASH_TABLE_INT_KEYS) {
+    die ("hashTable_putInt: table has string keys");
+  }
+  return hashTable_put (table,hashTable_hashInt (key),NULL,key,value);
+}
+
+
+
+/**
+ * Look up an integer key.
+ * @return The value of the key, NULL if the key is not present
+ */
+void* hashTable_getInt (HashTable table, int64_t key)
+{
+  if (table->keyType != HASH_TABLE_INT_KEYS) {
+    die ("hashTable_getInt: table has string keys");
+  }
+  return hashTable_findSlot (table,hashTable_hashInt (key),NULL,key)->value;
+}
+
+
+
+/**
+ * Get the number of keys in a hash table.
+ */
+int hashTable_getNumberOfEntries (HashTable table)
+{
+  return table->numEntries;
+}
+
+
+
+/**
+ * Destroy a hash table. The values are not freed.
+ */
+void hashTable_destroy (HashTable table)
+{
+  if (table == NULL) {
+    return;
+  }
+  freeMem (table->slots);
+  arrayDestroy (table->keyBuffer);
+  freeMem (table);
+}
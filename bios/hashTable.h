@@ -0,0 +1,45 @@
+#ifndef DEF_HASH_TABLE_H
+#define DEF_HASH_TABLE_H
+
+
+
+/**
+ *   \file hashTable.h
+ */
+
+
+
+#include <stdint.h>
+
+
+
+/**
+ * Key type of a hash table with strings as keys, see hashTable_create().
+ */
+#define HASH_TABLE_STRING_KEYS 1
+
+/**
+ * Key type of a hash table with integers (or pointers cast to integers) as keys, see hashTable_create().
+ */
+#define HASH_TABLE_INT_KEYS 2
+
+
+
+/**
+ * HashTable.
+ */
+typedef struct _hashTableStruct_ *HashTable;
+
+
+
+extern HashTable hashTable_create (int keyType, int expectedSize);
+extern void* hashTable_putString (HashTable table, char *key, void *value);
+extern void* hashTable_getString (HashTable table, char *key);
+extern void* hashTable_putInt (HashTable table, int64_t key, void *value);
+extern void* hashTable_getInt (HashTable table, int64_t key);
+extern int hashTable_getNumberOfEntries (HashTable table);
+extern void hashTable_destroy (HashTable table);
+
+
+
+#endif
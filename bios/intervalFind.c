@@ -2,6 +2,9 @@
 #include "format.h"
 #include "linestream.h"
 #include "numUtil.h"
+#include "common.h"
+#include "hashTable.h"
+#include "symbolTable.h"
 #include "intervalFind.h"
 
 
@@ -18,81 +21,214 @@
 
 
 
+/**
+ * An interval or a subinterval in an index. Intervals and subintervals are indexed separately, 
+ * see intervalIndex_indexSubIntervals().
+ */
 typedef struct {
-  char* chromosome;
   int start;
   int end;
-  Array sublist;  // of type Interval*
-} SuperInterval;
+  Interval *interval;
+  int subInterval;  // index in interval->subIntervals, -1 for the interval itself
+} IntervalEntry;
 
 
 
-static Array intervals = NULL;
-static Array superIntervals = NULL;
-static int superIntervalAssigned = 0;
+/**
+ * A node of a containment list. Its start and end are copied from the entry, 
+ * so that a search through a list stays within one contiguous block of memory.
+ */
+typedef struct {
+  int start;
+  int end;
+  int entry;    // position of the entry in the entries of the containment index
+  int sublist;  // index of the list of the entries contained in this one, -1 if there are none
+} NCListNode;
 
 
 
 /**
- * Get the total number of intervals that have been added to the search space.
- * @return The total number of intervals in the search space.
- * @pre Intervals were added to the search space using intervalFind_addIntervalsToSearchSpace()
+ * A containment list: entries sorted by start, none of which contains another, 
+ * so that their ends are sorted as well. Identical entries are kept side by side in the same list.
  */
-int intervalFind_getNumberOfIntervals (void)
-{
-  return arrayMax (intervals);
-}
+typedef struct {
+  int first;    // index of the first node in the nodes of the containment index
+  int count;
+} NCList;
 
 
 
 /**
- * Retrieve all the intervals that have been added to the search space.
- * @return An Array of type Interval.
- * @note This function generates a copy of the intervals array. 
- * @pre Intervals were added to the search space using intervalFind_addIntervalsToSearchSpace().
+ * A list being walked by containmentIndex_search().
  */
-Array intervalFind_getAllIntervals (void)
+typedef struct {
+  int list;
+  int position;  // the next node of the list to look at
+} NCListFrame;
+
+
+
+/**
+ * The nested containment list of the intervals, or of the subintervals, on one chromosome.
+ */
+typedef struct {
+  Array entries;  // of type IntervalEntry, sorted by start and then by decreasing end, which is the order an IntervalCursor sweeps in
+  Array nodes;    // of type NCListNode, the nodes of each list are contiguous
+  Array lists;    // of type NCList, list 0 is the top-level list
+} ContainmentIndex;
+
+
+
+/**
+ * An entry of an index together with the number of its chromosome, which is what the index is sorted by.
+ */
+typedef struct {
+  int chromosome;
+  IntervalEntry entry;
+} NCListRef;
+
+
+
+/**
+ * The partition of an index for one chromosome. 
+ * A query never leaves the partition of its chromosome, so the nodes it reads are close together.
+ */
+typedef struct {
+  ContainmentIndex intervals;
+  ContainmentIndex subIntervals;  // empty unless the index has subintervals, see intervalIndex_indexSubIntervals()
+} IntervalChromosome;
+
+
+
+struct _intervalIndexStruct_ {
+  Array intervals;              // of type Interval, in the order in which they were read
+  Array chromosomes;            // of type IntervalChromosome, indexed by chromosome number
+  HashTable chromosomeNumbers;  // chromosome name -> chromosome number + 1
+  Array symbolChromosomes;      // of type int, chromosome number indexed by symbol id, -1 if the chromosome has no intervals
+  int hasSubIntervals;          // see intervalIndex_indexSubIntervals()
+  Arena arena;                  // names and chromosomes of the intervals
+  int ownsArena;
+};
+
+
+
+struct _intervalCursorStruct_ {
+  IntervalIndex index;
+  int subIntervals; // whether the cursor sweeps through the subintervals rather than the intervals
+  int chromosome;   // number of the chromosome of the previous query, -1 if none
+  int start;        // start of the previous query
+  int next;         // position of the first entry that is not yet in the window
+  Array window;     // of type int, positions of the entries that may overlap with the next query, sorted
+  Array matches;    // of type SubIntervalMatch, see intervalCursor_getSubIntervalMatches()
+};
+
+
+
+/**
+ * What the search of a containment index adds to its results.
+ */
+#define REPORT_INTERVALS 1     // Interval*
+#define REPORT_SUBINTERVALS 2  // SubIntervalMatch with a positive overlap
+#define REPORT_POSITIONS 3     // int, the position of the entry
+
+
+
+static Arena callerArena = NULL;           // see intervalFind_setArena()
+static IntervalIndex defaultIndex = NULL;  // used by intervalFind_addIntervalsToSearchSpace() and the functions querying it
+
+
+
+/**
+ * Parse a comma-separated list of subinterval starts or ends into the subintervals of an interval.
+ * @return The number of items in the list
+ */
+static int processCommaSeparatedList (Array subIntervals, Field list, int isEnd) 
 {
-  return arrayCopy (intervals);
+  FieldCursor items;
+  Field item;
+  SubInterval *currSubInterval;
+  int numItems;
+
+  list.s[list.len] = '\0'; // the column cursor has already moved past the tab
+  fieldCursorInit (&items,list.s,",");
+  numItems = 0;
+  while (fieldNext (&items,&item)) {
+    if (item.len == 0) {
+      continue;
+    }
+    currSubInterval = arrayp (subIntervals,numItems,SubInterval);
+    if (isEnd) {
+      currSubInterval->end = parseInt (item);
+    }
+    else {
+      currSubInterval->start = parseInt (item);
+    }
+    numItems++;
+  }
+  return numItems;
 }
 
 
 
 /**
- * Get an array of Interval pointers from the intervals that have been added to the search space.
- * @return An Array of type Interval pointers.
- * @note The user is not allowed to modify the content of the array. 
- * @pre Intervals were added to the search space using intervalFind_addIntervalsToSearchSpace().
+ * Make the parser allocate the names and chromosomes of the intervals it parses in an arena 
+   instead of individually on the heap.
+ * @param[in] arena Arena supplied by the caller, who owns it. NULL restores individual allocation.
+ * @note Applies to intervalFind_parseLine(), intervalFind_parseFile() and the intervals subsequently added 
+   to the search space. The strings of intervals parsed into an arena must not be freed individually.
+   Without a caller-supplied arena the search space uses an arena of its own.
  */
-Array intervalFind_getIntervalPointers (void)
+void intervalFind_setArena (Arena arena)
 {
-  Array intervalPointers;
-  int i;
-  Interval *currInterval;
+  callerArena = arena;
+}
 
-  intervalPointers = arrayCreate (arrayMax (intervals),Interval*);
-  for (i = 0; i < arrayMax (intervals); i++) {
-    currInterval = arrp (intervals,i,Interval);
-    array (intervalPointers,arrayMax (intervalPointers),Interval*) = currInterval;
+
+
+static Field intervalFind_nextField (FieldCursor *columns)
+{
+  Field column;
+
+  if (!fieldNext (columns,&column)) {
+    die ("Expected 8 tab-delimited columns in the Interval format");
   }
-  return intervalPointers;
+  return column;
 }
 
 
 
-static void processCommaSeparatedList (Array results, char *str) 
+static char* intervalFind_nextString (FieldCursor *columns, Arena arena)
 {
-  WordIter w;
-  char *tok;
+  Field column;
 
-  w = wordIterCreate (str,",",0);
-  while (tok = wordNext (w)) {
-    if (tok[0] == '\0') {
-      continue;
-    }
-    array (results,arrayMax (results),int) = atoi (tok);
+  column = intervalFind_nextField (columns);
+  column.s[column.len] = '\0';
+  return arena != NULL ? arena_strdup (arena,column.s) : hlr_strdup (column.s);
+}
+
+
+
+static void intervalFind_parseLineInArena (Interval *thisInterval, char* line, int source, Arena arena)
+{
+  FieldCursor columns;
+  int numStarts,numEnds;
+
+  fieldCursorInit (&columns,line,"\t");
+  thisInterval->source = source;
+  thisInterval->name = intervalFind_nextString (&columns,arena);
+  thisInterval->chromosome = intervalFind_nextString (&columns,arena);
+  thisInterval->strand = intervalFind_nextField (&columns).s[0];
+  thisInterval->start = parseInt (intervalFind_nextField (&columns));
+  thisInterval->end = parseInt (intervalFind_nextField (&columns));
+  thisInterval->subIntervalCount = parseInt (intervalFind_nextField (&columns));
+  // the subintervals are parsed in place, so the parser keeps no state between lines and is reentrant
+  thisInterval->subIntervals = arrayCreate (thisInterval->subIntervalCount,SubInterval);
+  numStarts = processCommaSeparatedList (thisInterval->subIntervals,intervalFind_nextField (&columns),0);
+  numEnds = processCommaSeparatedList (thisInterval->subIntervals,intervalFind_nextField (&columns),1);
+  if (numStarts != numEnds) {
+    die ("Unequal number of subIntervalStarts and subIntervalEnds");
   }
-  wordIterDestroy (w);
+  arraySetMax (thisInterval->subIntervals,thisInterval->subIntervalCount);
 }
 
 
@@ -104,44 +240,16 @@ static void processCommaSeparatedList (Array results, char *str)
  * @param[in] source An integer that specifies the source. This is useful when multiple files are used.
  * See intervalFind_addIntervalsToSearchSpace() for details.
  * @pre None.
+ * @see intervalFind_setArena()
 */
 void intervalFind_parseLine (Interval *thisInterval, char* line, int source)
 {
-  WordIter w;
-  Array subIntervalStarts;
-  Array subIntervalEnds;
-  SubInterval *currSubInterval;
-  int i;
-
-  w = wordIterCreate (line,"\t",0);
-  thisInterval->source = source;
-  thisInterval->name = hlr_strdup (wordNext (w));
-  thisInterval->chromosome = hlr_strdup (wordNext (w));
-  thisInterval->strand = wordNext (w)[0];
-  thisInterval->start = atoi (wordNext (w));
-  thisInterval->end = atoi (wordNext (w));
-  thisInterval->subIntervalCount = atoi (wordNext (w));
-  subIntervalStarts = arrayCreate (thisInterval->subIntervalCount,int);
-  subIntervalEnds = arrayCreate (thisInterval->subIntervalCount,int);
-  processCommaSeparatedList (subIntervalStarts,wordNext (w));
-  processCommaSeparatedList (subIntervalEnds,wordNext (w));
-  if (arrayMax (subIntervalStarts) != arrayMax (subIntervalEnds)) {
-    die ("Unequal number of subIntervalStarts and subIntervalEnds");
-  }
-  thisInterval->subIntervals = arrayCreate (thisInterval->subIntervalCount,SubInterval);
-  for (i = 0; i < thisInterval->subIntervalCount; i++) {
-    currSubInterval = arrayp (thisInterval->subIntervals,arrayMax (thisInterval->subIntervals),SubInterval);
-    currSubInterval->start = arru (subIntervalStarts,i,int);
-    currSubInterval->end = arru (subIntervalEnds,i,int);
-  }
-  arrayDestroy (subIntervalStarts);
-  arrayDestroy (subIntervalEnds);
-  wordIterDestroy (w);
+  intervalFind_parseLineInArena (thisInterval,line,source,callerArena);
 }
 
 
 
-static void parseFileContent (Array theseIntervals, char* fileName, int source)
+static void parseFileContent (Array theseIntervals, char* fileName, int source, Arena arena)
 {
   LineStream ls;
   char *line;
@@ -153,50 +261,13 @@ static void parseFileContent (Array theseIntervals, char* fileName, int source)
       continue;
     }
     currInterval = arrayp (theseIntervals,arrayMax (theseIntervals),Interval);
-    intervalFind_parseLine (currInterval,line,source);
+    intervalFind_parseLineInArena (currInterval,line,source,arena);
   }
   ls_destroy (ls);
 }
 
 
 
-/**
- * Add intervals to the search space. 
- * @param[in] fileName File name of the file that contains the interval and subintervals to search against. 
-   This tab-delimited file must have the following format:
-   
-   \verbatim
-   Column:   Description:
-   1         Name of the interval
-   2         Chromosome 
-   3         Strand
-   4         Interval start
-   5         Interval end
-   6         Number of subintervals
-   7         Subinterval starts (comma-delimited)
-   8         Subinterval end (comma-delimited)
-   \endverbatim
-
-   This is an example:
-   \verbatim
-   uc001aaw.1      chr1    +       357521  358460  1       357521  358460
-   uc001aax.1      chr1    +       410068  411702  3       410068,410854,411258    410159,411121,411702
-   uc001aay.1      chr1    -       552622  554252  3       552622,553203,554161    553066,553466,554252
-   uc001aaz.1      chr1    +       556324  557910  1       556324  557910
-   uc001aba.1      chr1    +       558011  558705  1       558011  558705
-   \endverbatim
-   Note in this example the intervals represent a transcripts, while the subintervals denote exons.
-
- * @param[in] source An integer that specifies the source. This is useful when multiple files are used.
-*/
-void intervalFind_addIntervalsToSearchSpace (char* fileName, int source)
-{
-  intervals = arrayCreate (100000,Interval);
-  parseFileContent (intervals,fileName,source);
-}
-
-
-
 /**
  * Parse a file in the Interval format. 
  * @param[in] fileName File name of the file that contains the interval and subintervals.\n
@@ -210,149 +281,928 @@ Array intervalFind_parseFile (char* fileName, int source)
   Array theseIntervals;
 
   theseIntervals = arrayCreate (100000,Interval);
-  parseFileContent (theseIntervals,fileName,source);
+  parseFileContent (theseIntervals,fileName,source,callerArena);
   return theseIntervals;
 }
 
 
 
-static int sortIntervalsByChromosomeAndStartAndEnd (Interval *a, Interval *b)
+static uint64_t getRefChromosomeStartKey (NCListRef *a)
+{
+  return ((uint64_t)a->chromosome << 32) | ((uint32_t)a->entry.start ^ 0x80000000);
+}
+
+
+
+static uint64_t getRefDescendingEndKey (NCListRef *a)
+{
+  return ~((uint32_t)a->entry.end ^ 0x80000000) & 0xffffffff;
+}
+
+
+
+/**
+ * Whether a contains b. Identical entries do not contain each other, 
+   so that many copies of an entry do not nest into a deep chain of lists.
+ */
+static int intervalIndex_contains (NCListRef *a, NCListRef *b)
+{
+  return a->entry.start <= b->entry.start && a->entry.end >= b->entry.end &&
+         (a->entry.start != b->entry.start || a->entry.end != b->entry.end);
+}
+
+
+
+static int containmentIndex_newList (ContainmentIndex *containmentIndex)
+{
+  NCList *currList;
+
+  currList = arrayp (containmentIndex->lists,arrayMax (containmentIndex->lists),NCList);
+  currList->first = 0;
+  currList->count = 0;
+  return arrayMax (containmentIndex->lists) - 1;
+}
+
+
+
+static void containmentIndex_clear (ContainmentIndex *containmentIndex)
 {
-  int diff;
+  arrayDestroy (containmentIndex->entries);
+  arrayDestroy (containmentIndex->nodes);
+  arrayDestroy (containmentIndex->lists);
+}
+
+
 
-  diff = strcmp (a->chromosome,b->chromosome);
-  if (diff != 0) {
-    return diff;
-  } 
-  diff = a->start - b->start;
-  if (diff != 0) {
-    return diff;
+/**
+ * Add a partition for a chromosome seen for the first time.
+ * @return The number of the chromosome
+ */
+static int intervalIndex_addChromosome (IntervalIndex index, char *name)
+{
+  IntervalChromosome *currChromosome;
+  int number,id;
+
+  number = arrayMax (index->chromosomes);
+  currChromosome = arrayp (index->chromosomes,number,IntervalChromosome);
+  currChromosome->intervals.entries = NULL;
+  currChromosome->intervals.nodes = NULL;
+  currChromosome->intervals.lists = NULL;
+  currChromosome->subIntervals = currChromosome->intervals;
+  hashTable_putString (index->chromosomeNumbers,name,(void*)(intptr_t)(number + 1));
+  id = symbolTable_intern (name);
+  while (arrayMax (index->symbolChromosomes) <= id) {
+    array (index->symbolChromosomes,arrayMax (index->symbolChromosomes),int) = -1;
   }
-  return b->end - a->end;
+  arru (index->symbolChromosomes,id,int) = number;
+  return number;
 }
 
 
 
-static int sortSuperIntervalsByChromosomeAndStartAndEnd (SuperInterval *a, SuperInterval *b)
+/**
+ * Collect the entries to index, either the intervals or their subintervals. 
+   The chromosomes are numbered in the order in which they are first seen.
+ */
+static Array intervalIndex_createRefs (IntervalIndex index, int subIntervals)
 {
-  int diff;
+  Array refs;
+  NCListRef *currRef;
+  Interval *currInterval;
+  SubInterval *currSubInterval;
+  void *value;
+  int i,j;
+
+  refs = arrayCreate (arrayMax (index->intervals),NCListRef);
+  for (i = 0; i < arrayMax (index->intervals); i++) {
+    currInterval = arrp (index->intervals,i,Interval);
+    value = hashTable_getString (index->chromosomeNumbers,currInterval->chromosome);
+    if (value == NULL) {
+      value = (void*)(intptr_t)(intervalIndex_addChromosome (index,currInterval->chromosome) + 1);
+    }
+    if (subIntervals == 0) {
+      currRef = arrayp (refs,arrayMax (refs),NCListRef);
+      currRef->chromosome = (int)(intptr_t)value - 1;
+      currRef->entry.start = currInterval->start;
+      currRef->entry.end = currInterval->end;
+      currRef->entry.interval = currInterval;
+      currRef->entry.subInterval = -1;
+      continue;
+    }
+    for (j = 0; j < arrayMax (currInterval->subIntervals); j++) {
+      currSubInterval = arrp (currInterval->subIntervals,j,SubInterval);
+      currRef = arrayp (refs,arrayMax (refs),NCListRef);
+      currRef->chromosome = (int)(intptr_t)value - 1;
+      currRef->entry.start = currSubInterval->start;
+      currRef->entry.end = currSubInterval->end;
+      currRef->entry.interval = currInterval;
+      currRef->entry.subInterval = j;
+    }
+  }
+  return refs;
+}
+
 
-  diff = strcmp (a->chromosome,b->chromosome);
-  if (diff != 0) {
-    return diff;
-  } 
-  diff = a->start - b->start;
-  if (diff != 0) {
-    return diff;
+
+/**
+ * Build the nested containment list of the entries on one chromosome. Each entry goes into the list of the smallest entry 
+   that contains it, or into the top-level list. The lists are laid out one after the other in containmentIndex->nodes, 
+   each sorted by start.
+ * @param[in] refs The entries of the chromosome, sorted by start and then by decreasing end, 
+   so that an entry comes after all entries that contain it
+ */
+static void containmentIndex_build (ContainmentIndex *containmentIndex, NCListRef *refs, int count)
+{
+  Array parents;      // of type int, stack of the indices of the refs that contain the current one
+  Array listOf;       // of type int, the list each ref goes into
+  Array sublistOf;    // of type int, the list of the entries contained in each ref
+  Array fill;         // of type int, number of nodes already placed per list
+  NCListNode *currNode;
+  NCList *currList;
+  int i,list,parent,first;
+
+  containmentIndex_clear (containmentIndex);
+  containmentIndex->entries = arrayCreate (count,IntervalEntry);
+  for (i = 0; i < count; i++) {
+    array (containmentIndex->entries,i,IntervalEntry) = refs[i].entry;
+  }
+  containmentIndex->lists = arrayCreate (100,NCList);
+  containmentIndex_newList (containmentIndex);
+  parents = arrayCreate (100,int);
+  listOf = arrayCreate (count,int);
+  sublistOf = arrayCreate (count,int);
+  for (i = 0; i < count; i++) {
+    while (arrayMax (parents) > 0 && 
+           !intervalIndex_contains (&refs[arru (parents,arrayMax (parents) - 1,int)],&refs[i])) {
+      arrayMax (parents)--;
+    }
+    if (arrayMax (parents) == 0) {
+      list = 0;
+    }
+    else {
+      parent = arru (parents,arrayMax (parents) - 1,int);
+      if (arru (sublistOf,parent,int) < 0) {
+        arru (sublistOf,parent,int) = containmentIndex_newList (containmentIndex);
+      }
+      list = arru (sublistOf,parent,int);
+    }
+    array (listOf,i,int) = list;
+    array (sublistOf,i,int) = -1;
+    arrp (containmentIndex->lists,list,NCList)->count++;
+    array (parents,arrayMax (parents),int) = i;
+  }
+  first = 0;
+  for (list = 0; list < arrayMax (containmentIndex->lists); list++) {
+    currList = arrp (containmentIndex->lists,list,NCList);
+    currList->first = first;
+    first += currList->count;
   }
-  return b->end - a->end;
+  containmentIndex->nodes = arrayCreate (count,NCListNode);
+  arrayMax (containmentIndex->nodes) = count;
+  fill = arrayCreate (arrayMax (containmentIndex->lists),int);
+  array (fill,arrayMax (containmentIndex->lists),int) = 0;
+  for (i = 0; i < count; i++) {
+    list = arru (listOf,i,int);
+    currNode = arrp (containmentIndex->nodes,arrp (containmentIndex->lists,list,NCList)->first + arru (fill,list,int),NCListNode);
+    arru (fill,list,int)++;
+    currNode->start = refs[i].entry.start;
+    currNode->end = refs[i].entry.end;
+    currNode->entry = i;
+    currNode->sublist = arru (sublistOf,i,int);
+  }
+  arrayDestroy (parents);
+  arrayDestroy (listOf);
+  arrayDestroy (sublistOf);
+  arrayDestroy (fill);
 }
 
 
 
-static void assignSuperIntervals (void)
+/**
+ * Build the partitions of an index for its intervals or for their subintervals. The intervals themselves are not moved.
+ */
+static void intervalIndex_buildPartitions (IntervalIndex index, int subIntervals)
 {
+  Array refs;         // of type NCListRef
+  NCListRef *first;
+  IntervalChromosome *currChromosome;
   int i,j;
-  Interval *currInterval,*nextInterval;
-  SuperInterval *currSuperInterval;
 
-  superIntervals = arrayCreate (100000,SuperInterval);
-  arraySort (intervals,(ARRAYORDERF)sortIntervalsByChromosomeAndStartAndEnd);
+  // by chromosome and start, then by decreasing end; 
+  // the radix sort is stable, so the minor key is sorted first
+  refs = intervalIndex_createRefs (index,subIntervals);
+  arraySortByKey64 (refs,(ARRAYKEYF)getRefDescendingEndKey);
+  arraySortByKey64 (refs,(ARRAYKEYF)getRefChromosomeStartKey);
   i = 0;
-  while (i < arrayMax (intervals)) {
-    currInterval = arrp (intervals,i,Interval);
-    currSuperInterval = arrayp (superIntervals,arrayMax (superIntervals),SuperInterval);
-    currSuperInterval->chromosome = hlr_strdup (currInterval->chromosome);
-    currSuperInterval->start = currInterval->start; 
-    currSuperInterval->end = currInterval->end;
-    currSuperInterval->sublist = arrayCreate (10,Interval*);
-    array (currSuperInterval->sublist,arrayMax (currSuperInterval->sublist),Interval*) = currInterval;
+  while (i < arrayMax (refs)) {
+    first = arrp (refs,i,NCListRef);
     j = i + 1;
-    while (j < arrayMax (intervals)) {
-      nextInterval = arrp (intervals,j,Interval);
-      if (strEqual (currInterval->chromosome,nextInterval->chromosome) &&
-	  currInterval->start <= nextInterval->start && 
-	  currInterval->end >= nextInterval->end) { 
-	array (currSuperInterval->sublist,arrayMax (currSuperInterval->sublist),Interval*) = nextInterval;
-      }
-      else {
-	break;
-      }
+    while (j < arrayMax (refs) && arrp (refs,j,NCListRef)->chromosome == first->chromosome) {
       j++;
     }
+    currChromosome = arrp (index->chromosomes,first->chromosome,IntervalChromosome);
+    containmentIndex_build (subIntervals ? &currChromosome->subIntervals : &currChromosome->intervals,first,j - i);
     i = j;
   }
-  arraySort (superIntervals,(ARRAYORDERF)sortSuperIntervalsByChromosomeAndStartAndEnd);
+  arrayDestroy (refs);
 }
 
 
 
-static void addIntervals (Array matchingIntervals, Array sublist, int start, int end) 
+static void intervalIndex_build (IntervalIndex index)
 {
-  int i;
-  Interval *currInterval;
+  intervalIndex_buildPartitions (index,0);
+  if (index->hasSubIntervals) {
+    intervalIndex_buildPartitions (index,1);
+  }
+}
 
-  for (i = 0; i < arrayMax (sublist); i++) {
-    currInterval = arru (sublist,i,Interval*);
-    if (rangeIntersection (currInterval->start,currInterval->end,start,end) >= 0) {
-      array (matchingIntervals,arrayMax (matchingIntervals),Interval*) = currInterval;
-    }
+
+
+/**
+ * Create an empty interval index. 
+   Several indices can be used at the same time, e.g. one for genes, one for exons and one for repeats.
+ * @param[in] arena Arena that holds the names and chromosomes of the intervals; 
+   if NULL, the index uses an arena of its own, which is freed by intervalIndex_destroy()
+ * @return An IntervalIndex; intervals are added with intervalIndex_addFile()
+ */
+IntervalIndex intervalIndex_create (Arena arena)
+{
+  IntervalIndex index;
+
+  AllocVar (index);
+  index->intervals = arrayCreate (100000,Interval);
+  index->chromosomes = arrayCreate (100,IntervalChromosome);
+  index->chromosomeNumbers = hashTable_create (HASH_TABLE_STRING_KEYS,100);
+  index->symbolChromosomes = arrayCreate (100,int);
+  index->hasSubIntervals = 0;
+  index->ownsArena = arena == NULL;
+  index->arena = arena != NULL ? arena : arena_create (0,0);
+  return index;
+}
+
+
+
+/**
+ * Add the intervals of a file to an index. The index is rebuilt right away, 
+   so that queries never modify it.
+ * @param[in] index An IntervalIndex
+ * @param[in] fileName File in the Interval format, see intervalFind_addIntervalsToSearchSpace(); "-" for stdin
+ * @param[in] source An integer that specifies the source. This is useful when multiple files are used.
+ * @note Interval pointers obtained from the index before this call are no longer valid.
+ */
+void intervalIndex_addFile (IntervalIndex index, char* fileName, int source)
+{
+  parseFileContent (index->intervals,fileName,source,index->arena);
+  intervalIndex_build (index);
+}
+
+
+
+/**
+ * Index the subintervals of an index as well, e.g. the exons of transcripts, 
+   so that intervalIndex_getOverlappingSubIntervals() can find them directly. 
+   This takes about as much memory again as the index of the intervals. 
+   Intervals added later have their subintervals indexed too.
+ * @param[in] index An IntervalIndex
+ */
+void intervalIndex_indexSubIntervals (IntervalIndex index)
+{
+  if (index->hasSubIntervals) {
+    return;
   }
+  index->hasSubIntervals = 1;
+  intervalIndex_buildPartitions (index,1);
 }
 
 
 
 /**
- * Get the intervals that overlap with the query interval.
- * @param[in] chromosome Chromosome of the query interval
- * @param[in] start Start of the query interval
- * @param[in] end End of the query interval
- * @return An Array of Interval pointers. If no overlapping intervals are found, 
-   then an empty Array is returned
- * @note The user is not allowed to modify the content of the array. 
- * @pre Intervals were added to the search space, see intervalFind_addIntervalsToSearchSpace()
+ * Add an entry to the results of a search, see REPORT_INTERVALS.
  */
-Array intervalFind_getOverlappingIntervals (char* chromosome, int start, int end)
+static void containmentIndex_report (ContainmentIndex *containmentIndex, Array results, int position, int start, int end, int mode)
 {
-  SuperInterval testSuperInterval;
-  SuperInterval *currSuperInterval;
-  int i,index;
-  static Array matchingIntervals = NULL;
+  IntervalEntry *currEntry;
+  SubIntervalMatch *currMatch;
+  int overlap;
 
-  if (superIntervalAssigned == 0) {
-     assignSuperIntervals ();
-     superIntervalAssigned = 1;
+  if (mode == REPORT_POSITIONS) {
+    array (results,arrayMax (results),int) = position;
+    return;
   }
-  if (matchingIntervals == NULL) {
-    matchingIntervals = arrayCreate (20,Interval*);
+  currEntry = arrp (containmentIndex->entries,position,IntervalEntry);
+  if (mode == REPORT_INTERVALS) {
+    array (results,arrayMax (results),Interval*) = currEntry->interval;
+    return;
   }
-  else {
-    arrayClear (matchingIntervals);
-  }
-  testSuperInterval.chromosome = chromosome;
-  testSuperInterval.start = start;
-  testSuperInterval.end = end;
-  arrayFind (superIntervals,&testSuperInterval,&index,(ARRAYORDERF)sortSuperIntervalsByChromosomeAndStartAndEnd);
-  // Index points to the location where testSuperInterval would be inserted
-  i = index;
-  while (i >= 0) {
-    currSuperInterval = arrp (superIntervals,i,SuperInterval);
-    if (!strEqual (currSuperInterval->chromosome,chromosome) || currSuperInterval->end < start) {
-      break;
+  overlap = rangeIntersection (start,end,currEntry->start,currEntry->end);
+  if (overlap > 0) {
+    currMatch = arrayp (results,arrayMax (results),SubIntervalMatch);
+    currMatch->interval = currEntry->interval;
+    currMatch->subInterval = arrp (currEntry->interval->subIntervals,currEntry->subInterval,SubInterval);
+    currMatch->overlap = overlap;
+  }
+}
+
+
+
+/**
+ * Find the first node of a list that ends at or after start.
+ */
+static int containmentIndex_findFirst (ContainmentIndex *containmentIndex, int list, int start)
+{
+  NCList *currList;
+  NCListNode *nodes;
+  int low,high,mid;
+
+  currList = arrp (containmentIndex->lists,list,NCList);
+  nodes = arrp (containmentIndex->nodes,currList->first,NCListNode);
+  low = 0;
+  high = currList->count;
+  while (low < high) {
+    mid = low + (high - low) / 2;
+    if (nodes[mid].end < start) {
+      low = mid + 1;
     }
-    addIntervals (matchingIntervals,currSuperInterval->sublist,start,end); 
-    i--;
-  }
-  i = index + 1;
-  while (i < arrayMax (superIntervals)) {
-    currSuperInterval = arrp (superIntervals,i,SuperInterval);
-    if (!strEqual (currSuperInterval->chromosome,chromosome) ||  currSuperInterval->start > end) {
-      break;
+    else {
+      high = mid;
     }
-    addIntervals (matchingIntervals,currSuperInterval->sublist,start,end); 
-    i++;
   }
-  return matchingIntervals;
+  return low;
+}
+
+
+
+/**
+ * Add the entries of a list and of its sublists that overlap with [start,end]. 
+   A binary search finds the first entry that ends at or after start; the following ones 
+   are overlapping until one starts after end. Only the sublists of overlapping entries 
+   can contain overlapping entries, so the work is proportional to the number of results 
+   plus one binary search per list visited.
+   The lists are walked with an explicit stack rather than by recursion, since they may be nested very deeply.
+ */
+static void containmentIndex_search (ContainmentIndex *containmentIndex, Array results, int list, int start, int end, int mode) 
+{
+  Array frames;  // of type NCListFrame, the lists being walked, innermost last
+  NCListFrame *currFrame;
+  NCList *currList;
+  NCListNode *currNode;
+
+  frames = arrayCreate (20,NCListFrame);
+  currFrame = arrayp (frames,0,NCListFrame);
+  currFrame->list = list;
+  currFrame->position = containmentIndex_findFirst (containmentIndex,list,start);
+  while (arrayMax (frames) > 0) {
+    currFrame = arrp (frames,arrayMax (frames) - 1,NCListFrame);
+    currList = arrp (containmentIndex->lists,currFrame->list,NCList);
+    currNode = currFrame->position < currList->count ? arrp (containmentIndex->nodes,currList->first + currFrame->position,NCListNode) : NULL;
+    if (currNode == NULL || currNode->start > end) {
+      arrayMax (frames)--;
+      continue;
+    }
+    currFrame->position++;
+    containmentIndex_report (containmentIndex,results,currNode->entry,start,end,mode);
+    if (currNode->sublist >= 0) {
+      currFrame = arrayp (frames,arrayMax (frames),NCListFrame);
+      currFrame->list = currNode->sublist;
+      currFrame->position = containmentIndex_findFirst (containmentIndex,currNode->sublist,start);
+    }
+  }
+  arrayDestroy (frames);
+}
+
+
+
+/**
+ * Get the number of a chromosome from its name, -1 if the index has no intervals on it.
+ */
+static int intervalIndex_getChromosomeNumber (IntervalIndex index, char *chromosome)
+{
+  void *value;
+
+  value = hashTable_getString (index->chromosomeNumbers,chromosome);
+  return value != NULL ? (int)(intptr_t)value - 1 : -1;
+}
+
+
+
+/**
+ * Get the number of a chromosome from its symbol id, -1 if the index has no intervals on it.
+ */
+static int intervalIndex_getChromosomeNumberById (IntervalIndex index, int chromosomeId)
+{
+  return chromosomeId >= 0 && chromosomeId < arrayMax (index->symbolChromosomes) ? arru (index->symbolChromosomes,chromosomeId,int) : -1;
+}
+
+
+
+/**
+ * Get the containment index of the intervals or of the subintervals on a chromosome.
+ * @return NULL if there are no entries to search
+ */
+static ContainmentIndex* intervalIndex_getContainmentIndex (IntervalIndex index, int number, int subIntervals)
+{
+  IntervalChromosome *currChromosome;
+  ContainmentIndex *containmentIndex;
+
+  if (number < 0) {
+    return NULL;
+  }
+  if (subIntervals && index->hasSubIntervals == 0) {
+    die ("The subintervals are not indexed, see intervalIndex_indexSubIntervals()");
+  }
+  currChromosome = arrp (index->chromosomes,number,IntervalChromosome);
+  containmentIndex = subIntervals ? &currChromosome->subIntervals : &currChromosome->intervals;
+  if (containmentIndex->entries == NULL || arrayMax (containmentIndex->entries) == 0) {
+    return NULL;
+  }
+  return containmentIndex;
+}
+
+
+
+static int intervalIndex_query (IntervalIndex index, int number, int start, int end, Array results, int mode)
+{
+  ContainmentIndex *containmentIndex;
+
+  arrayClear (results);
+  containmentIndex = intervalIndex_getContainmentIndex (index,number,mode == REPORT_SUBINTERVALS);
+  if (containmentIndex != NULL) {
+    containmentIndex_search (containmentIndex,results,0,start,end,mode);
+  }
+  return arrayMax (results);
+}
+
+
+
+/**
+ * Get the intervals of an index that overlap with the query interval. 
+   The index is only read, so several threads can query the same index at the same time, 
+   each with its own results Array.
+ * @param[in] index An IntervalIndex
+ * @param[in] chromosome Chromosome of the query interval
+ * @param[in] start Start of the query interval
+ * @param[in] end End of the query interval
+ * @param[in] results Array of type Interval*, owned by the caller. It is cleared and then filled with 
+   the overlapping intervals, which are owned by the index.
+ * @return The number of overlapping intervals
+ */
+int intervalIndex_getOverlappingIntervals (IntervalIndex index, char* chromosome, int start, int end, Array results)
+{
+  return intervalIndex_query (index,intervalIndex_getChromosomeNumber (index,chromosome),start,end,results,REPORT_INTERVALS);
+}
+
+
+
+/**
+ * Same as intervalIndex_getOverlappingIntervals(), with the chromosome given by its symbol id. 
+   This saves the hash lookup of the chromosome name, e.g. for the targetId of an MrfBlock.
+ * @param[in] chromosomeId Symbol id of the chromosome, see symbolTable_intern()
+ */
+int intervalIndex_getOverlappingIntervalsById (IntervalIndex index, int chromosomeId, int start, int end, Array results)
+{
+  return intervalIndex_query (index,intervalIndex_getChromosomeNumberById (index,chromosomeId),start,end,results,REPORT_INTERVALS);
+}
+
+
+
+/**
+ * Get the subintervals of an index that overlap with the query interval, 
+   without going through the subintervals of each overlapping interval.
+ * @param[in] index An IntervalIndex whose subintervals are indexed, see intervalIndex_indexSubIntervals()
+ * @param[in] chromosome Chromosome of the query interval
+ * @param[in] start Start of the query interval
+ * @param[in] end End of the query interval
+ * @param[in] results Array of type SubIntervalMatch, owned by the caller. It is cleared and then filled with 
+   the subintervals whose overlap with the query, rangeIntersection (start,end,subInterval->start,subInterval->end), 
+   is positive.
+ * @return The number of overlapping subintervals
+ */
+int intervalIndex_getOverlappingSubIntervals (IntervalIndex index, char* chromosome, int start, int end, Array results)
+{
+  return intervalIndex_query (index,intervalIndex_getChromosomeNumber (index,chromosome),start,end,results,REPORT_SUBINTERVALS);
+}
+
+
+
+/**
+ * Same as intervalIndex_getOverlappingSubIntervals(), with the chromosome given by its symbol id.
+ * @param[in] chromosomeId Symbol id of the chromosome, see symbolTable_intern()
+ */
+int intervalIndex_getOverlappingSubIntervalsById (IntervalIndex index, int chromosomeId, int start, int end, Array results)
+{
+  return intervalIndex_query (index,intervalIndex_getChromosomeNumberById (index,chromosomeId),start,end,results,REPORT_SUBINTERVALS);
+}
+
+
+
+/**
+ * Get the number of intervals in an index.
+ */
+int intervalIndex_getNumberOfIntervals (IntervalIndex index)
+{
+  return arrayMax (index->intervals);
+}
+
+
+
+/**
+ * Get the intervals of an index.
+ * @return An Array of type Interval, in the order in which they were read. 
+   It is owned by the index and must not be modified.
+ */
+Array intervalIndex_getIntervals (IntervalIndex index)
+{
+  return index->intervals;
+}
+
+
+
+/**
+ * Destroy an interval index and its intervals. 
+   The names and chromosomes are freed only if the index uses an arena of its own, see intervalIndex_create().
+ */
+void intervalIndex_destroy (IntervalIndex index)
+{
+  IntervalChromosome *currChromosome;
+  int i;
+
+  if (index == NULL) {
+    return;
+  }
+  for (i = 0; i < arrayMax (index->intervals); i++) {
+    arrayDestroy (arrp (index->intervals,i,Interval)->subIntervals);
+  }
+  arrayDestroy (index->intervals);
+  for (i = 0; i < arrayMax (index->chromosomes); i++) {
+    currChromosome = arrp (index->chromosomes,i,IntervalChromosome);
+    containmentIndex_clear (&currChromosome->intervals);
+    containmentIndex_clear (&currChromosome->subIntervals);
+  }
+  arrayDestroy (index->chromosomes);
+  hashTable_destroy (index->chromosomeNumbers);
+  arrayDestroy (index->symbolChromosomes);
+  if (index->ownsArena) {
+    arena_destroy (index->arena);
+  }
+  freeMem (index);
+}
+
+
+
+static IntervalCursor intervalCursor_createForEntries (IntervalIndex index, int subIntervals)
+{
+  IntervalCursor cursor;
+
+  AllocVar (cursor);
+  cursor->index = index;
+  cursor->subIntervals = subIntervals;
+  cursor->chromosome = -1;
+  cursor->window = arrayCreate (100,int);
+  cursor->matches = subIntervals ? arrayCreate (20,SubIntervalMatch) : NULL;
+  return cursor;
+}
+
+
+
+/**
+ * Create a cursor for queries that come sorted by chromosome and start, e.g. the blocks of a coordinate-sorted MRF file. 
+   The cursor keeps the intervals that may still overlap with the next query as a sliding window, 
+   so that a sweep through sorted queries costs amortized constant time per query plus the number of results. 
+   A query that moves backwards or to another chromosome refills the window with a lookup in the index.
+ * @param[in] index An IntervalIndex; it must not be changed while the cursor is used
+ * @return An IntervalCursor. Each thread needs its own.
+ */
+IntervalCursor intervalCursor_create (IntervalIndex index)
+{
+  return intervalCursor_createForEntries (index,0);
+}
+
+
+
+/**
+ * Create a cursor that sweeps through the subintervals of an index, see intervalCursor_create().
+ * @param[in] index An IntervalIndex whose subintervals are indexed, see intervalIndex_indexSubIntervals()
+ * @return An IntervalCursor for intervalCursor_getOverlappingSubIntervals()
+ */
+IntervalCursor intervalCursor_createForSubIntervals (IntervalIndex index)
+{
+  if (index->hasSubIntervals == 0) {
+    die ("The subintervals are not indexed, see intervalIndex_indexSubIntervals()");
+  }
+  return intervalCursor_createForEntries (index,1);
+}
+
+
+
+/**
+ * Refill the window with the entries that overlap with [start,end], found by a lookup in the index.
+ */
+static void intervalCursor_seek (IntervalCursor cursor, ContainmentIndex *containmentIndex, int number, int start, int end)
+{
+  int low,high,mid;
+
+  arrayClear (cursor->window);
+  containmentIndex_search (containmentIndex,cursor->window,0,start,end,REPORT_POSITIONS);
+  arraySort (cursor->window,(ARRAYORDERF)arrayIntcmp);
+  // the first entry that starts after end
+  low = 0;
+  high = arrayMax (containmentIndex->entries);
+  while (low < high) {
+    mid = low + (high - low) / 2;
+    if (arrp (containmentIndex->entries,mid,IntervalEntry)->start <= end) {
+      low = mid + 1;
+    }
+    else {
+      high = mid;
+    }
+  }
+  cursor->next = low;
+  cursor->chromosome = number;
+}
+
+
+
+/**
+ * Move the window to [start,end] and report the entries in it that overlap.
+   The window holds, in sort order, all entries before cursor->next that end at or after the previous start. 
+   Since starts do not decrease, an entry that ends before start is never needed again.
+ */
+static int intervalCursor_query (IntervalCursor cursor, int number, int start, int end, Array results, int mode)
+{
+  ContainmentIndex *containmentIndex;
+  IntervalEntry *entries;
+  int i,kept,count,position;
+
+  if ((mode == REPORT_SUBINTERVALS) != cursor->subIntervals) {
+    die ("The cursor was created for %s",cursor->subIntervals ? "subintervals" : "intervals");
+  }
+  arrayClear (results);
+  containmentIndex = intervalIndex_getContainmentIndex (cursor->index,number,cursor->subIntervals);
+  if (containmentIndex == NULL) {
+    cursor->chromosome = -1;
+    return 0;
+  }
+  if (number != cursor->chromosome || start < cursor->start) {
+    intervalCursor_seek (cursor,containmentIndex,number,start,end);
+  }
+  cursor->start = start;
+  entries = arrp (containmentIndex->entries,0,IntervalEntry);
+  count = arrayMax (containmentIndex->entries);
+  while (cursor->next < count && entries[cursor->next].start <= end) {
+    array (cursor->window,arrayMax (cursor->window),int) = cursor->next;
+    cursor->next++;
+  }
+  kept = 0;
+  for (i = 0; i < arrayMax (cursor->window); i++) {
+    position = arru (cursor->window,i,int);
+    if (entries[position].end < start) {
+      continue;
+    }
+    arru (cursor->window,kept,int) = position;
+    kept++;
+    if (entries[position].start <= end) {
+      containmentIndex_report (containmentIndex,results,position,start,end,mode);
+    }
+  }
+  arrayMax (cursor->window) = kept;
+  return arrayMax (results);
+}
+
+
+
+/**
+ * Get the intervals that overlap with the query interval. 
+   The queries should come sorted by chromosome and start; any order gives correct results, but is slower.
+ * @param[in] cursor An IntervalCursor
+ * @param[in] chromosome Chromosome of the query interval
+ * @param[in] start Start of the query interval
+ * @param[in] end End of the query interval
+ * @param[in] results Array of type Interval*, owned by the caller. It is cleared and then filled with 
+   the overlapping intervals, sorted by start and then by decreasing end.
+ * @return The number of overlapping intervals
+ */
+int intervalCursor_getOverlappingIntervals (IntervalCursor cursor, char* chromosome, int start, int end, Array results)
+{
+  return intervalCursor_query (cursor,intervalIndex_getChromosomeNumber (cursor->index,chromosome),start,end,results,REPORT_INTERVALS);
+}
+
+
+
+/**
+ * Same as intervalCursor_getOverlappingIntervals(), with the chromosome given by its symbol id.
+ * @param[in] chromosomeId Symbol id of the chromosome, see symbolTable_intern()
+ */
+int intervalCursor_getOverlappingIntervalsById (IntervalCursor cursor, int chromosomeId, int start, int end, Array results)
+{
+  return intervalCursor_query (cursor,intervalIndex_getChromosomeNumberById (cursor->index,chromosomeId),start,end,results,REPORT_INTERVALS);
+}
+
+
+
+/**
+ * Get the subintervals that overlap with the query interval, see intervalIndex_getOverlappingSubIntervals(). 
+   The queries should come sorted by chromosome and start; any order gives correct results, but is slower.
+ * @param[in] cursor An IntervalCursor created with intervalCursor_createForSubIntervals()
+ * @param[in] results Array of type SubIntervalMatch, owned by the caller, sorted by the start of the subintervals
+ * @return The number of overlapping subintervals
+ */
+int intervalCursor_getOverlappingSubIntervals (IntervalCursor cursor, char* chromosome, int start, int end, Array results)
+{
+  return intervalCursor_query (cursor,intervalIndex_getChromosomeNumber (cursor->index,chromosome),start,end,results,REPORT_SUBINTERVALS);
+}
+
+
+
+/**
+ * Same as intervalCursor_getOverlappingSubIntervals(), with the chromosome given by its symbol id.
+ * @param[in] chromosomeId Symbol id of the chromosome, see symbolTable_intern()
+ */
+int intervalCursor_getOverlappingSubIntervalsById (IntervalCursor cursor, int chromosomeId, int start, int end, Array results)
+{
+  return intervalCursor_query (cursor,intervalIndex_getChromosomeNumberById (cursor->index,chromosomeId),start,end,results,REPORT_SUBINTERVALS);
+}
+
+
+
+/**
+ * Get the subintervals that overlap with the query interval, collected in an Array of the cursor.
+ * @param[in] cursor An IntervalCursor created with intervalCursor_createForSubIntervals()
+ * @return Array of type SubIntervalMatch, sorted by the start of the subintervals. 
+   The memory belongs to the cursor and is overwritten by the next call.
+ * @see intervalCursor_getOverlappingSubIntervals()
+ */
+Array intervalCursor_getSubIntervalMatches (IntervalCursor cursor, char* chromosome, int start, int end)
+{
+  intervalCursor_getOverlappingSubIntervals (cursor,chromosome,start,end,cursor->matches);
+  return cursor->matches;
+}
+
+
+
+/**
+ * Same as intervalCursor_getSubIntervalMatches(), with the chromosome given by its symbol id.
+ * @param[in] chromosomeId Symbol id of the chromosome, see symbolTable_intern()
+ */
+Array intervalCursor_getSubIntervalMatchesById (IntervalCursor cursor, int chromosomeId, int start, int end)
+{
+  intervalCursor_getOverlappingSubIntervalsById (cursor,chromosomeId,start,end,cursor->matches);
+  return cursor->matches;
+}
+
+
+
+/**
+ * Destroy an interval cursor. The index is not affected.
+ */
+void intervalCursor_destroy (IntervalCursor cursor)
+{
+  if (cursor == NULL) {
+    return;
+  }
+  arrayDestroy (cursor->window);
+  arrayDestroy (cursor->matches);
+  freeMem (cursor);
+}
+
+
+
+/**
+ * Add intervals to the search space. 
+ * @param[in] fileName File name of the file that contains the interval and subintervals to search against. 
+   This tab-delimited file must have the following format:
+   
+   \verbatim
+   Column:   Description:
+   1         Name of the interval
+   2         Chromosome 
+   3         Strand
+   4         Interval start
+   5         Interval end
+   6         Number of subintervals
+   7         Subinterval starts (comma-delimited)
+   8         Subinterval end (comma-delimited)
+   \endverbatim
+
+   This is an example:
+   \verbatim
+   uc001aaw.1      chr1    +       357521  358460  1       357521  358460
+   uc001aax.1      chr1    +       410068  411702  3       410068,410854,411258    410159,411121,411702
+   uc001aay.1      chr1    -       552622  554252  3       552622,553203,554161    553066,553466,554252
+   uc001aaz.1      chr1    +       556324  557910  1       556324  557910
+   uc001aba.1      chr1    +       558011  558705  1       558011  558705
+   \endverbatim
+   Note in this example the intervals represent a transcripts, while the subintervals denote exons.
+
+ * @param[in] source An integer that specifies the source. This is useful when multiple files are used.
+ * @note Each call adds to the intervals of the previous ones; the search space is an IntervalIndex, 
+   see intervalIndex_create() for using several of them at once.
+*/
+void intervalFind_addIntervalsToSearchSpace (char* fileName, int source)
+{
+  if (defaultIndex == NULL) {
+    defaultIndex = intervalIndex_create (callerArena);
+  }
+  intervalIndex_addFile (defaultIndex,fileName,source);
+}
+
+
+
+/**
+ * Get the intervals that overlap with the query interval.
+ * @param[in] chromosome Chromosome of the query interval
+ * @param[in] start Start of the query interval
+ * @param[in] end End of the query interval
+ * @return An Array of Interval pointers. If no overlapping intervals are found, 
+   then an empty Array is returned
+ * @note The user is not allowed to modify the content of the array. 
+   The Array is reused by the next call, use intervalIndex_getOverlappingIntervals() from several threads.
+ * @pre Intervals were added to the search space, see intervalFind_addIntervalsToSearchSpace()
+ */
+Array intervalFind_getOverlappingIntervals (char* chromosome, int start, int end)
+{
+  static Array matchingIntervals = NULL;
+
+  if (matchingIntervals == NULL) {
+    matchingIntervals = arrayCreate (20,Interval*);
+  }
+  intervalIndex_getOverlappingIntervals (defaultIndex,chromosome,start,end,matchingIntervals);
+  return matchingIntervals;
+}
+
+
+
+/**
+ * Same as intervalFind_getOverlappingIntervals(), with the chromosome given by its symbol id.
+ * @param[in] chromosomeId Symbol id of the chromosome, see symbolTable_intern()
+ */
+Array intervalFind_getOverlappingIntervalsById (int chromosomeId, int start, int end)
+{
+  static Array matchingIntervals = NULL;
+
+  if (matchingIntervals == NULL) {
+    matchingIntervals = arrayCreate (20,Interval*);
+  }
+  intervalIndex_getOverlappingIntervalsById (defaultIndex,chromosomeId,start,end,matchingIntervals);
+  return matchingIntervals;
+}
+
+
+
+/**
+ * Get the IntervalIndex behind the search space, e.g. to create an IntervalCursor on it.
+ * @pre Intervals were added to the search space, see intervalFind_addIntervalsToSearchSpace()
+ */
+IntervalIndex intervalFind_getSearchSpace (void)
+{
+  return defaultIndex;
+}
+
+
+
+/**
+ * Get the total number of intervals that have been added to the search space.
+ * @return The total number of intervals in the search space.
+ * @pre Intervals were added to the search space using intervalFind_addIntervalsToSearchSpace()
+ */
+int intervalFind_getNumberOfIntervals (void)
+{
+  return intervalIndex_getNumberOfIntervals (defaultIndex);
+}
+
+
+
+/**
+ * Retrieve all the intervals that have been added to the search space.
+ * @return An Array of type Interval.
+ * @note This function generates a copy of the intervals array. 
+ * @pre Intervals were added to the search space using intervalFind_addIntervalsToSearchSpace().
+ */
+Array intervalFind_getAllIntervals (void)
+{
+  return arrayCopy (intervalIndex_getIntervals (defaultIndex));
+}
+
+
+
+/**
+ * Get an array of Interval pointers from the intervals that have been added to the search space.
+ * @return An Array of type Interval pointers.
+ * @note The user is not allowed to modify the content of the array. 
+ * @pre Intervals were added to the search space using intervalFind_addIntervalsToSearchSpace().
+ */
+Array intervalFind_getIntervalPointers (void)
+{
+  Array intervals;
+  Array intervalPointers;
+  int i;
+
+  intervals = intervalIndex_getIntervals (defaultIndex);
+  intervalPointers = arrayCreate (arrayMax (intervals),Interval*);
+  for (i = 0; i < arrayMax (intervals); i++) {
+    array (intervalPointers,arrayMax (intervalPointers),Interval*) = arrp (intervals,i,Interval);
+  }
+  return intervalPointers;
 }
 
 
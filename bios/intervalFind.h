@@ -10,6 +10,10 @@
 
 
 
+#include "common.h"
+
+
+
 /**
  * Interval.
  */
@@ -36,13 +40,61 @@ typedef struct {
 
 
 
+/**
+ * A subinterval that overlaps with a query, see intervalIndex_getOverlappingSubIntervals().
+ */
+typedef struct {
+  Interval *interval;
+  SubInterval *subInterval;
+  int overlap;  // rangeIntersection() of the query and the subinterval
+} SubIntervalMatch;
+
+
+
+/**
+ * IntervalIndex.
+ */
+typedef struct _intervalIndexStruct_ *IntervalIndex;
+
+/**
+ * IntervalCursor. Answers a stream of queries that come sorted by chromosome and start, see intervalCursor_create().
+ * Queries that are only close to sorted, such as the blocks of read1 (or of read2) of a coordinate-sorted MRF file, 
+ * are answered correctly as well, at the cost of an index lookup whenever a query moves backwards. 
+ * Use one cursor per stream of queries.
+ */
+typedef struct _intervalCursorStruct_ *IntervalCursor;
+
+
+
+extern IntervalIndex intervalIndex_create (Arena arena);
+extern void intervalIndex_addFile (IntervalIndex index, char* fileName, int source);
+extern int intervalIndex_getOverlappingIntervals (IntervalIndex index, char* chromosome, int start, int end, Array results);
+extern int intervalIndex_getOverlappingIntervalsById (IntervalIndex index, int chromosomeId, int start, int end, Array results);
+extern void intervalIndex_indexSubIntervals (IntervalIndex index);
+extern int intervalIndex_getOverlappingSubIntervals (IntervalIndex index, char* chromosome, int start, int end, Array results);
+extern int intervalIndex_getOverlappingSubIntervalsById (IntervalIndex index, int chromosomeId, int start, int end, Array results);
+extern int intervalIndex_getNumberOfIntervals (IntervalIndex index);
+extern Array intervalIndex_getIntervals (IntervalIndex index);
+extern void intervalIndex_destroy (IntervalIndex index);
+extern IntervalCursor intervalCursor_create (IntervalIndex index);
+extern int intervalCursor_getOverlappingIntervals (IntervalCursor cursor, char* chromosome, int start, int end, Array results);
+extern int intervalCursor_getOverlappingIntervalsById (IntervalCursor cursor, int chromosomeId, int start, int end, Array results);
+extern IntervalCursor intervalCursor_createForSubIntervals (IntervalIndex index);
+extern int intervalCursor_getOverlappingSubIntervals (IntervalCursor cursor, char* chromosome, int start, int end, Array results);
+extern int intervalCursor_getOverlappingSubIntervalsById (IntervalCursor cursor, int chromosomeId, int start, int end, Array results);
+extern Array intervalCursor_getSubIntervalMatches (IntervalCursor cursor, char* chromosome, int start, int end);
+extern Array intervalCursor_getSubIntervalMatchesById (IntervalCursor cursor, int chromosomeId, int start, int end);
+extern void intervalCursor_destroy (IntervalCursor cursor);
 extern void intervalFind_addIntervalsToSearchSpace (char* fileName, int source);
 extern Array intervalFind_getOverlappingIntervals (char* chromosome, int start, int end);
+extern Array intervalFind_getOverlappingIntervalsById (int chromosomeId, int start, int end);
+extern IntervalIndex intervalFind_getSearchSpace (void);
 extern int intervalFind_getNumberOfIntervals (void);
 extern Array intervalFind_getAllIntervals (void);
 extern Array intervalFind_getIntervalPointers (void);
 extern Array intervalFind_parseFile (char* fileName, int source);
 extern void intervalFind_parseLine (Interval *thisInterval, char* line, int source);
+extern void intervalFind_setArena (Arena arena);
 extern char* intervalFind_writeInterval (Interval *currInterval);
 
 
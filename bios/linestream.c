@@ -47,6 +47,9 @@
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include PLABLA_INCLUDE_IO_UNISTD
 
 #include "log.h"
@@ -55,20 +58,55 @@
 #include "linestream.h"
 
 
+#define LS_BLOCK_SIZE 1048576  /* bytes read at once from files and pipes */
+#define LS_READAHEAD_ENV "LS_READAHEAD"  /* environment variable with the default of ls_readAheadSet() */
+
+
+struct _lsReadAheadStruct_ {
+  pthread_t thread ;
+  pthread_mutex_t mutex ;
+  pthread_cond_t cond ;   /* signalled whenever a block is filled or taken */
+  char **blocks ;         /* ring buffer, block i % blockCnt holds the i-th block of the input */
+  int *lengths ;          /* number of bytes in each block, 0 at the end of the input */
+  int blockCnt ;
+  long nextFill ;
+  long nextTake ;
+  int takeOffset ;        /* bytes of block nextTake already taken */
+  int err ;               /* errno of a failed read, 0 otherwise */
+  int stop ;
+} ;
+
+
 static char *nextLineFile (LineStream this1);
+static char *nextLineBgzf (LineStream this1);
+static char *nextLineMmap (LineStream this1);
 static char *nextLinePipe (LineStream this1);
 static char *nextLineBuffer (LineStream this1);
 static void register_nextLine (LineStream this1,char *(*f)(LineStream this1));
+static void readAheadStop (LineStream this1);
+
+
+
+static int readAheadDefault (void)
+{ /* number of blocks to read ahead unless ls_readAheadSet() is called */
+  char *value = getenv (LS_READAHEAD_ENV) ;
+  return value ? atoi (value) : 0 ;
+}
 
 
 /**
  * Creates a line stream from a file.
+ * Regular files are memory-mapped, so that concurrent readers of the same file share the page cache.
+ * Gzip files are decompressed in-process; block-compressed gzip files (BGZF, see bgzf.c) are inflated 
+ * by several threads and can be positioned with ls_seek().
  * @param[in] fn File name ("-" means stdin)
  * @return  A line stream object, NULL if file could not been opened; to learn details call warnReport() from module log.c
  */
 LineStream ls_createFromFile (char *fn)
 { 
   LineStream this1;
+  struct stat st;
+  int c;
 
   if (!fn)
     die ("ls_createFromFile: no file name given");
@@ -86,13 +124,208 @@ LineStream ls_createFromFile (char *fn)
     hlr_free (this1);
     return NULL;
   }
-  register_nextLine (this1,nextLineFile);
+  this1->bgzf = NULL ;
+  this1->map = NULL ;
+  c = getc (this1->fp) ;
+  if (c != EOF)
+    ungetc (c,this1->fp) ;
+  if (c == 0x1f) { /* gzip magic */
+    this1->bgzf = bgzf_createReader (this1->fp) ;
+    register_nextLine (this1,nextLineBgzf);
+  }
+  else if (c != EOF && this1->fp != stdin && 
+           fstat (fileno (this1->fp),&st) == 0 && S_ISREG (st.st_mode) &&
+           (this1->map = mmap (NULL,st.st_size,PROT_READ,MAP_SHARED,fileno (this1->fp),0)) != MAP_FAILED) {
+    this1->mapSize = st.st_size ;
+    madvise (this1->map,this1->mapSize,MADV_SEQUENTIAL) ;
+    register_nextLine (this1,nextLineMmap);
+  }
+  else {
+    this1->map = NULL ;
+    register_nextLine (this1,nextLineFile);
+  }
   this1->buffer = NULL ;
+  this1->offset = 0 ;
+  this1->lineOffset = 0 ;
+  this1->blockPos = this1->blockEnd = this1->blockEof = 0 ;
+  this1->readAheadCnt = readAheadDefault () ;
+  this1->readAhead = NULL ;
+  this1->readAheadOffset = 0 ;
   return this1;
 }
 
 
 
+static void *readAheadThread (void *data)
+{ /* fills the blocks of the read-ahead ring buffer from the file or pipe */
+  LineStream this1 = (LineStream) data ;
+  struct _lsReadAheadStruct_ *ra = this1->readAhead ;
+  int slot ;
+  int n ;
+
+  pthread_mutex_lock (&ra->mutex) ;
+  while (!ra->stop) {
+    if (ra->nextFill - ra->nextTake >= ra->blockCnt ||
+        (ra->nextFill > 0 && ra->lengths[(ra->nextFill-1) % ra->blockCnt] == 0)) {
+      pthread_cond_wait (&ra->cond,&ra->mutex) ;
+      continue ;
+    }
+    slot = ra->nextFill % ra->blockCnt ;
+    pthread_mutex_unlock (&ra->mutex) ;
+    n = fread (ra->blocks[slot],1,LS_BLOCK_SIZE,this1->fp) ;
+    pthread_mutex_lock (&ra->mutex) ;
+    if (n == 0 && ferror (this1->fp))
+      ra->err = errno ? errno : EIO ;
+    ra->lengths[slot] = n ;
+    ra->nextFill++ ;
+    pthread_cond_broadcast (&ra->cond) ;
+  }
+  pthread_mutex_unlock (&ra->mutex) ;
+  return NULL ;
+}
+
+
+
+static void readAheadStart (LineStream this1)
+{ 
+  struct _lsReadAheadStruct_ *ra ;
+  int i ;
+
+  ra = (struct _lsReadAheadStruct_ *) hlr_calloc (1,sizeof (struct _lsReadAheadStruct_)) ;
+  ra->blockCnt = this1->readAheadCnt ;
+  ra->blocks = (char **) hlr_malloc (ra->blockCnt * sizeof (char *)) ;
+  ra->lengths = (int *) hlr_malloc (ra->blockCnt * sizeof (int)) ;
+  for (i = 0; i < ra->blockCnt; i++)
+    ra->blocks[i] = hlr_malloc (LS_BLOCK_SIZE) ;
+  pthread_mutex_init (&ra->mutex,NULL) ;
+  pthread_cond_init (&ra->cond,NULL) ;
+  this1->readAhead = ra ;
+  if (pthread_create (&ra->thread,NULL,readAheadThread,this1) != 0)
+    die ("readAheadStart: unable to create thread") ;
+}
+
+
+
+static void readAheadStop (LineStream this1)
+{ /* stops the read-ahead thread; data it has read but not handed out is lost */
+  struct _lsReadAheadStruct_ *ra = this1->readAhead ;
+  int i ;
+
+  if (!ra)
+    return ;
+  pthread_mutex_lock (&ra->mutex) ;
+  ra->stop = 1 ;
+  pthread_cond_broadcast (&ra->cond) ;
+  pthread_mutex_unlock (&ra->mutex) ;
+  pthread_join (ra->thread,NULL) ;
+  pthread_mutex_destroy (&ra->mutex) ;
+  pthread_cond_destroy (&ra->cond) ;
+  for (i = 0; i < ra->blockCnt; i++)
+    hlr_free (ra->blocks[i]) ;
+  hlr_free (ra->blocks) ;
+  hlr_free (ra->lengths) ;
+  hlr_free (ra) ;
+  this1->readAhead = NULL ;
+}
+
+
+
+static int readAheadTake (LineStream this1, char *dest, int maxLen)
+{ /* copies up to maxLen bytes of the next filled block to dest;
+     returns the number of bytes copied, 0 at the end of the input */
+  struct _lsReadAheadStruct_ *ra ;
+  int slot ;
+  int n ;
+
+  if (!this1->readAhead)
+    readAheadStart (this1) ;
+  ra = this1->readAhead ;
+  slot = ra->nextTake % ra->blockCnt ;
+  pthread_mutex_lock (&ra->mutex) ;
+  while (ra->nextTake == ra->nextFill)
+    pthread_cond_wait (&ra->cond,&ra->mutex) ;
+  pthread_mutex_unlock (&ra->mutex) ;
+  if (ra->err)
+    die ("nextLineBlock: %s",strerror (ra->err)) ;
+  n = MIN (maxLen,ra->lengths[slot] - ra->takeOffset) ;
+  if (n == 0)
+    return 0 ;
+  memcpy (dest,ra->blocks[slot] + ra->takeOffset,n) ;
+  ra->takeOffset += n ;
+  if (ra->takeOffset == ra->lengths[slot]) {
+    pthread_mutex_lock (&ra->mutex) ;
+    ra->nextTake++ ;
+    ra->takeOffset = 0 ;
+    pthread_cond_broadcast (&ra->cond) ;
+    pthread_mutex_unlock (&ra->mutex) ;
+  }
+  return n ;
+}
+
+
+
+static char *nextLineBlock (LineStream this1, int *ll)
+{ /* returns the next line of a file or pipe, which is read in blocks of
+     LS_BLOCK_SIZE bytes; the line points into the read buffer and is
+     terminated by replacing \n or \r\n with \0
+     input: line stream object
+     output: the line, NULL if no further line was found
+             *ll: number of bytes consumed, including the line end
+  */
+  char *start ;
+  char *end ;
+  int n ;
+
+  if (!this1->line) {
+    this1->lineLen = LS_BLOCK_SIZE + 1 ;
+    this1->line = hlr_malloc (this1->lineLen) ;
+  }
+  while (1) {
+    start = this1->line + this1->blockPos ;
+    n = this1->blockEnd - this1->blockPos ;
+    if ((end = memchr (start,'\n',n))) {
+      *ll = end - start + 1 ;
+      this1->blockPos += *ll ;
+      *end = '\0' ;
+      if (end > start && end[-1] == '\r')
+        end[-1] = '\0' ;
+      return start ;
+    }
+    if (this1->blockEof) {
+      if (n == 0)
+        return NULL ;
+      /* last line without \n */
+      *ll = n ;
+      this1->blockPos = this1->blockEnd ;
+      start[n] = '\0' ;
+      if (start[n-1] == '\r')
+        start[n-1] = '\0' ;
+      return start ;
+    }
+    /* move the incomplete line to the front and make room for at least half a block */
+    memmove (this1->line,start,n) ;
+    this1->blockPos = 0 ;
+    this1->blockEnd = n ;
+    if (this1->lineLen - 1 - n < LS_BLOCK_SIZE / 2) {
+      this1->lineLen = 2 * this1->lineLen ;
+      if (!(this1->line = realloc (this1->line,this1->lineLen)))
+        die ("nextLineBlock: realloc") ;
+    }
+    if (this1->readAheadCnt > 0)
+      n = readAheadTake (this1,this1->line + this1->blockEnd,this1->lineLen - 1 - this1->blockEnd) ;
+    else {
+      n = fread (this1->line + this1->blockEnd,1,this1->lineLen - 1 - this1->blockEnd,this1->fp) ;
+      if (n == 0 && ferror (this1->fp))
+        die ("nextLineBlock: %s",strerror (errno)) ;
+    }
+    if (n == 0)
+      this1->blockEof = 1 ;
+    this1->blockEnd += n ;
+  }
+}
+
+
+
 /** 
  * Returns the next line of a file and closes the file if no further line was found. The line can be of any length.
  * A trailing \n or \r\n is removed.
@@ -102,11 +335,36 @@ LineStream ls_createFromFile (char *fn)
  */
 static char *nextLineFile (LineStream this1)
 { 
+  char *s;
   int ll;
 
   if (!this1)
     die ("nextLineFile: NULL LineStream");
-  if (!(ll = getLine (this1->fp,&this1->line,&this1->lineLen))) {
+  if (!(s = nextLineBlock (this1,&ll))) {
+    readAheadStop (this1);
+    fclose (this1->fp);
+    this1->fp = NULL;
+    hlr_free (this1->line);
+    return NULL;
+  }
+  this1->lineOffset = this1->offset;
+  this1->offset += ll;
+  this1->count++;
+  return s;
+}
+
+
+
+static char *nextLineBgzf (LineStream this1)
+{ /* like nextLineFile(), but decompresses a BGZF file; lineOffset is a virtual file offset */
+  int ll;
+
+  if (!this1)
+    die ("nextLineBgzf: NULL LineStream");
+  this1->lineOffset = bgzf_tell (this1->bgzf);
+  if (!(ll = bgzf_getLine (this1->bgzf,&this1->line,&this1->lineLen))) {
+    bgzf_destroy (this1->bgzf);
+    this1->bgzf = NULL;
     fclose (this1->fp);
     this1->fp = NULL;
     hlr_free (this1->line);
@@ -122,6 +380,53 @@ static char *nextLineFile (LineStream this1)
 
 
 
+static char *nextLineMmap (LineStream this1)
+{ /* like nextLineFile(), but for a memory-mapped file; the line is copied 
+     out of the mapping, which stays read-only and shared with other processes */
+  char *start ;
+  char *end ;
+  off_t n ;
+  int len ;
+
+  if (!this1)
+    die ("nextLineMmap: NULL LineStream");
+  if (this1->offset >= this1->mapSize) {
+    munmap (this1->map,this1->mapSize);
+    this1->map = NULL;
+    fclose (this1->fp);
+    this1->fp = NULL;
+    hlr_free (this1->line);
+    return NULL;
+  }
+  if (this1->readAheadCnt > 0 && 
+      this1->offset + (off_t) (this1->readAheadCnt - 1) * LS_BLOCK_SIZE >= this1->readAheadOffset &&
+      this1->readAheadOffset < this1->mapSize) {
+    /* ask the kernel to fetch the next blocks while the current one is processed */
+    n = MIN ((off_t) this1->readAheadCnt * LS_BLOCK_SIZE,this1->mapSize - this1->readAheadOffset);
+    madvise (this1->map + this1->readAheadOffset,n,MADV_WILLNEED);
+    this1->readAheadOffset += n;
+  }
+  start = this1->map + this1->offset;
+  n = this1->mapSize - this1->offset;
+  end = memchr (start,'\n',n);
+  len = end ? end - start : n;
+  if (!this1->line || len + 1 > this1->lineLen) {
+    hlr_free (this1->line);
+    this1->lineLen = MAX (2 * (len + 1),1000);
+    this1->line = hlr_malloc (this1->lineLen);
+  }
+  memcpy (this1->line,start,len);
+  this1->line[len] = '\0';
+  if (len > 0 && this1->line[len-1] == '\r')
+    this1->line[len-1] = '\0';
+  this1->lineOffset = this1->offset;
+  this1->offset += end ? len + 1 : len;
+  this1->count++;
+  return this1->line;
+}
+
+
+
 /** 
  * Creates a line stream from a pipe.
  * Example: ls_createFromPipe ("zcat test.dat.Z");
@@ -147,6 +452,9 @@ LineStream ls_createFromPipe (char *command)
   }
   register_nextLine (this1,nextLinePipe);
   this1->buffer = NULL ;
+  this1->blockPos = this1->blockEnd = this1->blockEof = 0 ;
+  this1->readAheadCnt = readAheadDefault () ;
+  this1->readAhead = NULL ;
   return this1;
 }
 
@@ -160,22 +468,20 @@ static char *nextLinePipe (LineStream this1)
      output: the line
              NULL if no further line was found
   */
+  char *s;
   int ll;
 
   if (!this1)
     die ("nextLinePipe: NULL LineStream");
-  if (!(ll = getLine (this1->fp,&this1->line,&this1->lineLen))) {
+  if (!(s = nextLineBlock (this1,&ll))) {
+    readAheadStop (this1);
     this1->status = PLABLA_PCLOSE (this1->fp);
     this1->fp = NULL;
     hlr_free (this1->line);
     return NULL;
   }
-  if (ll > 1 && this1->line[ll-2] == '\r')
-    this1->line[ll-2] = '\0';
-  else if (ll > 0 && this1->line[ll-1] == '\n')
-    this1->line[ll-1] = '\0';
   this1->count++;
-  return this1->line;
+  return s;
 }
 
 
@@ -254,17 +560,29 @@ void ls_destroy_func (LineStream this1)
     return ;
 
   if (this1->nextLine_hook == nextLinePipe && this1->fp) {
+    readAheadStop (this1);
     while (fgets (line,sizeof (line),this1->fp)) {}
     this1->status = PLABLA_PCLOSE (this1->fp);
     hlr_free (this1->line);
   }
   else if (this1->nextLine_hook == nextLineFile && this1->fp) {
+    readAheadStop (this1);
     /* if (this1->fp == stdin) */
     if (!PLABLA_ISATTY(fileno(this1->fp)))
       while (fgets (line,sizeof (line),this1->fp)) {}
     fclose (this1->fp);
     hlr_free (this1->line);
   }
+  else if (this1->nextLine_hook == nextLineBgzf && this1->fp) {
+    bgzf_destroy (this1->bgzf);
+    fclose (this1->fp);
+    hlr_free (this1->line);
+  }
+  else if (this1->nextLine_hook == nextLineMmap && this1->fp) {
+    munmap (this1->map,this1->mapSize);
+    fclose (this1->fp);
+    hlr_free (this1->line);
+  }
   else if (this1->nextLine_hook == nextLineBuffer && this1->wi) {
     wordIterDestroy (this1->wi);
   }
@@ -341,6 +659,64 @@ void ls_back(LineStream this1, int lineCnt)
 
 
 
+/**
+ * Byte offset of the line that the next call to ls_nextLine() will return.
+ * For BGZF files this is a virtual file offset, see bgzf.h.
+ * @param[in] this1 A line stream created by ls_createFromFile()
+ * @return Offset suitable for ls_seek()
+ */
+off_t ls_tell(LineStream this1) 
+{ 
+  if (this1->nextLine_hook != nextLineFile && this1->nextLine_hook != nextLineBgzf && 
+      this1->nextLine_hook != nextLineMmap)
+    die("ls_tell() only works on file streams") ;
+  if (this1->bgzf && bgzf_tell (this1->bgzf) < 0)
+    die("ls_tell() does not work on gzip files that are not block-compressed (BGZF)") ;
+  if (this1->buffer && this1->bufferBack)
+    return this1->lineOffset ;
+  if (this1->bgzf)
+    return bgzf_tell (this1->bgzf) ;
+  return this1->offset ;
+}
+
+
+
+/**
+ * Position a line stream such that the next call to ls_nextLine() returns the line starting at 'offset'.
+ * @param[in] this1 A line stream created by ls_createFromFile() on a seekable file that is not yet at its end
+ * @param[in] offset Offset obtained from ls_tell()
+ * @note ls_lineCountGet() is not meaningful after a seek
+ */
+void ls_seek(LineStream this1, off_t offset) 
+{ 
+  if (this1->nextLine_hook != nextLineFile && this1->nextLine_hook != nextLineBgzf && 
+      this1->nextLine_hook != nextLineMmap)
+    die("ls_seek() only works on file streams") ;
+  if (!this1->fp)
+    die("ls_seek() after end of file") ;
+  if (this1->bgzf)
+    bgzf_seek(this1->bgzf, offset) ;
+  else if (this1->map) {
+    if (offset > this1->mapSize)
+      die("ls_seek(): offset beyond end of file") ;
+    this1->readAheadOffset = offset - offset % LS_BLOCK_SIZE ;
+  }
+  else {
+    readAheadStop(this1) ;  /* restarted at the new position by the next read */
+    if (fseeko(this1->fp, offset, SEEK_SET) != 0)
+      die("ls_seek(): %s", strerror(errno)) ;
+  }
+  this1->offset = offset ;
+  this1->lineOffset = offset ;
+  this1->blockPos = this1->blockEnd = this1->blockEof = 0 ;
+  if (this1->buffer) {
+    this1->bufferBack = 0 ;
+    this1->bufferLine = "" ;  /* dummy, like in ls_bufferSet() */
+  }
+}
+
+
+
 /**
  * Set how many lines the linestream should buffer.
  * @param[in] this1 A line stream 
@@ -361,6 +737,27 @@ void ls_bufferSet(LineStream this1, int lineCnt)
 
 
 
+/**
+ * Set how many blocks of LS_BLOCK_SIZE bytes a background thread reads ahead of the consumer, so that
+   waiting for I/O overlaps with processing. For memory-mapped files, the kernel is asked to fetch
+   as many blocks ahead (madvise MADV_WILLNEED) and no thread is used.
+   The default is taken from the environment variable LS_READAHEAD, else 0 (no read-ahead).
+ * @param[in] this1 A line stream created by ls_createFromFile() or ls_createFromPipe()
+ * @param[in] blockCnt Number of blocks, 0 to turn read-ahead off; 2 gives triple buffering
+ * @pre No line has been read yet
+ * @note Gzip files have their own read-ahead, see bgzf_setNumThreads().
+ */
+void ls_readAheadSet(LineStream this1, int blockCnt)
+{ 
+  if (this1->count || this1->readAhead)
+    die("ls_readAheadSet() too late") ;
+  if (this1->nextLine_hook == nextLineBuffer)
+    return ;
+  this1->readAheadCnt = blockCnt ;
+}
+
+
+
 /** 
  * Returns the number of the current line.
  * @param[in] this1 A line stream 
@@ -389,6 +786,25 @@ int ls_skipStatusGet(LineStream this1)
   }
   else if (this1->nextLine_hook == nextLineFile) {
     if (this1->fp) {
+      readAheadStop (this1);
+      fclose (this1->fp);
+      this1->fp = NULL;
+      hlr_free (this1->line);
+    }
+  }
+  else if (this1->nextLine_hook == nextLineMmap) {
+    if (this1->fp) {
+      munmap (this1->map,this1->mapSize);
+      this1->map = NULL;
+      fclose (this1->fp);
+      this1->fp = NULL;
+      hlr_free (this1->line);
+    }
+  }
+  else if (this1->nextLine_hook == nextLineBgzf) {
+    if (this1->fp) {
+      bgzf_destroy (this1->bgzf);
+      this1->bgzf = NULL;
       fclose (this1->fp);
       this1->fp = NULL;
       hlr_free (this1->line);
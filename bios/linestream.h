@@ -35,7 +35,9 @@
 #ifndef _nextline_h_
 #define _nextline_h_
 
+#include <sys/types.h>
 #include "format.h"
+#include "bgzf.h"
 
 /**
  * LineStream.
@@ -45,7 +47,7 @@ typedef struct _lineStreamStruct_ {
      LineStream module -- DO NOT access from outside
      the LineStream module */
   FILE *fp;
-  char *line;
+  char *line;         /* file and pipe streams: read buffer, see blockPos */
   int lineLen;
   WordIter wi;
   int count;
@@ -55,6 +57,18 @@ typedef struct _lineStreamStruct_ {
                          used for remembering last line seen */
   char *bufferLine ;  /* pointer to 'buffer' or NULL if EOF */
   int bufferBack ;    /* 0=normal, 1=take next line from buffer */
+  Bgzf bgzf ;         /* NULL unless the file is block-compressed (BGZF) */
+  int blockPos ;      /* file and pipe streams: start of the unread data in 'line' */
+  int blockEnd ;      /* file and pipe streams: end of the data read into 'line' */
+  int blockEof ;      /* file and pipe streams: 1 if the end of the input was reached */
+  char *map ;         /* regular files: the memory-mapped file, NULL otherwise */
+  off_t mapSize ;
+  int readAheadCnt ;  /* number of blocks to read ahead, see ls_readAheadSet() */
+  struct _lsReadAheadStruct_ *readAhead ; /* file and pipe streams: NULL unless the read-ahead thread runs */
+  off_t readAheadOffset ; /* memory-mapped files: end of the range requested from the kernel */
+  off_t offset ;      /* file streams only: byte offset of the next line to be read */
+  off_t lineOffset ;  /* file streams only: byte offset of the line returned last,
+                         virtual file offset (see bgzf.h) for BGZF files */
 } *LineStream;
 
 extern LineStream ls_createFromFile (char *fn);
@@ -73,5 +87,8 @@ extern void ls_cat(LineStream this1, char *filename) ;
 extern int ls_skipStatusGet(LineStream this1) ;
 extern int ls_isEof(LineStream this1) ;
 extern void ls_bufferSet(LineStream this1, int lineCnt) ;
+extern void ls_readAheadSet(LineStream this1, int blockCnt) ;
 extern void ls_back(LineStream this1, int lineCnt) ;
+extern off_t ls_tell(LineStream this1) ;
+extern void ls_seek(LineStream this1, off_t offset) ;
 #endif
@@ -0,0 +1,179 @@
+#include <errno.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include "log.h"
+#include "format.h"
+#include "hlrmisc.h"
+#include "common.h"
+#include "bgzf.h"
+#include "outStream.h"
+
+
+
+/**
+ *   \file outStream.c Buffered output to a file or stdout, optionally compressed as BGZF (see bgzf.c). 
+ *   Compressed output is deflated by several threads and can be read by zcat, gunzip and ls_createFromFile().
+ */
+
+
+
+struct _outStreamStruct_ {
+  FILE *fp;
+  Bgzf bgzf;         // NULL if the output is not compressed
+  Stringa buffer;    // pending output
+};
+
+
+
+static int outStream_hasGzipSuffix (char *fileName)
+{
+  int length;
+
+  length = strlen (fileName);
+  return length > 3 && strEqual (fileName + length - 3,".gz");
+}
+
+
+
+/**
+ * Create an output stream. The output is compressed if the file name ends in ".gz", or if the environment variable
+ * OUTSTREAM_COMPRESS is set; its value is the zlib compression level (1-9), the default level is used otherwise. 
+ * In the latter case ".gz" is appended to the file name if it is missing.
+ * @param[in] fileName File name, use "-" to denote stdout
+ */
+OutStream outStream_create (char *fileName)
+{
+  OutStream stream;
+  Stringa name;
+  char *level;
+
+  level = getenv (OUTSTREAM_COMPRESS_ENV);
+  name = stringCreate (100);
+  stringCpy (name,fileName);
+  if (level != NULL && !strEqual (fileName,"-") && !outStream_hasGzipSuffix (fileName)) {
+    stringCat (name,".gz");
+  }
+  AllocVar (stream);
+  if (strEqual (fileName,"-")) {
+    stream->fp = stdout;
+  }
+  else if (!(stream->fp = fopen (string (name),"w"))) {
+    die ("Unable to open file: %s",string (name));
+  }
+  if (level != NULL || outStream_hasGzipSuffix (fileName)) {
+    stream->bgzf = bgzf_createWriter (stream->fp,level != NULL && isdigit (level[0]) ? atoi (level) : -1);
+  }
+  stream->buffer = stringCreate (OUTSTREAM_BUFFER_SIZE + 1000);
+  stringDestroy (name);
+  return stream;
+}
+
+
+
+/**
+ * Check whether the stream compresses its output.
+ */
+int outStream_isCompressed (OutStream stream)
+{
+  return stream->bgzf != NULL;
+}
+
+
+
+/**
+ * Write the pending output to the file, or hand it to the compressor.
+ */
+void outStream_flush (OutStream stream)
+{
+  int length;
+
+  length = stringLen (stream->buffer);
+  if (length > 0) {
+    if (stream->bgzf != NULL) {
+      bgzf_write (stream->bgzf,string (stream->buffer),length);
+    }
+    else if (fwrite (string (stream->buffer),1,length,stream->fp) != length) {
+      die ("outStream_flush: %s",strerror (errno));
+    }
+    stringClear (stream->buffer);
+  }
+}
+
+
+
+/**
+ * Append length bytes of data to the stream.
+ */
+void outStream_write (OutStream stream, char *data, int length)
+{
+  int i;
+
+  i = arrayMax (stream->buffer) - 1;
+  array (stream->buffer,i + length,char) = '\0';
+  memcpy (arrp (stream->buffer,i,char),data,length);
+  if (stringLen (stream->buffer) >= OUTSTREAM_BUFFER_SIZE) {
+    outStream_flush (stream);
+  }
+}
+
+
+
+/**
+ * Append a string followed by a newline to the stream.
+ */
+void outStream_puts (OutStream stream, char *s)
+{
+  stringCat (stream->buffer,s);
+  stringCatChar (stream->buffer,'\n');
+  if (stringLen (stream->buffer) >= OUTSTREAM_BUFFER_SIZE) {
+    outStream_flush (stream);
+  }
+}
+
+
+
+/**
+ * Append formatted output to the stream, like printf().
+ */
+void outStream_printf (OutStream stream, char *format, ...)
+{
+  va_list args;
+  int i,length;
+
+  i = arrayMax (stream->buffer) - 1;
+  va_start (args,format);
+  length = vsnprintf (NULL,0,format,args);
+  va_end (args);
+  array (stream->buffer,i + length,char) = '\0';
+  va_start (args,format);
+  vsnprintf (arrp (stream->buffer,i,char),length + 1,format,args);
+  va_end (args);
+  if (stringLen (stream->buffer) >= OUTSTREAM_BUFFER_SIZE) {
+    outStream_flush (stream);
+  }
+}
+
+
+
+/**
+ * Flush and destroy the stream. Compressed streams are terminated with an end-of-file block.
+ * @note The file is closed unless it is stdout.
+ */
+void outStream_destroy (OutStream stream)
+{
+  if (stream == NULL) {
+    return;
+  }
+  outStream_flush (stream);
+  if (stream->bgzf != NULL) {
+    bgzf_destroy (stream->bgzf);
+  }
+  if (stream->fp == stdout) {
+    fflush (stdout);
+  }
+  else {
+    fclose (stream->fp);
+  }
+  stringDestroy (stream->buffer);
+  freeMem (stream);
+}
@@ -0,0 +1,41 @@
+#ifndef DEF_OUT_STREAM_H
+#define DEF_OUT_STREAM_H
+
+
+
+/**
+ *   \file outStream.h
+ */
+
+
+
+/**
+ * Number of bytes collected before they are written or compressed.
+ */
+#define OUTSTREAM_BUFFER_SIZE 1048576
+
+/**
+ * Environment variable that turns on compression for all output streams, see outStream_create().
+ */
+#define OUTSTREAM_COMPRESS_ENV "OUTSTREAM_COMPRESS"
+
+
+
+/**
+ * OutStream.
+ */
+typedef struct _outStreamStruct_ *OutStream;
+
+
+
+extern OutStream outStream_create (char *fileName);
+extern int outStream_isCompressed (OutStream stream);
+extern void outStream_write (OutStream stream, char *data, int length);
+extern void outStream_puts (OutStream stream, char *s);
+extern void outStream_printf (OutStream stream, char *format, ...);
+extern void outStream_flush (OutStream stream);
+extern void outStream_destroy (OutStream stream);
+
+
+
+#endif
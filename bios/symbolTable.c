@@ -0,0 +1,125 @@
+#include <pthread.h>
+#include "log.h"
+#include "format.h"
+#include "common.h"
+#include "hashTable.h"
+#include "symbolTable.h"
+
+
+
+/**
+ *   \file symbolTable.c Process-wide table of interned names (e.g. chromosome or target names).
+ *   Each distinct name is stored once and identified by a small non-negative integer. 
+ *   Ids are assigned in order of first appearance and stay valid for the lifetime of the process.
+ *   All functions are thread-safe. Only interning and looking up names take a lock; 
+ *   symbolTable_getName() and symbolTable_getNumberOfSymbols() read without one, 
+ *   since names are kept in pages that never move and a new id is published only after its name is stored.
+ */
+
+
+
+#define SYMBOL_TABLE_PAGE_SIZE 1024     // names per page
+#define SYMBOL_TABLE_MAX_PAGES 65536
+
+
+
+static char **pages[SYMBOL_TABLE_MAX_PAGES]; // the name of id i is pages[i / SYMBOL_TABLE_PAGE_SIZE][i % SYMBOL_TABLE_PAGE_SIZE]
+static int numSymbols = 0;      // written with release semantics after the name of the new id is stored
+static HashTable ids = NULL;    // name -> id + 1
+static int lastId = -1;
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+
+
+
+#define symbolTable_name(id) (pages[(id) / SYMBOL_TABLE_PAGE_SIZE][(id) % SYMBOL_TABLE_PAGE_SIZE])
+
+
+
+static int symbolTable_find (char *name)
+{
+  int id;
+
+  if (lastId >= 0 && strEqual (symbolTable_name (lastId),name)) {
+    return lastId;
+  }
+  if (ids == NULL) {
+    ids = hashTable_create (HASH_TABLE_STRING_KEYS,100);
+  }
+  id = (intptr_t)hashTable_getString (ids,name) - 1;
+  if (id >= 0) {
+    lastId = id;
+  }
+  return id;
+}
+
+
+
+/**
+ * Intern a name.
+ * @param[in] name The name to be interned
+ * @return The id of the name. A new id is assigned if the name has not been seen before.
+ * @note Consecutive lookups of the same name are answered without a search.
+ */
+int symbolTable_intern (char *name)
+{
+  int id;
+
+  pthread_mutex_lock (&mutex);
+  if ((id = symbolTable_find (name)) < 0) {
+    id = numSymbols;
+    if (id / SYMBOL_TABLE_PAGE_SIZE >= SYMBOL_TABLE_MAX_PAGES) {
+      die ("symbolTable_intern: more than %d symbols",SYMBOL_TABLE_PAGE_SIZE * SYMBOL_TABLE_MAX_PAGES);
+    }
+    if (pages[id / SYMBOL_TABLE_PAGE_SIZE] == NULL) {
+      pages[id / SYMBOL_TABLE_PAGE_SIZE] = needMem (SYMBOL_TABLE_PAGE_SIZE * sizeof (char*));
+    }
+    symbolTable_name (id) = hlr_strdup (name);
+    hashTable_putString (ids,name,(void*)(intptr_t)(id + 1));
+    lastId = id;
+    __atomic_store_n (&numSymbols,id + 1,__ATOMIC_RELEASE);
+  }
+  pthread_mutex_unlock (&mutex);
+  return id;
+}
+
+
+
+/**
+ * Look up a name without interning it.
+ * @return The id of the name, -1 if the name has not been interned
+ */
+int symbolTable_lookup (char *name)
+{
+  int id;
+
+  pthread_mutex_lock (&mutex);
+  id = symbolTable_find (name);
+  pthread_mutex_unlock (&mutex);
+  return id;
+}
+
+
+
+/**
+ * Get the name of an interned symbol.
+ * @param[in] id An id returned by symbolTable_intern()
+ * @return The name. The memory belongs to this module and must not be modified or freed.
+ */
+char* symbolTable_getName (int id)
+{
+  if (id < 0 || id >= __atomic_load_n (&numSymbols,__ATOMIC_ACQUIRE)) {
+    die ("symbolTable_getName: invalid id %d",id);
+  }
+  return symbolTable_name (id);
+}
+
+
+
+/**
+ * Get the number of interned symbols.
+ * @return The number of symbols. Valid ids range from 0 to this number - 1.
+ */
+int symbolTable_getNumberOfSymbols (void)
+{
+  return __atomic_load_n (&numSymbols,__ATOMIC_ACQUIRE);
+}
@@ -0,0 +1,19 @@
+#ifndef DEF_SYMBOL_TABLE_H
+#define DEF_SYMBOL_TABLE_H
+
+
+
+/**
+ *   \file symbolTable.h
+ */
+
+
+
+extern int symbolTable_intern (char *name);
+extern int symbolTable_lookup (char *name);
+extern char* symbolTable_getName (int id);
+extern int symbolTable_getNumberOfSymbols (void);
+
+
+
+#endif
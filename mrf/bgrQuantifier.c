@@ -20,6 +20,7 @@ int main( int argc, char* argv[] ) {
   }
   bgrs = arrayCreate( 1000, BedGraph );
   bgrParser_initFromFile ( "-" );
+  bgrParser_setArena( arena_create( 0, 0 ) );
   bgrs = bgrParser_getAllEntries ();
   bgrParser_deInit();
   arraySort( bgrs, (ARRAYORDERF) bgrParser_sort );
@@ -0,0 +1,622 @@
+#include <errno.h>
+#include "log.h"
+#include "format.h"
+#include "common.h"
+#include "symbolTable.h"
+#include "mrf.h"
+#include "bmrf.h"
+
+
+
+/**
+ *   \file bmrf.c Module to read and write binary MRF (BMRF).
+ *   A BMRF file starts with BMRF_MAGIC, the format version, the comments and the column types
+ *   of the original MRF header. The entries follow in chunks of up to BMRF_CHUNK_SIZE entries.
+ *   Each chunk stores its data column-wise in separate streams:
+ *
+ *   \verbatim
+   Stream:      Content (per entry, per read or per block):
+   LAYOUT       (number of blocks of read1 << 1 | isPairedEnd), number of blocks of read2 if paired
+   TARGET       file-level target index; names are defined in the chunk header when first used
+   STRAND       one byte
+   TSTART       targetStart, delta to the targetStart of the previous block in the chunk
+   TLENGTH      targetEnd - targetStart
+   QSTART       queryStart, delta to the queryEnd of the previous block of the same read
+   QLENGTH      queryEnd - queryStart
+   SEQUENCE     null-terminated string per read, empty if the column is not present
+   QUALITY      null-terminated string per read, empty if the column is not present
+   QUERYID      null-terminated string per read, empty if the column is not present
+   \endverbatim
+ *
+ *   All integers are stored as variable-length integers (7 bits per byte), signed values in
+ *   zigzag encoding. A chunk consists of the number of entries, the new target names, the byte
+ *   length of each stream and finally the streams. A chunk with zero entries marks the end of the file.
+ *   Since each stream has a known length, a reader can skip the sequence, quality and query id streams
+ *   without decoding them.
+ */
+
+
+
+#define BMRF_STREAM_LAYOUT 0
+#define BMRF_STREAM_TARGET 1
+#define BMRF_STREAM_STRAND 2
+#define BMRF_STREAM_TSTART 3
+#define BMRF_STREAM_TLENGTH 4
+#define BMRF_STREAM_QSTART 5
+#define BMRF_STREAM_QLENGTH 6
+#define BMRF_STREAM_SEQUENCE 7
+#define BMRF_STREAM_QUALITY 8
+#define BMRF_STREAM_QUERYID 9
+#define BMRF_NUM_STREAMS 10
+
+
+
+struct _bmrfWriterStruct_ {
+  FILE *fp;
+  Array streams[BMRF_NUM_STREAMS];  // of type char
+  Array header;                     // of type char
+  Array targetIndices;              // of type int, symbol id -> file-level target index + 1
+  Texta newTargets;
+  int numTargets;
+  int numEntries;
+  int prevTargetStart;
+  int hasSequence;
+  int hasQualityScores;
+  int hasQueryId;
+};
+
+
+
+struct _bmrfReaderStruct_ {
+  FILE *fp;
+  Array targetIds;                  // of type int, file-level target index -> symbol id
+  Array data;                       // of type char, content of the current chunk
+  Array skipBuffer;                 // of type char
+  char *pos[BMRF_NUM_STREAMS];
+  int wanted[BMRF_NUM_STREAMS];
+  int numEntries;
+  int prevTargetStart;
+  int atEnd;
+};
+
+
+
+/* ----------------------------- variable-length integers ----------------------------- */
+
+
+
+static unsigned int bmrf_zigzagEncode (int i)
+{
+  return ((unsigned int)i << 1) ^ (unsigned int)(i >> 31);
+}
+
+
+
+static int bmrf_zigzagDecode (unsigned int u)
+{
+  return (int)((u >> 1) ^ -(int)(u & 1));
+}
+
+
+
+static void bmrf_putVarint (Array buffer, unsigned int value)
+{
+  char *pos;
+  int max;
+  int length;
+
+  max = arrayMax (buffer);
+  array (buffer,max + 4,char) = 0;  // reserve the maximum length of 5 bytes
+  pos = arrp (buffer,max,char);
+  length = 0;
+  while (value >= 0x80) {
+    pos[length++] = (char)(value | 0x80);
+    value >>= 7;
+  }
+  pos[length++] = (char)value;
+  arrayMax (buffer) = max + length;
+}
+
+
+
+static void bmrf_putBytes (Array buffer, char *bytes, int length)
+{
+  int max;
+
+  max = arrayMax (buffer);
+  if (length > 0) {
+    array (buffer,max + length - 1,char) = 0;
+    memcpy (arrp (buffer,max,char),bytes,length);
+  }
+}
+
+
+
+static void bmrf_putString (Array buffer, char *s)
+{
+  bmrf_putBytes (buffer,s != NULL ? s : "",strlen (s != NULL ? s : "") + 1);
+}
+
+
+
+static unsigned int bmrf_getVarint (char **pos)
+{
+  unsigned char *p;
+  unsigned int value;
+  int shift;
+
+  p = (unsigned char*)*pos;
+  value = 0;
+  shift = 0;
+  while (*p & 0x80) {
+    value |= (unsigned int)(*p++ & 0x7f) << shift;
+    shift += 7;
+  }
+  value |= (unsigned int)*p++ << shift;
+  *pos = (char*)p;
+  return value;
+}
+
+
+
+static char* bmrf_getString (char **pos)
+{
+  char *s;
+
+  s = *pos;
+  *pos += strlen (s) + 1;
+  return s;
+}
+
+
+
+static unsigned int bmrf_readVarint (FILE *fp, int *eof)
+{
+  unsigned int value;
+  int shift;
+  int c;
+
+  value = 0;
+  shift = 0;
+  while ((c = getc (fp)) != EOF) {
+    value |= (unsigned int)(c & 0x7f) << shift;
+    if ((c & 0x80) == 0) {
+      return value;
+    }
+    shift += 7;
+  }
+  if (eof != NULL && shift == 0) {
+    *eof = 1;
+    return 0;
+  }
+  die ("Unexpected end of BMRF file");
+  return 0;
+}
+
+
+
+static void bmrf_readBytes (FILE *fp, char *bytes, int length)
+{
+  if (length > 0 && fread (bytes,1,length,fp) != length) {
+    die ("Unexpected end of BMRF file");
+  }
+}
+
+
+
+static char* bmrf_readString (FILE *fp, Stringa buffer)
+{
+  int length;
+
+  length = bmrf_readVarint (fp,NULL);
+  stringClear (buffer);
+  array (buffer,length,char) = '\0';
+  bmrf_readBytes (fp,string (buffer),length);
+  return string (buffer);
+}
+
+
+
+static void bmrf_writeString (Array buffer, char *s)
+{
+  int length;
+
+  length = strlen (s);
+  bmrf_putVarint (buffer,length);
+  bmrf_putBytes (buffer,s,length);
+}
+
+
+
+/* ----------------------------------- writer ----------------------------------- */
+
+
+
+/**
+ * Create a BMRF writer. The magic bytes, the comments and the column types are written immediately.
+ * @param[in] fp Output file, must be opened for writing
+ * @param[in] columnTypes Array of type int with the MRF_COLUMN_TYPE_* of each column
+ * @param[in] comments Comment lines without the leading '#'
+ */
+BmrfWriter bmrfWriter_create (FILE *fp, Array columnTypes, Texta comments)
+{
+  BmrfWriter writer;
+  int i;
+  int columnType;
+
+  AllocVar (writer);
+  writer->fp = fp;
+  for (i = 0; i < BMRF_NUM_STREAMS; i++) {
+    writer->streams[i] = arrayCreate (1000,char);
+  }
+  writer->header = arrayCreate (1000,char);
+  writer->targetIndices = arrayCreate (100,int);
+  writer->newTargets = textCreate (100);
+  bmrf_putBytes (writer->header,BMRF_MAGIC,BMRF_MAGIC_LENGTH);
+  bmrf_putVarint (writer->header,BMRF_VERSION);
+  bmrf_putVarint (writer->header,arrayMax (comments));
+  for (i = 0; i < arrayMax (comments); i++) {
+    bmrf_writeString (writer->header,textItem (comments,i));
+  }
+  bmrf_putVarint (writer->header,arrayMax (columnTypes));
+  for (i = 0; i < arrayMax (columnTypes); i++) {
+    columnType = arru (columnTypes,i,int);
+    bmrf_putVarint (writer->header,columnType);
+    if (columnType == MRF_COLUMN_TYPE_SEQUENCE) {
+      writer->hasSequence = 1;
+    }
+    else if (columnType == MRF_COLUMN_TYPE_QUALITY_SCORES) {
+      writer->hasQualityScores = 1;
+    }
+    else if (columnType == MRF_COLUMN_TYPE_QUERY_ID) {
+      writer->hasQueryId = 1;
+    }
+  }
+  if (fwrite (arrp (writer->header,0,char),1,arrayMax (writer->header),writer->fp) != arrayMax (writer->header)) {
+    die ("Unable to write BMRF header: %s",strerror (errno));
+  }
+  return writer;
+}
+
+
+
+static int bmrfWriter_getTargetIndex (BmrfWriter writer, MrfBlock *currBlock)
+{
+  int *targetIndex;
+
+  targetIndex = arrayp (writer->targetIndices,currBlock->targetId,int);
+  if (*targetIndex == 0) {
+    *targetIndex = ++writer->numTargets;
+    textAdd (writer->newTargets,currBlock->targetName);
+  }
+  return *targetIndex - 1;
+}
+
+
+
+static void bmrfWriter_addRead (BmrfWriter writer, MrfRead *currRead)
+{
+  MrfBlock *currBlock;
+  int prevQueryEnd;
+  int i;
+
+  prevQueryEnd = 0;
+  for (i = 0; i < arrayMax (currRead->blocks); i++) {
+    currBlock = arrp (currRead->blocks,i,MrfBlock);
+    bmrf_putVarint (writer->streams[BMRF_STREAM_TARGET],bmrfWriter_getTargetIndex (writer,currBlock));
+    array (writer->streams[BMRF_STREAM_STRAND],arrayMax (writer->streams[BMRF_STREAM_STRAND]),char) = currBlock->strand;
+    bmrf_putVarint (writer->streams[BMRF_STREAM_TSTART],bmrf_zigzagEncode (currBlock->targetStart - writer->prevTargetStart));
+    bmrf_putVarint (writer->streams[BMRF_STREAM_TLENGTH],bmrf_zigzagEncode (currBlock->targetEnd - currBlock->targetStart));
+    bmrf_putVarint (writer->streams[BMRF_STREAM_QSTART],bmrf_zigzagEncode (currBlock->queryStart - prevQueryEnd));
+    bmrf_putVarint (writer->streams[BMRF_STREAM_QLENGTH],bmrf_zigzagEncode (currBlock->queryEnd - currBlock->queryStart));
+    writer->prevTargetStart = currBlock->targetStart;
+    prevQueryEnd = currBlock->queryEnd;
+  }
+  if (writer->hasSequence) {
+    bmrf_putString (writer->streams[BMRF_STREAM_SEQUENCE],currRead->sequence);
+  }
+  if (writer->hasQualityScores) {
+    bmrf_putString (writer->streams[BMRF_STREAM_QUALITY],currRead->qualityScores);
+  }
+  if (writer->hasQueryId) {
+    bmrf_putString (writer->streams[BMRF_STREAM_QUERYID],currRead->queryId);
+  }
+}
+
+
+
+static void bmrfWriter_flushChunk (BmrfWriter writer)
+{
+  int i;
+
+  arrayMax (writer->header) = 0;
+  bmrf_putVarint (writer->header,writer->numEntries);
+  bmrf_putVarint (writer->header,arrayMax (writer->newTargets));
+  for (i = 0; i < arrayMax (writer->newTargets); i++) {
+    bmrf_writeString (writer->header,textItem (writer->newTargets,i));
+  }
+  for (i = 0; i < BMRF_NUM_STREAMS; i++) {
+    bmrf_putVarint (writer->header,arrayMax (writer->streams[i]));
+  }
+  if (fwrite (arrp (writer->header,0,char),1,arrayMax (writer->header),writer->fp) != arrayMax (writer->header)) {
+    die ("Unable to write BMRF chunk: %s",strerror (errno));
+  }
+  for (i = 0; i < BMRF_NUM_STREAMS; i++) {
+    if (arrayMax (writer->streams[i]) > 0 &&
+        fwrite (arrp (writer->streams[i],0,char),1,arrayMax (writer->streams[i]),writer->fp) != arrayMax (writer->streams[i])) {
+      die ("Unable to write BMRF chunk: %s",strerror (errno));
+    }
+    arrayMax (writer->streams[i]) = 0;
+  }
+  textClear (writer->newTargets);
+  writer->numEntries = 0;
+  writer->prevTargetStart = 0;
+}
+
+
+
+/**
+ * Add an MrfEntry to a BMRF writer. The entry is copied; it is written out once the current chunk is full.
+ */
+void bmrfWriter_writeEntry (BmrfWriter writer, MrfEntry *currEntry)
+{
+  Array layout;
+
+  layout = writer->streams[BMRF_STREAM_LAYOUT];
+  bmrf_putVarint (layout,(arrayMax (currEntry->read1.blocks) << 1) | (currEntry->isPairedEnd ? 1 : 0));
+  bmrfWriter_addRead (writer,&currEntry->read1);
+  if (currEntry->isPairedEnd) {
+    bmrf_putVarint (layout,arrayMax (currEntry->read2.blocks));
+    bmrfWriter_addRead (writer,&currEntry->read2);
+  }
+  writer->numEntries++;
+  if (writer->numEntries == BMRF_CHUNK_SIZE) {
+    bmrfWriter_flushChunk (writer);
+  }
+}
+
+
+
+/**
+ * Write the last chunk and the end-of-file marker and destroy the writer.
+ * @note The output file is flushed, but not closed.
+ */
+void bmrfWriter_close (BmrfWriter writer)
+{
+  int i;
+
+  if (writer->numEntries > 0) {
+    bmrfWriter_flushChunk (writer);
+  }
+  bmrfWriter_flushChunk (writer);
+  fflush (writer->fp);
+  for (i = 0; i < BMRF_NUM_STREAMS; i++) {
+    arrayDestroy (writer->streams[i]);
+  }
+  arrayDestroy (writer->header);
+  arrayDestroy (writer->targetIndices);
+  textDestroy (writer->newTargets);
+  freeMem (writer);
+}
+
+
+
+/* ----------------------------------- reader ----------------------------------- */
+
+
+
+/**
+ * Create a BMRF reader. The magic bytes, the comments and the column types are read immediately.
+ * @param[in] fp Input file, positioned at the start of the BMRF data
+ * @param[in] columnTypes Array of type int, the column types of the file are appended
+ * @param[in] comments Texta, the comments of the file are appended
+ */
+BmrfReader bmrfReader_create (FILE *fp, Array columnTypes, Texta comments)
+{
+  BmrfReader reader;
+  char magic[BMRF_MAGIC_LENGTH];
+  Stringa buffer;
+  int version;
+  int columnType;
+  int i,n;
+
+  bmrf_readBytes (fp,magic,BMRF_MAGIC_LENGTH);
+  if (memcmp (magic,BMRF_MAGIC,BMRF_MAGIC_LENGTH) != 0) {
+    die ("Not a BMRF file");
+  }
+  version = bmrf_readVarint (fp,NULL);
+  if (version != BMRF_VERSION) {
+    die ("Unsupported BMRF version: %d",version);
+  }
+  AllocVar (reader);
+  reader->fp = fp;
+  reader->targetIds = arrayCreate (100,int);
+  reader->data = arrayCreate (100000,char);
+  reader->skipBuffer = arrayCreate (100000,char);
+  buffer = stringCreate (100);
+  n = bmrf_readVarint (fp,NULL);
+  for (i = 0; i < n; i++) {
+    textAdd (comments,bmrf_readString (fp,buffer));
+  }
+  n = bmrf_readVarint (fp,NULL);
+  for (i = 0; i < BMRF_NUM_STREAMS; i++) {
+    reader->wanted[i] = i < BMRF_STREAM_SEQUENCE;
+  }
+  for (i = 0; i < n; i++) {
+    columnType = bmrf_readVarint (fp,NULL);
+    array (columnTypes,arrayMax (columnTypes),int) = columnType;
+    if (columnType == MRF_COLUMN_TYPE_SEQUENCE) {
+      reader->wanted[BMRF_STREAM_SEQUENCE] = 1;
+    }
+    else if (columnType == MRF_COLUMN_TYPE_QUALITY_SCORES) {
+      reader->wanted[BMRF_STREAM_QUALITY] = 1;
+    }
+    else if (columnType == MRF_COLUMN_TYPE_QUERY_ID) {
+      reader->wanted[BMRF_STREAM_QUERYID] = 1;
+    }
+  }
+  stringDestroy (buffer);
+  return reader;
+}
+
+
+
+/**
+ * Restrict the optional columns that are decoded; the streams of the other columns are skipped.
+ * @param[in] reader A BMRF reader, before the first call to bmrfReader_next()
+ * @param[in] columnMask Combination of MRF_COLUMN_MASK() values
+ */
+void bmrfReader_setColumns (BmrfReader reader, int columnMask)
+{
+  if (!(columnMask & MRF_COLUMN_MASK (MRF_COLUMN_TYPE_SEQUENCE))) {
+    reader->wanted[BMRF_STREAM_SEQUENCE] = 0;
+  }
+  if (!(columnMask & MRF_COLUMN_MASK (MRF_COLUMN_TYPE_QUALITY_SCORES))) {
+    reader->wanted[BMRF_STREAM_QUALITY] = 0;
+  }
+  if (!(columnMask & MRF_COLUMN_MASK (MRF_COLUMN_TYPE_QUERY_ID))) {
+    reader->wanted[BMRF_STREAM_QUERYID] = 0;
+  }
+}
+
+
+
+static void bmrfReader_skip (BmrfReader reader, int length)
+{
+  if (length == 0 || fseek (reader->fp,length,SEEK_CUR) == 0) {
+    return;
+  }
+  // not seekable, e.g. stdin from a pipe
+  array (reader->skipBuffer,length - 1,char) = 0;
+  bmrf_readBytes (reader->fp,arrp (reader->skipBuffer,0,char),length);
+}
+
+
+
+static int bmrfReader_readChunk (BmrfReader reader)
+{
+  int lengths[BMRF_NUM_STREAMS];
+  Stringa buffer;
+  int eof;
+  int total;
+  int i,n;
+
+  eof = 0;
+  reader->numEntries = bmrf_readVarint (reader->fp,&eof);
+  if (eof == 1 || reader->numEntries == 0) {
+    reader->atEnd = 1;
+    return 0;
+  }
+  n = bmrf_readVarint (reader->fp,NULL);
+  buffer = stringCreate (100);
+  for (i = 0; i < n; i++) {
+    array (reader->targetIds,arrayMax (reader->targetIds),int) = symbolTable_intern (bmrf_readString (reader->fp,buffer));
+  }
+  stringDestroy (buffer);
+  total = 0;
+  for (i = 0; i < BMRF_NUM_STREAMS; i++) {
+    lengths[i] = bmrf_readVarint (reader->fp,NULL);
+    if (reader->wanted[i]) {
+      total += lengths[i];
+    }
+  }
+  arrayMax (reader->data) = 0;
+  array (reader->data,total,char) = '\0';
+  total = 0;
+  for (i = 0; i < BMRF_NUM_STREAMS; i++) {
+    if (reader->wanted[i]) {
+      reader->pos[i] = arrp (reader->data,total,char);
+      bmrf_readBytes (reader->fp,reader->pos[i],lengths[i]);
+      total += lengths[i];
+    }
+    else {
+      reader->pos[i] = NULL;
+      bmrfReader_skip (reader,lengths[i]);
+    }
+  }
+  reader->prevTargetStart = 0;
+  return 1;
+}
+
+
+
+static void bmrfReader_decodeRead (BmrfReader reader, MrfRead *currRead, int numBlocks)
+{
+  MrfBlock *currBlock;
+  int targetIndex;
+  int prevQueryEnd;
+  int i;
+
+  prevQueryEnd = 0;
+  for (i = 0; i < numBlocks; i++) {
+    currBlock = arrayp (currRead->blocks,i,MrfBlock);
+    targetIndex = bmrf_getVarint (&reader->pos[BMRF_STREAM_TARGET]);
+    if (targetIndex >= arrayMax (reader->targetIds)) {
+      die ("Invalid target index in BMRF file: %d",targetIndex);
+    }
+    currBlock->targetId = arru (reader->targetIds,targetIndex,int);
+    currBlock->targetName = symbolTable_getName (currBlock->targetId);
+    currBlock->strand = *reader->pos[BMRF_STREAM_STRAND]++;
+    currBlock->targetStart = reader->prevTargetStart + bmrf_zigzagDecode (bmrf_getVarint (&reader->pos[BMRF_STREAM_TSTART]));
+    currBlock->targetEnd = currBlock->targetStart + bmrf_zigzagDecode (bmrf_getVarint (&reader->pos[BMRF_STREAM_TLENGTH]));
+    currBlock->queryStart = prevQueryEnd + bmrf_zigzagDecode (bmrf_getVarint (&reader->pos[BMRF_STREAM_QSTART]));
+    currBlock->queryEnd = currBlock->queryStart + bmrf_zigzagDecode (bmrf_getVarint (&reader->pos[BMRF_STREAM_QLENGTH]));
+    reader->prevTargetStart = currBlock->targetStart;
+    prevQueryEnd = currBlock->queryEnd;
+  }
+  arrayMax (currRead->blocks) = numBlocks;
+  currRead->sequence = reader->pos[BMRF_STREAM_SEQUENCE] ? bmrf_getString (&reader->pos[BMRF_STREAM_SEQUENCE]) : NULL;
+  currRead->qualityScores = reader->pos[BMRF_STREAM_QUALITY] ? bmrf_getString (&reader->pos[BMRF_STREAM_QUALITY]) : NULL;
+  currRead->queryId = reader->pos[BMRF_STREAM_QUERYID] ? bmrf_getString (&reader->pos[BMRF_STREAM_QUERYID]) : NULL;
+}
+
+
+
+/**
+ * Decode the next entry of a BMRF file.
+ * @param[in] reader A BMRF reader
+ * @param[in] currEntry Entry to be filled; its block Arrays must exist and are reused
+ * @return 1 if an entry was decoded, 0 at the end of the file
+ * @note The strings of the entry point into the chunk buffer of the reader and stay valid until the next call.
+ */
+int bmrfReader_next (BmrfReader reader, MrfEntry *currEntry)
+{
+  unsigned int layout;
+
+  if (reader->numEntries == 0) {
+    if (reader->atEnd || !bmrfReader_readChunk (reader)) {
+      return 0;
+    }
+  }
+  layout = bmrf_getVarint (&reader->pos[BMRF_STREAM_LAYOUT]);
+  currEntry->isPairedEnd = layout & 1;
+  bmrfReader_decodeRead (reader,&currEntry->read1,layout >> 1);
+  if (currEntry->isPairedEnd) {
+    bmrfReader_decodeRead (reader,&currEntry->read2,bmrf_getVarint (&reader->pos[BMRF_STREAM_LAYOUT]));
+  }
+  else {
+    arrayMax (currEntry->read2.blocks) = 0;
+    currEntry->read2.sequence = NULL;
+    currEntry->read2.qualityScores = NULL;
+    currEntry->read2.queryId = NULL;
+  }
+  reader->numEntries--;
+  return 1;
+}
+
+
+
+/**
+ * Destroy a BMRF reader.
+ * @note The input file is not closed.
+ */
+void bmrfReader_destroy (BmrfReader reader)
+{
+  if (reader == NULL) {
+    return;
+  }
+  arrayDestroy (reader->targetIds);
+  arrayDestroy (reader->data);
+  arrayDestroy (reader->skipBuffer);
+  freeMem (reader);
+}
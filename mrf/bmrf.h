@@ -0,0 +1,53 @@
+#ifndef DEF_BMRF_H
+#define DEF_BMRF_H
+
+
+
+/**
+ *   \file bmrf.h
+ */
+
+
+
+/**
+ * Magic bytes at the start of a BMRF file. The first byte cannot start a text MRF file, see bmrf_isBinary().
+ */
+#define BMRF_MAGIC "\211BMRF\r\n\032"
+#define BMRF_MAGIC_LENGTH 8
+#define BMRF_VERSION 1
+
+/**
+ * Maximum number of entries per chunk.
+ */
+#define BMRF_CHUNK_SIZE 8192
+
+
+
+/**
+ * BmrfReader.
+ */
+typedef struct _bmrfReaderStruct_ *BmrfReader;
+
+
+
+/**
+ * BmrfWriter.
+ */
+typedef struct _bmrfWriterStruct_ *BmrfWriter;
+
+
+
+#define bmrf_isBinary(firstByte) ((firstByte) == (unsigned char)BMRF_MAGIC[0])
+
+extern BmrfReader bmrfReader_create (FILE *fp, Array columnTypes, Texta comments);
+extern void bmrfReader_setColumns (BmrfReader reader, int columnMask);
+extern int bmrfReader_next (BmrfReader reader, MrfEntry *currEntry);
+extern void bmrfReader_destroy (BmrfReader reader);
+
+extern BmrfWriter bmrfWriter_create (FILE *fp, Array columnTypes, Texta comments);
+extern void bmrfWriter_writeEntry (BmrfWriter writer, MrfEntry *currEntry);
+extern void bmrfWriter_close (BmrfWriter writer);
+
+
+
+#endif
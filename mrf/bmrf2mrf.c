@@ -0,0 +1,29 @@
+#include "log.h"
+#include "format.h"
+#include "mrf.h"
+#include <stdio.h>
+
+
+
+/** 
+ *   \file bmrf2mrf.c Module to convert binary MRF (BMRF) into MRF.
+ *         Usage: bmrf2mrf < <file.bmrf> > <file.mrf> \n
+ */
+
+
+
+int main (int argc, char *argv[])
+{
+  MrfEntry *currEntry;
+
+  if (argc != 1) {
+    usage ("%s < <file.bmrf> > <file.mrf>",argv[0]);
+  }
+  mrf_init ("-");
+  mrf_putHeader ();
+  while (currEntry = mrf_nextEntry ()) {
+    mrf_putEntry (currEntry);
+  }
+  mrf_deInit ();
+  return 0;
+}
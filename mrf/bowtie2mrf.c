@@ -4,6 +4,7 @@
 #include "bowtieParser.h"
 #include "stringUtil.h"
 #include "common.h"
+#include "outStream.h"
 #include "seq.h"
 
 
@@ -22,9 +23,13 @@
 
 
 
+static OutStream out = NULL;
+
+
+
 static void printAlignmentBlock (char *chromosome, char strand, int targetStart, int targetEnd, int queryStart, int queryEnd) 
 {
-  printf ("%s:%c:%d:%d:%d:%d",
+  outStream_printf (out,"%s:%c:%d:%d:%d:%d",
           chromosome,
           strand,
           targetStart,
@@ -132,11 +137,11 @@ static void printPairedData (BowtieEntry* prevEntry, BowtieEntry* currEntry, Str
   order = strcmp( chromosome1, chromosome2 );
   if( order == 0 ) order = start1 - start2;
   if( order < 0 ) {
-    printf( "%s|%s", string(block1), string(block2) );
+    outStream_printf (out,"%s|%s", string(block1), string(block2) );
     stringPrintf( bufferSequence, "%s|%s", prevEntry->sequence, currEntry->sequence);
     stringPrintf( bufferQuality,  "%s|%s", prevEntry->quality,  currEntry->quality);
   } else {
-    printf( "%s|%s", string(block2), string(block1) );
+    outStream_printf (out,"%s|%s", string(block2), string(block1) );
     stringPrintf( bufferSequence, "%s|%s", currEntry->sequence, prevEntry->sequence);
     stringPrintf( bufferQuality,  "%s|%s", currEntry->quality,  prevEntry->quality);
   }
@@ -151,6 +156,7 @@ int main (int argc, char *argv[])
   BowtieQuery *currQuery;
   BowtieEntry *currEntry;
   BowtieQuery *prevQuery=NULL;
+  Arena arena;
   int i;
   int mode;
   int includeSequences,includeQualityScores, includeIDs;
@@ -202,19 +208,22 @@ int main (int argc, char *argv[])
     }
     i++;
   }
-  printf ("%s",MRF_COLUMN_NAME_BLOCKS);
+  out = outStream_create ("-");
+  outStream_printf (out,"%s",MRF_COLUMN_NAME_BLOCKS);
   if (includeSequences == 1) {
-    printf ("\t%s",MRF_COLUMN_NAME_SEQUENCE);
+    outStream_printf (out,"\t%s",MRF_COLUMN_NAME_SEQUENCE);
   }
   if (includeQualityScores == 1) {
-    printf ("\t%s",MRF_COLUMN_NAME_QUALITY_SCORES);
+    outStream_printf (out,"\t%s",MRF_COLUMN_NAME_QUALITY_SCORES);
   }
   if (includeIDs == 1) {
-    printf ("\t%s",MRF_COLUMN_NAME_QUERY_ID);
+    outStream_printf (out,"\t%s",MRF_COLUMN_NAME_QUERY_ID);
   }
-  puts ("");
+  outStream_puts (out,"");
   
   bowtieParser_initFromFile ("-");
+  arena = arena_create (0,0);
+  bowtieParser_setArena (arena);
   while (currQuery = bowtieParser_nextQuery ()) {
     if (arrayMax (currQuery->entries) != 1) {
       continue;
@@ -252,7 +261,7 @@ int main (int argc, char *argv[])
                            startFirstExon + 1 + sizeExonOverlap - 1,     
                            1,                                           
                            numNucleotidesFirstExon);                     
-      printf (",");
+      outStream_printf (out,",");
       printAlignmentBlock (chromosome,
                            currEntry->strand,
                            startSecondExon + 1,
@@ -291,10 +300,10 @@ int main (int argc, char *argv[])
       die ("Unknown mode");
     }
     if (includeSequences == 1) {
-      printf ("\t%s",string( bufferSequence ));
+      outStream_printf (out,"\t%s",string( bufferSequence ));
     }
     if (includeQualityScores == 1) {
-      printf ("\t%s",string( bufferQuality) );
+      outStream_printf (out,"\t%s",string( bufferQuality) );
     }
     if (includeIDs == 1) {
       if( mode==MODE_PAIRED ) {
@@ -303,15 +312,17 @@ int main (int argc, char *argv[])
         stringPrintf( tmp, "%s|%s", string( bufferID ), string( bufferID ) );
         stringPrintf( bufferID, "%s", string(tmp) );
 	}
-      printf ("\t%s",string( bufferID) );
+      outStream_printf (out,"\t%s",string( bufferID) );
     }
-    puts ("");
+    outStream_puts (out,"");
   } 
   stringDestroy( bufferSequence );
   stringDestroy( bufferQuality );
   stringDestroy( bufferID );
   stringDestroy( tmp );
+  outStream_destroy (out);
   bowtieParser_deInit ();
+  arena_destroy (arena);
   return 0;
 }
 
@@ -49,7 +49,7 @@ static void processGroups (Array groups)
           currEntry->strand,
           arru (groups,0,GffEntry*)->start,
           arru (groups,arrayMax (groups) - 1,GffEntry*)->end,
-          arrayMax (groups));
+          (int)arrayMax (groups));
   for (i = 0; i < arrayMax (groups); i++) {
     currEntry = arru (groups,i,GffEntry*);
     printf ("%d%s",currEntry->start,i < arrayMax (groups) - 1 ? "," : "\t");
@@ -67,7 +67,9 @@ int main (int argc, char *argv[])
 {
   LineStream ls;
   char *line;
-  Texta tokens;
+  FieldCursor columns;
+  Field fields[9];
+  int numFields;
   Array entries;
   GffEntry *currEntry,*nextEntry;
   int i,j;
@@ -81,14 +83,20 @@ int main (int argc, char *argv[])
   ls_nextLine (ls);
   ls_nextLine (ls);
   while (line = ls_nextLine (ls)) {
-    tokens = textFieldtok (line,"\t");
+    fieldCursorInit (&columns,line,"\t");
+    numFields = 0;
+    while (numFields < 9 && fieldNext (&columns,&fields[numFields])) {
+      numFields++;
+    }
+    if (numFields < 9) {
+      die ("Expected 9 tab-delimited columns: %s",line);
+    }
     currEntry = arrayp (entries,arrayMax (entries),GffEntry);
-    currEntry->targetName = hlr_strdup (textItem (tokens,0));
-    currEntry->start = atoi (textItem (tokens,3)) - 1; // make zero-based
-    currEntry->end = atoi (textItem (tokens,4));
-    currEntry->strand = textItem (tokens,6)[0];
-    currEntry->group = hlr_strdup (textItem (tokens,8));
-    textDestroy (tokens);
+    currEntry->targetName = fieldDup (fields[0]);
+    currEntry->start = parseInt (fields[3]) - 1; // make zero-based
+    currEntry->end = parseInt (fields[4]);
+    currEntry->strand = fields[6].s[0];
+    currEntry->group = fieldDup (fields[8]);
   }
   arraySort (entries,(ARRAYORDERF)sortGffEntries);
 
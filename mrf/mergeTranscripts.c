@@ -2,6 +2,7 @@
 #include "format.h"
 #include "linestream.h"
 #include "intervalFind.h"
+#include "hashTable.h"
 #include "bits.h"
 
 
@@ -39,13 +40,6 @@ typedef struct {
 
 
 
-static int sortIntervalsByName (Interval *a, Interval *b) 
-{
-  return strcmp (a->name,b->name);
-}
-
-
-
 static void generateOutput (char* transcriptName, char* chromosome, char strand,
                             Array exonStarts, Array exonEnds) 
 {
@@ -55,7 +49,7 @@ static void generateOutput (char* transcriptName, char* chromosome, char strand,
     die ("exonStarts and exonEnds must have the same number of elements");
   }
   printf ("%s\t%s\t%c\t%d\t%d\t%d\t",transcriptName,chromosome,strand,
-          arru (exonStarts,0,int),arru (exonEnds,arrayMax (exonEnds) - 1,int),arrayMax (exonStarts));
+          arru (exonStarts,0,int),arru (exonEnds,arrayMax (exonEnds) - 1,int),(int)arrayMax (exonStarts));
   for (i = 0; i < arrayMax (exonStarts); i++) {
     printf ("%d%s",arru (exonStarts,i,int),i < arrayMax (exonStarts) - 1 ? "," : "\t");
   }
@@ -104,9 +98,10 @@ int main (int argc, char *argv[])
 {
   Stringa buffer;
   Array transcripts;
+  HashTable transcriptsByName;
   Array knownIsoforms;
   Array isoTranscripts;
-  Interval *currTranscript,testTranscript;
+  Interval *currTranscript;
   SubInterval *currExon;
   KnownIsoform *currKnownIsoform,*nextKnownIsoform;
   int i,j,k,l,m;
@@ -134,7 +129,13 @@ int main (int argc, char *argv[])
   arraySort (knownIsoforms,(ARRAYORDERF)sortKnownIsoformsById);
   intervalFind_addIntervalsToSearchSpace (argv[2],0);
   transcripts = intervalFind_getAllIntervals ();
-  arraySort (transcripts,(ARRAYORDERF)sortIntervalsByName);
+  transcriptsByName = hashTable_create (HASH_TABLE_STRING_KEYS,arrayMax (transcripts));
+  for (i = 0; i < arrayMax (transcripts); i++) {
+    currTranscript = arrp (transcripts,i,Interval);
+    if (hashTable_getString (transcriptsByName,currTranscript->name) == NULL) {
+      hashTable_putString (transcriptsByName,currTranscript->name,currTranscript);
+    }
+  }
   numberOfTranscripts = 0;
   i = 0; 
   while (i < arrayMax (knownIsoforms)) {
@@ -155,15 +156,12 @@ int main (int argc, char *argv[])
     i = j;
     arrayClear (isoTranscripts);
     for (k = 0; k < arrayMax (isoNames); k++) {
-      testTranscript.name = hlr_strdup (textItem (isoNames,k));
-      if (arrayFind (transcripts,&testTranscript,&index,(ARRAYORDERF)sortIntervalsByName)) {
-        currTranscript = arrp (transcripts,index,Interval);
+      if (currTranscript = hashTable_getString (transcriptsByName,textItem (isoNames,k))) {
         array (isoTranscripts,arrayMax (isoTranscripts),Interval*) = currTranscript;
       }
       else {
-         warn ("Unable to find transcript for isoform %s!",testTranscript.name);
+         warn ("Unable to find transcript for isoform %s!",textItem (isoNames,k));
       }
-      hlr_free (testTranscript.name);
     }
     if (arrayMax (isoTranscripts) > 0) {
       numberOfTranscripts += arrayMax (isoTranscripts);
@@ -272,7 +270,7 @@ int main (int argc, char *argv[])
     }
   }
   if (numberOfTranscripts != arrayMax (transcripts)) {
-    warn ("Number of transcripts in annotation file: %d",arrayMax (transcripts));
+    warn ("Number of transcripts in annotation file: %d",(int)arrayMax (transcripts));
     warn ("Number of transcripts in output file: %d",numberOfTranscripts);
   }
   return 0;
@@ -1,9 +1,13 @@
+#include <pthread.h>
+#include <unistd.h>
 #include "log.h"
 #include "format.h"
 #include "linestream.h"
+#include "outStream.h"
 #include "common.h"
-#include "bits.h"
+#include "symbolTable.h"
 #include "mrf.h"
+#include "bmrf.h"
 
 
 
@@ -13,323 +17,1374 @@
 
 
 
-#define INIT_MODE_FROM_FILE 1
-#define INIT_MODE_FROM_PIPE 2
+#define MRF_MAX_PARSER_THREADS 16
 
 
 
-static LineStream lsMrf = NULL;
-static Bits *presentColumnTypes = NULL;
-static Array columnTypes = NULL;
-static Texta columnHeaders = NULL;
-static Texta comments = NULL;
-static char *headerLine = NULL;
+typedef struct {
+  int lastId;
+  char *lastName;        // interned name of lastId, NULL if the cache is empty
+} TargetCache;
 
 
 
-static void mrf_addColumnType (char *type)
+#define MRF_CHUNK_FREE 0
+#define MRF_CHUNK_FILLED 1
+#define MRF_CHUNK_PARSING 2
+#define MRF_CHUNK_PARSED 3
+
+
+
+typedef struct {
+  Array lines;           // of type char, null-terminated lines
+  Array lineStarts;      // of type int, offset of each line in lines
+  Array originalLines;   // of type char, copy of lines before tokenization if the reader keeps lines
+  int firstLineNumber;
+  int isLast;            // no more lines follow this chunk
+  Array entries;         // of type MrfEntry, strings point into lines or strings
+  int numInitialized;    // number of entries with block Arrays
+  Arena strings;         // copies of strings of entries read from BMRF, NULL for MRF input
+  int state;             // MRF_CHUNK_*
+} MrfChunk;
+
+
+
+typedef struct {
+  pthread_t ioThread;
+  pthread_t *parserThreads;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;   // signalled whenever the state of a chunk changes
+  MrfChunk *chunks;      // ring buffer
+  int numChunks;
+  int chunkSize;         // maximal number of lines per chunk
+  int nextFill;          // counters of the chunks handed to the I/O thread, the parsers and the caller
+  int nextParse;
+  int nextDeliver;
+  MrfChunk *currChunk;   // chunk currently owned by the caller
+  int atEnd;
+  int stop;
+} MrfPipeline;
+
+
+
+struct _mrfReaderStruct_ {
+  LineStream ls;         // NULL if the input is BMRF
+  FILE *fp;              // BMRF input
+  BmrfReader bmrf;
+  Array columnTypes;     // of type int
+  Texta columnHeaders;
+  Texta comments;
+  char *headerLine;
+  MrfEntry entry;        // reused for every line, see mrfReader_next()
+  Stringa line;          // copy of the current line before tokenization if keepsLines
+  TargetCache cache;
+  MrfPipeline *pipeline; // NULL until mrfReader_nextBatch() is called
+  int numThreads;
+  int columnMask;        // columns that are parsed, see mrfReader_setColumns()
+  int isProjected;       // some columns are skipped
+  int lastColumn;        // index of the last parsed column if isProjected
+  int keepsLines;        // entries keep their input line, see mrfReader_keepLines()
+  Arena arena;           // strings of the entries returned by mrfReader_parse(), see mrfReader_setArena()
+};
+
+
+
+struct _mrfWriterStruct_ {
+  Array columnTypes;     // of type int
+  Texta columnHeaders;
+  Texta comments;
+  Stringa buffer;
+  OutStream output;      // destination of mrfWriter_putHeader() and mrfWriter_putEntry(), stdout unless set by mrfWriter_setOutput()
+  int isPassThrough;     // the columns are those of the input, so input lines can be written unchanged
+};
+
+
+
+static MrfReader defaultReader = NULL;
+static MrfWriter defaultWriter = NULL;
+
+
+
+static void mrf_stopPipeline (MrfReader reader);
+
+
+
+static int mrf_getColumnType (char *columnName)
+{
+  if (strEqual (columnName,MRF_COLUMN_NAME_BLOCKS)) {
+    return MRF_COLUMN_TYPE_BLOCKS;
+  }
+  else if (strEqual (columnName,MRF_COLUMN_NAME_SEQUENCE)) {
+    return MRF_COLUMN_TYPE_SEQUENCE;
+  }
+  else if (strEqual (columnName,MRF_COLUMN_NAME_QUALITY_SCORES)) {
+    return MRF_COLUMN_TYPE_QUALITY_SCORES;
+  }
+  else if (strEqual (columnName,MRF_COLUMN_NAME_QUERY_ID)) {
+    return MRF_COLUMN_TYPE_QUERY_ID;
+  }
+  die ("Unknown presentColumn: %s",columnName);
+  return 0;
+}
+
+
+
+static void mrf_addColumnType (Array columnTypes, Texta columnHeaders, char *columnName)
+{
+  array (columnTypes,arrayMax (columnTypes),int) = mrf_getColumnType (columnName);
+  textAdd (columnHeaders,columnName);
+}
+
+
+
+static MrfReader mrfReader_allocate (void) 
+{
+  MrfReader reader;
+
+  AllocVar (reader);
+  reader->columnTypes = arrayCreate (20,int);
+  reader->columnHeaders = textCreate (20);
+  reader->comments = textCreate (100);
+  reader->entry.read1.blocks = arrayCreate (5,MrfBlock);
+  reader->entry.read2.blocks = arrayCreate (5,MrfBlock);
+  reader->line = stringCreate (1000);
+  reader->columnMask = MRF_COLUMNS_ALL;
+  reader->numThreads = MAX (1,MIN (sysconf (_SC_NPROCESSORS_ONLN) - 1,MRF_MAX_PARSER_THREADS));
+  return reader;
+}
+
+
+
+static MrfReader mrfReader_createFromLineStream (LineStream ls) 
+{
+  MrfReader reader;
+  Texta tokens;
+  char *line;
+  int i;
+
+  reader = mrfReader_allocate ();
+  reader->ls = ls;
+  ls_bufferSet (reader->ls,1);
+  while (line = ls_nextLine (reader->ls)) {
+    if (line[0] == '#') {
+      textAdd (reader->comments,line + 1);
+    }
+    else {
+      ls_back (reader->ls,1);
+      break;
+    }
+  }
+  reader->headerLine = hlr_strdup (ls_nextLine (reader->ls));
+  tokens = textFieldtokP (reader->headerLine,"\t");
+  for (i = 0; i < arrayMax (tokens); i++) {
+    mrf_addColumnType (reader->columnTypes,reader->columnHeaders,textItem (tokens,i));
+  }
+  textDestroy (tokens);
+  return reader;
+}
+
+
+
+static MrfReader mrfReader_createFromBmrf (FILE *fp) 
+{
+  MrfReader reader;
+  int i;
+  static char *columnNames[] = {NULL,MRF_COLUMN_NAME_BLOCKS,MRF_COLUMN_NAME_SEQUENCE,
+                                MRF_COLUMN_NAME_QUALITY_SCORES,MRF_COLUMN_NAME_QUERY_ID};
+
+  reader = mrfReader_allocate ();
+  reader->fp = fp;
+  reader->bmrf = bmrfReader_create (fp,reader->columnTypes,reader->comments);
+  for (i = 0; i < arrayMax (reader->columnTypes); i++) {
+    textAdd (reader->columnHeaders,columnNames[arru (reader->columnTypes,i,int)]);
+  }
+  return reader;
+}
+
+
+
+/**
+ * Open an MRF reader on a file. The comments and the header line are read immediately.
+ * Binary MRF (BMRF, see bmrf.c) is detected automatically.
+ * @param[in] fileName File name, use "-" to denote stdin
+ * @return A reader object. Several readers can be open at the same time.
+ */
+MrfReader mrfReader_open (char *fileName) 
+{
+  FILE *fp;
+  int c;
+
+  if (strEqual (fileName,"-")) {
+    fp = stdin;
+  }
+  else if (!(fp = fopen (fileName,"r"))) {
+    die ("Unable to open file: %s",fileName);
+  }
+  c = getc (fp);
+  if (c != EOF && bmrf_isBinary (c)) {
+    ungetc (c,fp);
+    return mrfReader_createFromBmrf (fp);
+  }
+  if (fp == stdin) {
+    if (c != EOF) {
+      ungetc (c,fp);
+    }
+  }
+  else {
+    fclose (fp);
+  }
+  return mrfReader_createFromLineStream (ls_createFromFile (fileName));
+}
+
+
+
+/**
+ * Open an MRF reader on the output of a command.
+ * @param[in] cmd Command to be executed
+ */
+MrfReader mrfReader_openFromPipe (char *cmd) 
+{
+  return mrfReader_createFromLineStream (ls_createFromPipe (cmd));
+}
+
+
+
+/**
+ * Byte offset of the next entry of a reader, see mrfIndex.c.
+ * @param[in] reader A reader opened on an MRF text file
+ */
+off_t mrfReader_tell (MrfReader reader)
+{
+  if (reader->ls == NULL) {
+    die ("Random access is only supported for MRF text files");
+  }
+  return ls_tell (reader->ls);
+}
+
+
+
+/**
+ * Position a reader such that the next call to mrfReader_next() returns the entry starting at offset.
+ * @param[in] reader A reader opened on an MRF text file (not stdin)
+ * @param[in] offset Offset obtained from mrfReader_tell()
+ */
+void mrfReader_seek (MrfReader reader, off_t offset)
+{
+  if (reader->ls == NULL) {
+    die ("Random access is only supported for MRF text files");
+  }
+  ls_seek (reader->ls,offset);
+}
+
+
+
+/**
+ * Get the column types of a reader.
+ * @return Array of type int with one MRF_COLUMN_TYPE_* per column. The memory belongs to the reader.
+ */
+Array mrfReader_getColumnTypes (MrfReader reader)
+{
+  return reader->columnTypes;
+}
+
+
+
+/**
+ * Get the comments of a reader.
+ * @return Texta of comment lines without the leading '#'. The memory belongs to the reader.
+ */
+Texta mrfReader_getComments (MrfReader reader)
+{
+  return reader->comments;
+}
+
+
+
+/**
+ * Close an MRF reader and free all associated memory, including the last entry returned by mrfReader_next().
+ */
+void mrfReader_close (MrfReader reader) 
+{
+  if (reader == NULL) {
+    return;
+  }
+  if (reader->pipeline != NULL) {
+    mrf_stopPipeline (reader);
+  }
+  if (reader->bmrf != NULL) {
+    bmrfReader_destroy (reader->bmrf);
+    if (reader->fp != stdin) {
+      fclose (reader->fp);
+    }
+  }
+  else {
+    ls_destroy (reader->ls);
+  }
+  arrayDestroy (reader->columnTypes);
+  textDestroy (reader->columnHeaders);
+  textDestroy (reader->comments);
+  hlr_free (reader->headerLine);
+  arrayDestroy (reader->entry.read1.blocks);
+  arrayDestroy (reader->entry.read2.blocks);
+  stringDestroy (reader->line);
+  freeMem (reader);
+}
+
+
+
+/**
+ * Initialize the module module from a file.
+ * @param[in] fileName File name, use "-" to denote stdin
+ * @see mrfReader_open()
+ */
+void mrf_init (char *fileName) 
+{
+  defaultReader = mrfReader_open (fileName);
+  defaultWriter = mrfWriter_create (defaultReader);
+}
+
+
+
+/**
+ * Initialize the module from a command.
+ * @param[in] cmd command to be executed
+ * @see mrfReader_openFromPipe()
+ */
+void mrf_initFromPipe (char *cmd) 
+{
+  defaultReader = mrfReader_openFromPipe (cmd);
+  defaultWriter = mrfWriter_create (defaultReader);
+}
+
+
+
+/**
+ * Initialize the module from a file, parsing only some of the columns.
+ * @param[in] fileName File name, use "-" to denote stdin
+ * @param[in] columnMask Columns to be parsed, see mrfReader_setColumns()
+ */
+void mrf_initWithColumns (char *fileName, int columnMask)
+{
+  mrf_init (fileName);
+  mrfReader_setColumns (defaultReader,columnMask);
+}
+
+
+
+/**
+ * Keep the input line of each entry, see mrfReader_keepLines().
+ * @pre The module has been initialized using mrf_init().
+ */
+void mrf_keepLines (void)
+{
+  mrfReader_keepLines (defaultReader);
+}
+
+
+
+/**
+ * Add a new column type to the output written by mrf_writeHeader() and mrf_writeEntry(). 
+ * @param[in] columnName Name of the new column
+ */
+void mrf_addNewColumnType (char* columnName)
+{
+  mrfWriter_addNewColumnType (defaultWriter,columnName);
+}
+
+
+
+/**
+ * Deinitialize the mrf module.
+ */
+void mrf_deInit (void) 
+{
+  mrfReader_close (defaultReader);
+  mrfWriter_destroy (defaultWriter);
+  defaultReader = NULL;
+  defaultWriter = NULL;
+}
+
+
+
+static void mrf_resetRead (MrfRead *currRead)
+{
+  arrayMax (currRead->blocks) = 0;
+  currRead->sequence = NULL;
+  currRead->qualityScores = NULL;
+  currRead->queryId = NULL;
+}
+
+
+
+static Field mrf_nextBlockField (FieldCursor *fields, char *blockString)
+{
+  Field field;
+
+  if (!fieldNext (fields,&field)) {
+    die ("Invalid alignment block: %s",blockString);
+  }
+  return field;
+}
+
+
+
+/**
+ * Intern a target name. Consecutive blocks usually share their target, so the last name is cached 
+ * per caller, which keeps parser threads from contending for the symbol table.
+ */
+static int mrf_internTarget (char *targetName, TargetCache *cache)
+{
+  if (cache->lastName == NULL || !strEqual (targetName,cache->lastName)) {
+    cache->lastId = symbolTable_intern (targetName);
+    cache->lastName = symbolTable_getName (cache->lastId);
+  }
+  return cache->lastId;
+}
+
+
+
+static void mrf_processBlocks (char *blockString, MrfRead *currRead, TargetCache *cache)
+{
+  MrfBlock *currBlock;
+  FieldCursor blocks,fields;
+  char *block;
+
+  fieldCursorInit (&blocks,blockString,",");
+  while (block = fieldNextZ (&blocks)) {
+    currBlock = arrayp (currRead->blocks,arrayMax (currRead->blocks),MrfBlock);
+    fieldCursorInit (&fields,block,":");
+    currBlock->targetId = mrf_internTarget (fieldNextZ (&fields),cache);
+    currBlock->targetName = cache->lastName;
+    currBlock->strand = mrf_nextBlockField (&fields,blockString).s[0];
+    currBlock->targetStart = parseInt (mrf_nextBlockField (&fields,blockString));
+    currBlock->targetEnd = parseInt (mrf_nextBlockField (&fields,blockString));
+    currBlock->queryStart = parseInt (mrf_nextBlockField (&fields,blockString));
+    currBlock->queryEnd = parseInt (mrf_nextBlockField (&fields,blockString));
+  }
+}
+
+
+
+static void mrf_splitPair (char *token, char **value1, char **value2, int isPairedEnd)
+{
+  char *pos;
+
+  if (isPairedEnd == 1) {
+    pos = strchr (token,'|');
+    if (pos == NULL) {
+      die ("Expected paired-end value: %s",token);
+    }
+    *pos = '\0';
+    *value2 = pos + 1;
+  }
+  *value1 = token;
+}
+
+
+
+/**
+ * Tokenize a line in place into currEntry.
+ * @return 1 if the line holds an entry, 0 if it is empty, a comment or the header line
+ */
+static int mrf_parseLine (MrfReader reader, char *line, MrfEntry *currEntry, TargetCache *cache, int lineNumber)
 {
-  if (strEqual (type,MRF_COLUMN_NAME_BLOCKS)) {
-    bitSetOne (presentColumnTypes,MRF_COLUMN_TYPE_BLOCKS);
-    array (columnTypes,arrayMax (columnTypes),int) = MRF_COLUMN_TYPE_BLOCKS;
-    textAdd (columnHeaders,MRF_COLUMN_NAME_BLOCKS);
+  FieldCursor columns;
+  char *token,*blocks2;
+  int index,columnType;
+
+  if (line[0] == '\0' || line[0] == '#' || strEqual (line,reader->headerLine)) {
+    return 0;
   }
-  else if (strEqual (type,MRF_COLUMN_NAME_SEQUENCE)) {
-    bitSetOne (presentColumnTypes,MRF_COLUMN_TYPE_SEQUENCE);
-    array (columnTypes,arrayMax (columnTypes),int) = MRF_COLUMN_TYPE_SEQUENCE;
-    textAdd (columnHeaders,MRF_COLUMN_NAME_SEQUENCE);
+  if (!reader->isProjected) {
+    currEntry->isPairedEnd = strchr (line,'|') ? 1 : 0;
   }
-  else if (strEqual (type,MRF_COLUMN_NAME_QUALITY_SCORES)) {
-    bitSetOne (presentColumnTypes,MRF_COLUMN_TYPE_QUALITY_SCORES);
-    array (columnTypes,arrayMax (columnTypes),int) = MRF_COLUMN_TYPE_QUALITY_SCORES;
-    textAdd (columnHeaders,MRF_COLUMN_NAME_QUALITY_SCORES);
+  mrf_resetRead (&currEntry->read1);
+  mrf_resetRead (&currEntry->read2);
+  index = 0;
+  fieldCursorInit (&columns,line,"\t");
+  while (token = fieldNextZ (&columns)) {
+    if (index >= arrayMax (reader->columnTypes)) {
+      die ("Too many columns in line %d",lineNumber);
+    }
+    if (index == 0 && reader->isProjected) {
+      // every column of a paired-end entry holds two values, so the first one tells
+      currEntry->isPairedEnd = strchr (token,'|') ? 1 : 0;
+    }
+    columnType = arru (reader->columnTypes,index,int);
+    if (!(reader->columnMask & MRF_COLUMN_MASK (columnType))) {
+      ;
+    }
+    else if (columnType == MRF_COLUMN_TYPE_BLOCKS) {
+      mrf_splitPair (token,&token,&blocks2,currEntry->isPairedEnd);
+      mrf_processBlocks (token,&currEntry->read1,cache);
+      if (currEntry->isPairedEnd == 1) {
+        mrf_processBlocks (blocks2,&currEntry->read2,cache);
+      }
+    }
+    else if (columnType == MRF_COLUMN_TYPE_SEQUENCE) {
+      mrf_splitPair (token,&currEntry->read1.sequence,&currEntry->read2.sequence,currEntry->isPairedEnd);
+    }
+    else if (columnType == MRF_COLUMN_TYPE_QUALITY_SCORES) {
+      mrf_splitPair (token,&currEntry->read1.qualityScores,&currEntry->read2.qualityScores,currEntry->isPairedEnd);
+    }
+    else if (columnType == MRF_COLUMN_TYPE_QUERY_ID) {
+      mrf_splitPair (token,&currEntry->read1.queryId,&currEntry->read2.queryId,currEntry->isPairedEnd);
+    }
+    else {
+      die ("Unknown columnType: %d",columnType);
+    }
+    if (reader->isProjected && index == reader->lastColumn) {
+      break;
+    }
+    index++;
   }
-  else if (strEqual (type,MRF_COLUMN_NAME_QUERY_ID)) {
-    bitSetOne (presentColumnTypes,MRF_COLUMN_TYPE_QUERY_ID);
-    array (columnTypes,arrayMax (columnTypes),int) = MRF_COLUMN_TYPE_QUERY_ID;
-    textAdd (columnHeaders,MRF_COLUMN_NAME_QUERY_ID);
+  return 1;
+}
+
+
+
+/**
+ * Returns a pointer to the next MrfEntry of a reader. 
+ * The line is tokenized in place: all strings of the returned entry point into the line buffer of the reader 
+ * and the block Arrays are reused, so no memory is allocated in the steady state.
+ * @param[in] reader An MRF reader, see mrfReader_open()
+ * @return The entry, NULL if the end of the stream was reached
+ * @note The memory belongs to the reader. The entry, including its block Arrays and strings, 
+   is overwritten by the next call to mrfReader_next(); use mrf_copyEntry() to keep it.
+   Do not mix calls to mrfReader_next() and mrfReader_nextBatch() on the same reader.
+ */
+MrfEntry* mrfReader_next (MrfReader reader) 
+{
+  MrfEntry *currEntry;
+  char *line;
+
+  currEntry = &reader->entry;
+  if (reader->bmrf != NULL) {
+    return bmrfReader_next (reader->bmrf,currEntry) ? currEntry : NULL;
+  }
+  while (line = ls_nextLine (reader->ls)) {
+    if (reader->keepsLines) {
+      stringCpy (reader->line,line);
+    }
+    if (mrf_parseLine (reader,line,currEntry,&reader->cache,ls_lineCountGet (reader->ls))) {
+      currEntry->line = reader->keepsLines ? string (reader->line) : NULL;
+      return currEntry;
+    }
+  }
+  return NULL;
+}
+
+
+
+/* ------------------------------- batched, multi-threaded parsing ------------------------------- */
+
+
+
+static void mrf_initEntry (MrfChunk *currChunk, MrfEntry *currEntry, int index)
+{
+  if (index >= currChunk->numInitialized) {
+    currEntry->read1.blocks = arrayCreate (5,MrfBlock);
+    currEntry->read2.blocks = arrayCreate (5,MrfBlock);
+    currChunk->numInitialized = index + 1;
+  }
+}
+
+
+
+/**
+ * Read up to chunkSize lines into a chunk. Each line is stored null-terminated in chunk->lines.
+ */
+static void mrf_fillChunk (MrfReader reader, MrfChunk *currChunk)
+{
+  MrfPipeline *pipeline;
+  char *line;
+  int length;
+  int max;
+
+  pipeline = reader->pipeline;
+  arrayMax (currChunk->lines) = 0;
+  arrayMax (currChunk->lineStarts) = 0;
+  currChunk->firstLineNumber = ls_lineCountGet (reader->ls) + 1;
+  currChunk->isLast = 1;
+  while (arrayMax (currChunk->lineStarts) < pipeline->chunkSize) {
+    if (!(line = ls_nextLine (reader->ls))) {
+      return;
+    }
+    length = strlen (line) + 1;
+    max = arrayMax (currChunk->lines);
+    array (currChunk->lineStarts,arrayMax (currChunk->lineStarts),int) = max;
+    array (currChunk->lines,max + length - 1,char) = '\0';
+    memcpy (arrp (currChunk->lines,max,char),line,length);
+  }
+  currChunk->isLast = 0;
+}
+
+
+
+static void mrf_parseChunk (MrfReader reader, MrfChunk *currChunk, TargetCache *cache)
+{
+  MrfEntry *currEntry;
+  int numEntries;
+  int i;
+
+  arrayMax (currChunk->originalLines) = 0;
+  if (reader->keepsLines && arrayMax (currChunk->lines) > 0) {
+    array (currChunk->originalLines,arrayMax (currChunk->lines) - 1,char) = '\0';
+    memcpy (arrp (currChunk->originalLines,0,char),arrp (currChunk->lines,0,char),arrayMax (currChunk->lines));
+  }
+  numEntries = 0;
+  for (i = 0; i < arrayMax (currChunk->lineStarts); i++) {
+    currEntry = arrayp (currChunk->entries,numEntries,MrfEntry);
+    mrf_initEntry (currChunk,currEntry,numEntries);
+    currEntry->line = reader->keepsLines ? arrp (currChunk->originalLines,arru (currChunk->lineStarts,i,int),char) : NULL;
+    numEntries += mrf_parseLine (reader,arrp (currChunk->lines,arru (currChunk->lineStarts,i,int),char),
+                                 currEntry,cache,currChunk->firstLineNumber + i);
+  }
+  arrayMax (currChunk->entries) = numEntries;
+}
+
+
+
+static char* mrf_keepString (MrfChunk *currChunk, char *s)
+{
+  return arena_strdup (currChunk->strings,s);
+}
+
+
+
+static void mrf_keepRead (MrfChunk *currChunk, MrfRead *to, MrfRead *from)
+{
+  arraySetMax (to->blocks,arrayMax (from->blocks));
+  memcpy (arrp (to->blocks,0,MrfBlock),arrp (from->blocks,0,MrfBlock),arrayMax (from->blocks) * sizeof (MrfBlock));
+  to->sequence = mrf_keepString (currChunk,from->sequence);
+  to->qualityScores = mrf_keepString (currChunk,from->qualityScores);
+  to->queryId = mrf_keepString (currChunk,from->queryId);
+}
+
+
+
+/**
+ * Fill a chunk in the calling thread (BMRF input or no parser threads).
+ */
+static void mrf_fillChunkSequentially (MrfReader reader, MrfChunk *currChunk)
+{
+  MrfPipeline *pipeline;
+  MrfEntry *currEntry;
+  MrfEntry *keptEntry;
+
+  pipeline = reader->pipeline;
+  if (reader->bmrf == NULL) {
+    mrf_fillChunk (reader,currChunk);
+    mrf_parseChunk (reader,currChunk,&reader->cache);
+    return;
+  }
+  arena_reset (currChunk->strings);
+  arrayMax (currChunk->entries) = 0;
+  currChunk->isLast = 1;
+  while (arrayMax (currChunk->entries) < pipeline->chunkSize) {
+    if (!(currEntry = mrfReader_next (reader))) {
+      return;
+    }
+    keptEntry = arrayp (currChunk->entries,arrayMax (currChunk->entries),MrfEntry);
+    mrf_initEntry (currChunk,keptEntry,arrayMax (currChunk->entries) - 1);
+    keptEntry->isPairedEnd = currEntry->isPairedEnd;
+    keptEntry->line = NULL;
+    mrf_keepRead (currChunk,&keptEntry->read1,&currEntry->read1);
+    mrf_keepRead (currChunk,&keptEntry->read2,&currEntry->read2);
+  }
+  currChunk->isLast = 0;
+}
+
+
+
+static void* mrf_ioThread (void *data)
+{
+  MrfReader reader;
+  MrfPipeline *pipeline;
+  MrfChunk *currChunk;
+  int isLast;
+
+  reader = data;
+  pipeline = reader->pipeline;
+  do {
+    pthread_mutex_lock (&pipeline->mutex);
+    while (!pipeline->stop && pipeline->chunks[pipeline->nextFill % pipeline->numChunks].state != MRF_CHUNK_FREE) {
+      pthread_cond_wait (&pipeline->cond,&pipeline->mutex);
+    }
+    if (pipeline->stop) {
+      pthread_mutex_unlock (&pipeline->mutex);
+      break;
+    }
+    currChunk = &pipeline->chunks[pipeline->nextFill++ % pipeline->numChunks];
+    pthread_mutex_unlock (&pipeline->mutex);
+    mrf_fillChunk (reader,currChunk);
+    isLast = currChunk->isLast;
+    pthread_mutex_lock (&pipeline->mutex);
+    currChunk->state = MRF_CHUNK_FILLED;
+    pthread_cond_broadcast (&pipeline->cond);
+    pthread_mutex_unlock (&pipeline->mutex);
+  } while (!isLast);
+  return NULL;
+}
+
+
+
+static void* mrf_parserThread (void *data)
+{
+  MrfReader reader;
+  MrfPipeline *pipeline;
+  MrfChunk *currChunk;
+  TargetCache cache;
+
+  reader = data;
+  pipeline = reader->pipeline;
+  cache.lastName = NULL;
+  cache.lastId = -1;
+  while (1) {
+    pthread_mutex_lock (&pipeline->mutex);
+    while (!pipeline->stop && pipeline->chunks[pipeline->nextParse % pipeline->numChunks].state != MRF_CHUNK_FILLED) {
+      pthread_cond_wait (&pipeline->cond,&pipeline->mutex);
+    }
+    if (pipeline->stop) {
+      pthread_mutex_unlock (&pipeline->mutex);
+      break;
+    }
+    currChunk = &pipeline->chunks[pipeline->nextParse++ % pipeline->numChunks];
+    currChunk->state = MRF_CHUNK_PARSING;
+    pthread_mutex_unlock (&pipeline->mutex);
+    mrf_parseChunk (reader,currChunk,&cache);
+    pthread_mutex_lock (&pipeline->mutex);
+    currChunk->state = MRF_CHUNK_PARSED;
+    pthread_cond_broadcast (&pipeline->cond);
+    pthread_mutex_unlock (&pipeline->mutex);
+  }
+  return NULL;
+}
+
+
+
+static void mrf_startPipeline (MrfReader reader, int chunkSize)
+{
+  MrfPipeline *pipeline;
+  int i;
+
+  AllocVar (pipeline);
+  reader->pipeline = pipeline;
+  pipeline->chunkSize = chunkSize;
+  if (reader->bmrf != NULL) {
+    reader->numThreads = 0;
+  }
+  pipeline->numChunks = reader->numThreads > 0 ? 2 * reader->numThreads + 2 : 1;
+  pipeline->chunks = needMem (pipeline->numChunks * sizeof (MrfChunk));
+  for (i = 0; i < pipeline->numChunks; i++) {
+    pipeline->chunks[i].lines = arrayCreate (chunkSize * 200,char);
+    pipeline->chunks[i].lineStarts = arrayCreate (chunkSize,int);
+    pipeline->chunks[i].originalLines = arrayCreate (reader->keepsLines ? chunkSize * 200 : 1,char);
+    pipeline->chunks[i].entries = arrayCreate (chunkSize,MrfEntry);
+    pipeline->chunks[i].strings = reader->bmrf != NULL ? arena_create (0,0) : NULL;
+  }
+  if (reader->numThreads == 0) {
+    return;
+  }
+  pthread_mutex_init (&pipeline->mutex,NULL);
+  pthread_cond_init (&pipeline->cond,NULL);
+  pipeline->parserThreads = needMem (reader->numThreads * sizeof (pthread_t));
+  for (i = 0; i < reader->numThreads; i++) {
+    if (pthread_create (&pipeline->parserThreads[i],NULL,mrf_parserThread,reader) != 0) {
+      die ("Unable to create parser thread");
+    }
+  }
+  if (pthread_create (&pipeline->ioThread,NULL,mrf_ioThread,reader) != 0) {
+    die ("Unable to create I/O thread");
+  }
+}
+
+
+
+static void mrf_stopPipeline (MrfReader reader)
+{
+  MrfPipeline *pipeline;
+  MrfEntry *currEntry;
+  int i,j;
+
+  pipeline = reader->pipeline;
+  if (reader->numThreads > 0) {
+    pthread_mutex_lock (&pipeline->mutex);
+    pipeline->stop = 1;
+    pthread_cond_broadcast (&pipeline->cond);
+    pthread_mutex_unlock (&pipeline->mutex);
+    pthread_join (pipeline->ioThread,NULL);
+    for (i = 0; i < reader->numThreads; i++) {
+      pthread_join (pipeline->parserThreads[i],NULL);
+    }
+    pthread_mutex_destroy (&pipeline->mutex);
+    pthread_cond_destroy (&pipeline->cond);
+    freeMem (pipeline->parserThreads);
+  }
+  for (i = 0; i < pipeline->numChunks; i++) {
+    arrayMax (pipeline->chunks[i].entries) = pipeline->chunks[i].numInitialized;
+    for (j = 0; j < pipeline->chunks[i].numInitialized; j++) {
+      currEntry = arrp (pipeline->chunks[i].entries,j,MrfEntry);
+      arrayDestroy (currEntry->read1.blocks);
+      arrayDestroy (currEntry->read2.blocks);
+    }
+    arrayDestroy (pipeline->chunks[i].lines);
+    arrayDestroy (pipeline->chunks[i].lineStarts);
+    arrayDestroy (pipeline->chunks[i].originalLines);
+    arrayDestroy (pipeline->chunks[i].entries);
+    arena_destroy (pipeline->chunks[i].strings);
+  }
+  freeMem (pipeline->chunks);
+  freeMem (pipeline);
+  reader->pipeline = NULL;
+}
+
+
+
+/**
+ * Set the number of parser threads used by mrfReader_nextBatch(). 
+ * By default, one parser thread per available core is used (at most MRF_MAX_PARSER_THREADS).
+ * @param[in] reader An MRF reader
+ * @param[in] numThreads Number of parser threads; 0 parses in the calling thread
+ * @pre mrfReader_nextBatch() has not been called yet
+ */
+void mrfReader_setNumThreads (MrfReader reader, int numThreads)
+{
+  if (reader->pipeline != NULL) {
+    die ("mrfReader_setNumThreads: batch parsing has already started");
+  }
+  reader->numThreads = numThreads;
+}
+
+
+
+/**
+ * Keep the input line of each entry, so that entries can be written unchanged by mrfWriter_putUnmodifiedEntry().
+ * Lines are not kept by default, which saves copying every line before it is tokenized.
+ * @param[in] reader An MRF reader
+ * @pre No entry has been read yet
+ * @note Lines are never kept for BMRF input.
+ */
+void mrfReader_keepLines (MrfReader reader)
+{
+  if (reader->pipeline != NULL) {
+    die ("mrfReader_keepLines: batch parsing has already started");
+  }
+  reader->keepsLines = reader->bmrf == NULL;
+}
+
+
+
+/**
+ * Make mrfReader_parse() allocate the strings of the entries it returns in an arena instead of individually on the heap.
+ * @param[in] reader An MRF reader
+ * @param[in] arena Arena supplied by the caller, who owns it. NULL restores individual allocation.
+ */
+void mrfReader_setArena (MrfReader reader, Arena arena)
+{
+  reader->arena = arena;
+}
+
+
+
+/**
+ * Restrict the columns that are parsed. The other columns are skipped by the tokenizer: their strings are NULL, 
+ * and parsing stops after the last requested column.
+ * @param[in] reader An MRF reader
+ * @param[in] columnMask Combination of MRF_COLUMN_MASK() values, e.g. MRF_COLUMNS_BLOCKS; the alignment blocks are always parsed
+ * @pre No entry has been read yet
+ * @note Entries of a projected reader cannot be written with all columns, unless their input line is kept (see mrfReader_keepLines()).
+ */
+void mrfReader_setColumns (MrfReader reader, int columnMask)
+{
+  int i;
+
+  reader->columnMask = columnMask | MRF_COLUMNS_BLOCKS;
+  if (reader->bmrf != NULL) {
+    bmrfReader_setColumns (reader->bmrf,reader->columnMask);
+    return;
+  }
+  reader->isProjected = 0;
+  reader->lastColumn = 0;
+  for (i = 0; i < arrayMax (reader->columnTypes); i++) {
+    if (reader->columnMask & MRF_COLUMN_MASK (arru (reader->columnTypes,i,int))) {
+      reader->lastColumn = i;
+    }
+    else {
+      reader->isProjected = 1;
+    }
+  }
+}
+
+
+
+/**
+ * Returns the next batch of entries of a reader. 
+ * A dedicated thread reads chunks of lines while a pool of parser threads turns them into entries; 
+ * batches are delivered in input order. The pipeline is started by the first call.
+ * @param[in] reader An MRF reader, see mrfReader_open()
+ * @param[in] maxEntries Maximal number of entries per batch, e.g. MRF_DEFAULT_BATCH_SIZE; only the value of the first call is used
+ * @return Array of type MrfEntry, NULL if the end of the stream was reached
+ * @note The memory belongs to the reader. The Array and its entries stay valid until the next call to 
+   mrfReader_nextBatch(); use mrf_copyEntry() to keep an entry. 
+   Do not mix calls to mrfReader_next() and mrfReader_nextBatch() on the same reader.
+ */
+Array mrfReader_nextBatch (MrfReader reader, int maxEntries) 
+{
+  MrfPipeline *pipeline;
+  MrfChunk *currChunk;
+
+  if (reader->pipeline == NULL) {
+    mrf_startPipeline (reader,maxEntries);
+  }
+  pipeline = reader->pipeline;
+  if (pipeline->atEnd) {
+    return NULL;
+  }
+  if (reader->numThreads == 0) {
+    currChunk = &pipeline->chunks[0];
+    do {
+      mrf_fillChunkSequentially (reader,currChunk);
+    } while (arrayMax (currChunk->entries) == 0 && !currChunk->isLast);
+    pipeline->atEnd = currChunk->isLast;
+    return arrayMax (currChunk->entries) > 0 ? currChunk->entries : NULL;
+  }
+  pthread_mutex_lock (&pipeline->mutex);
+  while (1) {
+    if (pipeline->currChunk != NULL) {
+      pipeline->currChunk->state = MRF_CHUNK_FREE;
+      pipeline->currChunk = NULL;
+      pthread_cond_broadcast (&pipeline->cond);
+    }
+    currChunk = &pipeline->chunks[pipeline->nextDeliver % pipeline->numChunks];
+    while (currChunk->state != MRF_CHUNK_PARSED) {
+      pthread_cond_wait (&pipeline->cond,&pipeline->mutex);
+    }
+    pipeline->nextDeliver++;
+    pipeline->currChunk = currChunk;
+    if (arrayMax (currChunk->entries) > 0 || currChunk->isLast) {
+      break;
+    }
+  }
+  pthread_mutex_unlock (&pipeline->mutex);
+  pipeline->atEnd = currChunk->isLast;
+  return arrayMax (currChunk->entries) > 0 ? currChunk->entries : NULL;
+}
+
+
+
+/**
+ * Returns the next batch of entries. 
+ * @pre The module has been initialized using mrf_init().
+ * @see mrfReader_nextBatch()
+ */
+Array mrf_nextBatch (int maxEntries) 
+{
+  return mrfReader_nextBatch (defaultReader,maxEntries);
+}
+
+
+
+/**
+ * Returns a pointer to next MrfEntry. 
+ * @pre The module has been initialized using mrf_init().
+ * @see mrfReader_next()
+ */
+MrfEntry* mrf_nextEntry (void) 
+{
+  return mrfReader_next (defaultReader); 
+}
+
+
+
+static void mrf_copyRead (MrfRead *to, MrfRead *from, Arena arena)
+{
+  to->blocks = arrayCopy (from->blocks);
+  if (arena != NULL) {
+    to->sequence = arena_strdup (arena,from->sequence);
+    to->qualityScores = arena_strdup (arena,from->qualityScores);
+    to->queryId = arena_strdup (arena,from->queryId);
+    return;
+  }
+  to->sequence = hlr_strdup0 (from->sequence);
+  to->qualityScores = hlr_strdup0 (from->qualityScores);
+  to->queryId = hlr_strdup0 (from->queryId);
+}
+
+
+
+/**
+ * Copy an MrfEntry such that it no longer refers to memory owned by a reader, allocating its strings in an arena.
+ * @param[in] to Pointer to the destination entry, must be allocated by the user
+ * @param[in] from The entry to be copied, typically obtained from mrfReader_next()
+ * @param[in] arena Arena that receives the strings; NULL allocates them individually on the heap
+ * @note The block Arrays of 'to' belong to the user, its strings to the arena.
+ */
+void mrf_copyEntryToArena (MrfEntry *to, MrfEntry *from, Arena arena)
+{
+  to->isPairedEnd = from->isPairedEnd;
+  to->line = NULL;
+  mrf_copyRead (&to->read1,&from->read1,arena);
+  if (from->isPairedEnd == 1) {
+    mrf_copyRead (&to->read2,&from->read2,arena);
   }
   else {
-    die ("Unknown presentColumn: %s",type);
+    memset (&to->read2,0,sizeof (MrfRead));
   }
 }
 
 
 
-static void mrf_doInit (char *arg, int initMode) 
+/**
+ * Copy an MrfEntry such that it no longer refers to memory owned by a reader.
+ * @param[in] to Pointer to the destination entry, must be allocated by the user
+ * @param[in] from The entry to be copied, typically obtained from mrfReader_next()
+ * @note The block Arrays and strings of 'to' belong to the user, except for the interned target names.
+ */
+void mrf_copyEntry (MrfEntry *to, MrfEntry *from)
+{
+  mrf_copyEntryToArena (to,from,NULL);
+}
+
+
+
+/**
+ * Returns an Array of all remaining MrfEntries of a reader.
+ * @note The memory belongs to the user. Each entry is a copy, see mrf_copyEntry(). 
+   This costs several allocations per entry unless the strings go to an arena, see mrfReader_setArena(); 
+   mrfReader_load() is much more compact.
+ */
+Array mrfReader_parse (MrfReader reader) 
 {
-  Texta tokens;
-  char *line;
-  int i;
+  Array mrfEntries;
+  MrfEntry *currEntry;
 
-  columnTypes = arrayCreate (20,int);
-  columnHeaders = textCreate (20);
-  presentColumnTypes = bitAlloc (100);
-  comments = textCreate (100);
-  if (initMode == INIT_MODE_FROM_FILE) {
-    lsMrf = ls_createFromFile (arg);
-  }
-  else if (initMode == INIT_MODE_FROM_PIPE) {
-    lsMrf = ls_createFromPipe (arg);
-  }
-  else {
-    die ("Unknown init mode");
-  }
-  ls_bufferSet (lsMrf,1);
-  while (line = ls_nextLine (lsMrf)) {
-    if (line[0] == '#') {
-      textAdd (comments,line + 1);
-    }
-    else {
-      ls_back (lsMrf,1);
-      break;
-    }
-  }
-  headerLine = hlr_strdup (ls_nextLine (lsMrf));
-  tokens = textFieldtokP (headerLine,"\t");
-  for (i = 0; i < arrayMax (tokens); i++) {
-    mrf_addColumnType (textItem (tokens,i));
+  mrfEntries = arrayCreate (100000,MrfEntry);
+  while (currEntry = mrfReader_next (reader)) {
+    mrf_copyEntryToArena (arrayp (mrfEntries,arrayMax (mrfEntries),MrfEntry),currEntry,reader->arena);
   }
+  return mrfEntries;
 }
 
 
 
 /**
- * Initialize the module module from a file.
- * @param[in] fileName File name, use "-" to denote stdin
+ * Returns an Array of MrfEntries.
+ * @pre The module has been initialized using mrf_init().
+ * @see mrfReader_parse()
  */
-void mrf_init (char *fileName) 
+Array mrf_parse (void) 
 {
-  mrf_doInit (fileName,INIT_MODE_FROM_FILE);
+  return mrfReader_parse (defaultReader);
 }
 
 
 
-/**
- * Initialize the module from a command.
- * @param[in] cmd command to be executed
- */
-void mrf_initFromPipe (char *cmd) 
+static int mrfTable_addString (MrfTable table, char *s)
+{
+  int offset;
+  int length;
+
+  if (s == NULL) {
+    return -1;
+  }
+  offset = arrayMax (table->strings);
+  length = strlen (s) + 1;
+  array (table->strings,offset + length - 1,char) = '\0';
+  memcpy (arrp (table->strings,offset,char),s,length);
+  return offset;
+}
+
+
+
+static void mrfTable_addRead (MrfTable table, MrfRead *currRead)
 {
-  mrf_doInit (cmd,INIT_MODE_FROM_PIPE);
+  MrfBlock *currBlock;
+  int i;
+
+  for (i = 0; i < arrayMax (currRead->blocks); i++) {
+    currBlock = arrp (currRead->blocks,i,MrfBlock);
+    array (table->targetIds,table->numBlocks,int) = currBlock->targetId;
+    array (table->strands,table->numBlocks,char) = currBlock->strand;
+    array (table->targetStarts,table->numBlocks,int) = currBlock->targetStart;
+    array (table->targetEnds,table->numBlocks,int) = currBlock->targetEnd;
+    array (table->queryStarts,table->numBlocks,int) = currBlock->queryStart;
+    array (table->queryEnds,table->numBlocks,int) = currBlock->queryEnd;
+    table->numBlocks++;
+  }
+  array (table->sequences,table->numReads,int) = mrfTable_addString (table,currRead->sequence);
+  array (table->qualityScores,table->numReads,int) = mrfTable_addString (table,currRead->qualityScores);
+  array (table->queryIds,table->numReads,int) = mrfTable_addString (table,currRead->queryId);
+  table->numReads++;
+  array (table->blockOffsets,table->numReads,int) = table->numBlocks;
 }
 
 
 
 /**
- * Add a new column type. 
- * @param[in] columnName Name of the new column
+ * Load all remaining entries of a reader into a compact column-wise table. 
+ * The blocks of all reads are stored in one set of Arrays (one per field) and the strings in a single arena, 
+ * so loading needs no allocations per entry. Parsing is done with mrfReader_nextBatch().
+ * @return The table, see MrfTable. The memory belongs to the user, use mrfTable_destroy()
  */
-void mrf_addNewColumnType (char* columnName)
+MrfTable mrfReader_load (MrfReader reader)
 {
+  MrfTable table;
+  MrfEntry *currEntry;
+  Array batch;
   int i;
 
-  i = 0;
-  while (i < arrayMax (columnHeaders)) {
-    if (strEqual (textItem (columnHeaders,i),columnName)) {
-      break;
-    } 
-    i++;
-  }
-  if (i == arrayMax (columnHeaders)) {
-    mrf_addColumnType (columnName);
+  AllocVar (table);
+  table->readOffsets = arrayCreate (100000,int);
+  table->blockOffsets = arrayCreate (100000,int);
+  table->targetIds = arrayCreate (100000,int);
+  table->strands = arrayCreate (100000,char);
+  table->targetStarts = arrayCreate (100000,int);
+  table->targetEnds = arrayCreate (100000,int);
+  table->queryStarts = arrayCreate (100000,int);
+  table->queryEnds = arrayCreate (100000,int);
+  table->sequences = arrayCreate (100000,int);
+  table->qualityScores = arrayCreate (100000,int);
+  table->queryIds = arrayCreate (100000,int);
+  table->strings = arrayCreate (1000000,char);
+  array (table->readOffsets,0,int) = 0;
+  array (table->blockOffsets,0,int) = 0;
+  while (batch = mrfReader_nextBatch (reader,MRF_DEFAULT_BATCH_SIZE)) {
+    for (i = 0; i < arrayMax (batch); i++) {
+      currEntry = arrp (batch,i,MrfEntry);
+      mrfTable_addRead (table,&currEntry->read1);
+      if (currEntry->isPairedEnd) {
+        mrfTable_addRead (table,&currEntry->read2);
+      }
+      table->numEntries++;
+      array (table->readOffsets,table->numEntries,int) = table->numReads;
+    }
   }
+  return table;
 }
 
 
 
 /**
- * Deinitialize the mrf module.
+ * Load all entries into a compact column-wise table.
+ * @pre The module has been initialized using mrf_init().
+ * @see mrfReader_load()
  */
-void mrf_deInit (void) 
+MrfTable mrf_load (void)
 {
-  ls_destroy (lsMrf);
-  arrayDestroy (columnTypes);
-  textDestroy (columnHeaders);
-  bitFree (&presentColumnTypes);
-  textDestroy (comments);
-  hlr_free (headerLine);
+  return mrfReader_load (defaultReader);
 }
 
 
 
-static void mrf_freeReadAttributes (MrfRead *currRead)
+static void mrfTable_getRead (MrfTable table, int readIndex, MrfRead *currRead)
 {
-  int i;
   MrfBlock *currBlock;
-  
-  for (i = 0; i < arrayMax (currRead->blocks); i++) {
-    currBlock = arrp (currRead->blocks,i,MrfBlock);
-    hlr_free (currBlock->targetName);
+  int offset;
+  int i;
+
+  if (currRead->blocks == NULL) {
+    currRead->blocks = arrayCreate (5,MrfBlock);
   }
-  arrayDestroy (currRead->blocks);
-  if (bitReadOne (presentColumnTypes,MRF_COLUMN_TYPE_SEQUENCE)) {
-    hlr_free (currRead->sequence);
+  arrayMax (currRead->blocks) = 0;
+  for (i = arru (table->blockOffsets,readIndex,int); i < arru (table->blockOffsets,readIndex + 1,int); i++) {
+    currBlock = arrayp (currRead->blocks,arrayMax (currRead->blocks),MrfBlock);
+    currBlock->targetId = arru (table->targetIds,i,int);
+    currBlock->targetName = symbolTable_getName (currBlock->targetId);
+    currBlock->strand = arru (table->strands,i,char);
+    currBlock->targetStart = arru (table->targetStarts,i,int);
+    currBlock->targetEnd = arru (table->targetEnds,i,int);
+    currBlock->queryStart = arru (table->queryStarts,i,int);
+    currBlock->queryEnd = arru (table->queryEnds,i,int);
   }
-  if (bitReadOne (presentColumnTypes,MRF_COLUMN_TYPE_QUALITY_SCORES)) {
-    hlr_free (currRead->qualityScores);
+  offset = arru (table->sequences,readIndex,int);
+  currRead->sequence = offset >= 0 ? arrp (table->strings,offset,char) : NULL;
+  offset = arru (table->qualityScores,readIndex,int);
+  currRead->qualityScores = offset >= 0 ? arrp (table->strings,offset,char) : NULL;
+  offset = arru (table->queryIds,readIndex,int);
+  currRead->queryId = offset >= 0 ? arrp (table->strings,offset,char) : NULL;
+}
+
+
+
+/**
+ * Fill an MrfEntry with an entry of a table, e.g. to pass it to mrf_writeEntry().
+ * @param[in] table A table, see mrfReader_load()
+ * @param[in] index Index of the entry, 0 .. table->numEntries - 1
+ * @param[in] currEntry Entry to be filled. Its block Arrays are created if NULL and reused otherwise. 
+   Its strings point into the table.
+ */
+void mrfTable_getEntry (MrfTable table, int index, MrfEntry *currEntry)
+{
+  int readIndex;
+
+  readIndex = arru (table->readOffsets,index,int);
+  currEntry->isPairedEnd = arru (table->readOffsets,index + 1,int) - readIndex == 2;
+  currEntry->line = NULL;
+  mrfTable_getRead (table,readIndex,&currEntry->read1);
+  if (currEntry->isPairedEnd) {
+    mrfTable_getRead (table,readIndex + 1,&currEntry->read2);
   }
-  if (bitReadOne (presentColumnTypes,MRF_COLUMN_TYPE_QUERY_ID)) {
-    hlr_free (currRead->queryId);
+  else if (currEntry->read2.blocks != NULL) {
+    arrayMax (currEntry->read2.blocks) = 0;
+    currEntry->read2.sequence = NULL;
+    currEntry->read2.qualityScores = NULL;
+    currEntry->read2.queryId = NULL;
   }
 }
 
 
 
-static void mrf_freeEntry (MrfEntry* currEntry) 
+/**
+ * Destroy a table returned by mrfReader_load().
+ */
+void mrfTable_destroy (MrfTable table)
 {
-  if (currEntry == NULL) {
+  if (table == NULL) {
     return;
   }
-  mrf_freeReadAttributes (&currEntry->read1);
-  if (currEntry->isPairedEnd == 1) {
-    mrf_freeReadAttributes (&currEntry->read2);
-  }
-  freeMem (currEntry);
+  arrayDestroy (table->readOffsets);
+  arrayDestroy (table->blockOffsets);
+  arrayDestroy (table->targetIds);
+  arrayDestroy (table->strands);
+  arrayDestroy (table->targetStarts);
+  arrayDestroy (table->targetEnds);
+  arrayDestroy (table->queryStarts);
+  arrayDestroy (table->queryEnds);
+  arrayDestroy (table->sequences);
+  arrayDestroy (table->qualityScores);
+  arrayDestroy (table->queryIds);
+  arrayDestroy (table->strings);
+  freeMem (table);
 }
 
 
 
-static void mrf_processBlocks (char *blockString, MrfRead *currRead)
+/**
+ * Compute and return the length of the read.
+ */
+int getReadLength (MrfRead *currRead)
 {
-  Texta blocks;
-  Texta blockFields;
-  int i;
   MrfBlock *currBlock;
+  int i;
+  int sum;
 
-  blocks = textFieldtok (blockString,",");
-  for (i = 0; i < arrayMax (blocks); i++) {
-    currBlock = arrayp (currRead->blocks,arrayMax (currRead->blocks),MrfBlock);
-    blockFields = textFieldtok (textItem (blocks,i),":");
-    currBlock->targetName = hlr_strdup (textItem (blockFields,0));
-    currBlock->strand = textItem (blockFields,1)[0];
-    currBlock->targetStart = atoi (textItem (blockFields,2));
-    currBlock->targetEnd = atoi (textItem (blockFields,3));
-    currBlock->queryStart = atoi (textItem (blockFields,4));
-    currBlock->queryEnd = atoi (textItem (blockFields,5));
-    textDestroy (blockFields);
+  sum = 0;
+  for (i = 0; i < arrayMax (currRead->blocks); i++) {
+    currBlock = arrp (currRead->blocks,i,MrfBlock);
+    sum += (currBlock->targetEnd - currBlock->targetStart + 1);
   }
-  textDestroy (blocks);
+  return sum;
 }
 
 
 
-static MrfEntry* mrf_processNextEntry (int freeMemory) 
+/**
+ * Create an MRF writer. The columns and comments are taken from a reader.
+ * @param[in] reader An MRF reader, see mrfReader_open()
+ * @return A writer object. Each writer has its own output buffer.
+ */
+MrfWriter mrfWriter_create (MrfReader reader)
 {
-  static MrfEntry *currEntry = NULL;
-  char *line,*token,*pos;
-  WordIter w;
-  int index,columnType;
+  MrfWriter writer;
+
+  AllocVar (writer);
+  writer->columnTypes = arrayCopy (reader->columnTypes);
+  writer->columnHeaders = textClone (reader->columnHeaders);
+  writer->comments = textClone (reader->comments);
+  writer->buffer = stringCreate (100);
+  writer->isPassThrough = 1;
+  return writer;
+}
 
-  while (line = ls_nextLine (lsMrf)) {
-    if (line[0] == '\0' || line[0] == '#' || strEqual (line,headerLine)) {
-      continue;
-    }
-    if (freeMemory) {
-      mrf_freeEntry (currEntry);
-    }
-    AllocVar (currEntry);
-    if (strchr (line,'|')) {
-      currEntry->isPairedEnd = 1;
-    }
-    else {
-      currEntry->isPairedEnd = 0;
-    }
-    index = 0;
-    w = wordIterCreate (line,"\t",0);
-    while (token = wordNext (w)) {
-      columnType = arru (columnTypes,index,int);
-      if (columnType == MRF_COLUMN_TYPE_BLOCKS) {
-        if (currEntry->isPairedEnd == 1) {
-          pos = strchr (token,'|');
-          *pos = '\0';
-          currEntry->read1.blocks = arrayCreate (2,MrfBlock);
-          currEntry->read2.blocks = arrayCreate (2,MrfBlock);
-          mrf_processBlocks (token,&currEntry->read1);
-          mrf_processBlocks (pos + 1,&currEntry->read2);
-         
-        }
-        else {
-          currEntry->read1.blocks = arrayCreate (2,MrfBlock);
-          mrf_processBlocks (token,&currEntry->read1);
-        }
-      }
-      else if (columnType == MRF_COLUMN_TYPE_SEQUENCE) {
-        if (currEntry->isPairedEnd == 1) {
-          pos = strchr (token,'|');
-          *pos = '\0';
-          currEntry->read1.sequence = hlr_strdup (token);
-          currEntry->read2.sequence = hlr_strdup (pos + 1);
-        }
-        else {
-          currEntry->read1.sequence = hlr_strdup (token);
-        }
-      }
-      else if (columnType == MRF_COLUMN_TYPE_QUALITY_SCORES) {
-        if (currEntry->isPairedEnd == 1) {
-          pos = strchr (token,'|');
-          *pos = '\0';
-          currEntry->read1.qualityScores = hlr_strdup (token);
-          currEntry->read2.qualityScores = hlr_strdup (pos + 1);
-        }
-        else {
-          currEntry->read1.qualityScores = hlr_strdup (token);
-        }
-      }
-      else if (columnType == MRF_COLUMN_TYPE_QUERY_ID) {
-        if (currEntry->isPairedEnd == 1) {
-          pos = strchr (token,'|');
-          *pos = '\0';
-          currEntry->read1.queryId = hlr_strdup (token);
-          currEntry->read2.queryId = hlr_strdup (pos + 1);
-        }
-        else {
-          currEntry->read1.queryId = hlr_strdup (token);
-        }
-      }
-      else {
-        die ("Unknown columnType: %d",columnType);
-      }
-      index++;
-    }
-    wordIterDestroy (w);
-    return currEntry;
+
+
+/**
+ * Send the output of mrfWriter_putHeader() and mrfWriter_putEntry() to a file instead of stdout.
+ * The file is compressed if its name ends in ".gz", see outStream_create().
+ * @param[in] writer An MRF writer, before the first line is put
+ * @param[in] fileName Name of the output file, "-" denotes stdout
+ */
+void mrfWriter_setOutput (MrfWriter writer, char *fileName)
+{
+  if (writer->output != NULL) {
+    die ("mrfWriter_setOutput: output has already started");
   }
-  if (freeMemory) {
-    mrf_freeEntry (currEntry);
+  writer->output = outStream_create (fileName);
+}
+
+
+
+/**
+ * Add a new column type to the output of a writer, unless it is already present. 
+ * @param[in] writer An MRF writer
+ * @param[in] columnName Name of the new column
+ */
+void mrfWriter_addNewColumnType (MrfWriter writer, char *columnName)
+{
+  int i;
+
+  for (i = 0; i < arrayMax (writer->columnHeaders); i++) {
+    if (strEqual (textItem (writer->columnHeaders,i),columnName)) {
+      return;
+    } 
   }
-  currEntry = NULL;
-  return currEntry;
+  mrf_addColumnType (writer->columnTypes,writer->columnHeaders,columnName);
+  writer->isPassThrough = 0;
 }
 
 
 
 /**
- * Returns a pointer to next MrfEntry. 
- * @pre The module has been initialized using mrf_init().
+ * Destroy an MRF writer. Pending output of mrfWriter_putEntry() is flushed and the output file is closed.
  */
-MrfEntry* mrf_nextEntry (void) 
+void mrfWriter_destroy (MrfWriter writer)
 {
-  return mrf_processNextEntry (1); 
+  if (writer == NULL) {
+    return;
+  }
+  mrfWriter_flush (writer);
+  arrayDestroy (writer->columnTypes);
+  textDestroy (writer->columnHeaders);
+  textDestroy (writer->comments);
+  stringDestroy (writer->buffer);
+  outStream_destroy (writer->output);
+  freeMem (writer);
 }
 
 
 
 /**
- * Returns an Array of MrfEntries.
- * @pre The module has been initialized using mrf_init().
- * @note The memory belongs to this routine.
+ * Write the mrf header preceeded by comments, if any. 
+ * @return The header; the memory belongs to the writer and stays stable until the next call with the same writer
  */
-Array mrf_parse (void) 
+char* mrfWriter_writeHeader (MrfWriter writer)
 {
-  Array mrfEntries;
-  MrfEntry *currEntry;
+  Stringa buffer;
+  int i;
 
-  mrfEntries = arrayCreate (100000,MrfEntry);
-  while (currEntry = mrf_processNextEntry (0)) {
-    array (mrfEntries,arrayMax (mrfEntries),MrfEntry) = *currEntry;
+  buffer = writer->buffer;
+  stringClear (buffer);
+  for (i = 0; i < arrayMax (writer->comments); i++) {
+    stringAppendf (buffer,"#%s\n",textItem (writer->comments,i));
   }
-  return mrfEntries;
+  for (i = 0; i < arrayMax (writer->columnHeaders); i++) {
+    stringAppendf (buffer,"%s%s",textItem (writer->columnHeaders,i), 
+		   i < arrayMax (writer->columnHeaders) - 1 ? "\t" : "");
+  }
+  return string (buffer);
+}
+
+
+
+/**
+ * Write the mrf header preceeded by comments, if any. 
+ * @pre The module has been initialized using mrf_init().
+ * @see mrfWriter_writeHeader()
+ */
+char* mrf_writeHeader (void)
+{
+  return mrfWriter_writeHeader (defaultWriter);
 }
 
 
@@ -343,42 +1398,40 @@ static void mrf_addTab (Stringa buffer, int *first)
   stringCatChar (buffer,'\t');
 }
 
+
+
 /**
- * Compute and return the length of the read.
+ * Append a decimal integer to a Stringa without going through the printf machinery.
  */
-int getReadLength (MrfRead *currRead)
+static void mrf_catInt (Stringa buffer, int value)
 {
-  MrfBlock *currBlock;
+  char digits[12];
+  unsigned int u;
+  int length;
   int i;
-  int sum;
 
-  sum = 0;
-  for (i = 0; i < arrayMax (currRead->blocks); i++) {
-    currBlock = arrp (currRead->blocks,i,MrfBlock);
-    sum += (currBlock->targetEnd - currBlock->targetStart + 1);
+  u = value < 0 ? -(unsigned int)value : (unsigned int)value;
+  length = 0;
+  do {
+    digits[sizeof (digits) - 1 - length++] = '0' + u % 10;
+    u /= 10;
+  } while (u > 0);
+  if (value < 0) {
+    digits[sizeof (digits) - 1 - length++] = '-';
   }
-  return sum;
+  i = arrayMax (buffer) - 1;
+  array (buffer,i + length,char) = '\0';
+  memcpy (arrp (buffer,i,char),digits + sizeof (digits) - length,length);
 }
 
 
+
 /**
- * Write the mrf header preceeded by comments, if any. 
- * @pre The module has been initialized using mrf_init().
+ * Append a string to a Stringa; NULL is written as "(null)" like printf() does.
  */
-char* mrf_writeHeader (void)
+static void mrf_catString (Stringa buffer, char *s)
 {
-  static Stringa buffer = NULL;
-  int i;
-
-  stringCreateClear (buffer,100);
-  for (i = 0; i < arrayMax (comments); i++) {
-    stringAppendf (buffer,"#%s\n",textItem (comments,i));
-  }
-  for (i = 0; i < arrayMax (columnHeaders); i++) {
-    stringAppendf (buffer,"%s%s",textItem (columnHeaders,i), 
-		   i < arrayMax (columnHeaders) - 1 ? "\t" : "");
-  }
-  return string (buffer);
+  stringCat (buffer,s != NULL ? s : "(null)");
 }
 
 
@@ -390,10 +1443,31 @@ static void mrf_writeBlocks (Stringa buffer, Array blocks)
 
   for (i = 0; i < arrayMax (blocks); i++) {
     currBlock = arrp (blocks,i,MrfBlock);
-    stringAppendf (buffer,"%s:%c:%d:%d:%d:%d%s",currBlock->targetName,
-                   currBlock->strand,currBlock->targetStart,currBlock->targetEnd,
-                   currBlock->queryStart,currBlock->queryEnd,
-                   i < arrayMax (blocks) - 1 ? "," : "");
+    if (i > 0) {
+      stringCatChar (buffer,',');
+    }
+    mrf_catString (buffer,currBlock->targetName);
+    stringCatChar (buffer,':');
+    stringCatChar (buffer,currBlock->strand);
+    stringCatChar (buffer,':');
+    mrf_catInt (buffer,currBlock->targetStart);
+    stringCatChar (buffer,':');
+    mrf_catInt (buffer,currBlock->targetEnd);
+    stringCatChar (buffer,':');
+    mrf_catInt (buffer,currBlock->queryStart);
+    stringCatChar (buffer,':');
+    mrf_catInt (buffer,currBlock->queryEnd);
+  }
+}
+
+
+
+static void mrf_writePair (Stringa buffer, char *value1, char *value2, int isPairedEnd)
+{
+  mrf_catString (buffer,value1);
+  if (isPairedEnd == 1) {
+    stringCatChar (buffer,'|');
+    mrf_catString (buffer,value2);
   }
 }
 
@@ -401,59 +1475,153 @@ static void mrf_writeBlocks (Stringa buffer, Array blocks)
 
 /**
  * Write an MrfEntry. 
- * @pre The module has been initialized using mrf_init().
+ * @return The line without a trailing newline; the memory belongs to the writer and stays stable until the next call with the same writer
  */
-char* mrf_writeEntry (MrfEntry *currEntry)
+char* mrfWriter_writeEntry (MrfWriter writer, MrfEntry *currEntry)
 {
-  static Stringa buffer = NULL;
+  Stringa buffer;
   int first;
   int i;
   int columnType;
 
-  stringCreateClear (buffer,100);
+  buffer = writer->buffer;
+  stringClear (buffer);
   first = 1;
-  for (i = 0; i < arrayMax (columnTypes); i++) {
-    columnType = arru (columnTypes,i,int);
-    if (bitReadOne (presentColumnTypes,MRF_COLUMN_TYPE_BLOCKS) && columnType == MRF_COLUMN_TYPE_BLOCKS) {
-      mrf_addTab (buffer,&first);
+  for (i = 0; i < arrayMax (writer->columnTypes); i++) {
+    columnType = arru (writer->columnTypes,i,int);
+    mrf_addTab (buffer,&first);
+    if (columnType == MRF_COLUMN_TYPE_BLOCKS) {
+      mrf_writeBlocks (buffer,currEntry->read1.blocks);
       if (currEntry->isPairedEnd == 1) {
-        mrf_writeBlocks (buffer,currEntry->read1.blocks);
         stringCatChar (buffer,'|');
         mrf_writeBlocks (buffer,currEntry->read2.blocks);
       }
-      else {
-        mrf_writeBlocks (buffer,currEntry->read1.blocks);
-      }
     }
-    if (bitReadOne (presentColumnTypes,MRF_COLUMN_TYPE_SEQUENCE) && columnType == MRF_COLUMN_TYPE_SEQUENCE) {
-      mrf_addTab (buffer,&first);
-      if (currEntry->isPairedEnd == 1) {
-        stringAppendf (buffer,"%s|%s",currEntry->read1.sequence,currEntry->read2.sequence);
-      }
-      else {
-        stringAppendf (buffer,"%s",currEntry->read1.sequence);
-      }
+    else if (columnType == MRF_COLUMN_TYPE_SEQUENCE) {
+      mrf_writePair (buffer,currEntry->read1.sequence,currEntry->read2.sequence,currEntry->isPairedEnd);
     }
-    if (bitReadOne (presentColumnTypes,MRF_COLUMN_TYPE_QUALITY_SCORES) && columnType == MRF_COLUMN_TYPE_QUALITY_SCORES) {
-      mrf_addTab (buffer,&first);
-      if (currEntry->isPairedEnd == 1) {
-        stringAppendf (buffer,"%s|%s",currEntry->read1.qualityScores,currEntry->read2.qualityScores);
-      }
-      else {
-        stringAppendf (buffer,"%s",currEntry->read1.qualityScores);
-      }
+    else if (columnType == MRF_COLUMN_TYPE_QUALITY_SCORES) {
+      mrf_writePair (buffer,currEntry->read1.qualityScores,currEntry->read2.qualityScores,currEntry->isPairedEnd);
     }
-    if (bitReadOne (presentColumnTypes,MRF_COLUMN_TYPE_QUERY_ID) && columnType == MRF_COLUMN_TYPE_QUERY_ID) {
-      mrf_addTab (buffer,&first);
-      if (currEntry->isPairedEnd == 1) {
-        stringAppendf (buffer,"%s|%s",currEntry->read1.queryId,currEntry->read2.queryId);
-      }
-      else {
-        stringAppendf (buffer,"%s",currEntry->read1.queryId);
-      }
+    else if (columnType == MRF_COLUMN_TYPE_QUERY_ID) {
+      mrf_writePair (buffer,currEntry->read1.queryId,currEntry->read2.queryId,currEntry->isPairedEnd);
     }
   }
   return string (buffer);
 }
 
-   
+
+
+/**
+ * Write an MrfEntry. 
+ * @pre The module has been initialized using mrf_init().
+ * @see mrfWriter_writeEntry()
+ */
+char* mrf_writeEntry (MrfEntry *currEntry)
+{
+  return mrfWriter_writeEntry (defaultWriter,currEntry);
+}
+
+
+
+static void mrfWriter_putLine (MrfWriter writer, char *line)
+{
+  if (writer->output == NULL) {
+    writer->output = outStream_create ("-");
+  }
+  outStream_puts (writer->output,line);
+}
+
+
+
+/**
+ * Write the pending output of mrfWriter_putHeader() and mrfWriter_putEntry() to the output file.
+ * Compressed output is handed to the compressor, see outStream_flush().
+ */
+void mrfWriter_flush (MrfWriter writer)
+{
+  if (writer->output != NULL) {
+    outStream_flush (writer->output);
+  }
+}
+
+
+
+/**
+ * Write the mrf header, preceeded by comments, to stdout.
+ * The output is buffered by the writer; do not mix with other writes to stdout before mrfWriter_flush().
+ * @see mrfWriter_writeHeader()
+ */
+void mrfWriter_putHeader (MrfWriter writer)
+{
+  mrfWriter_putLine (writer,mrfWriter_writeHeader (writer));
+}
+
+
+
+/**
+ * Write an MrfEntry followed by a newline to stdout.
+ * The output is buffered by the writer; do not mix with other writes to stdout before mrfWriter_flush().
+ * @param[in] writer An MRF writer, see mrfWriter_create()
+ * @param[in] currEntry The entry
+ */
+void mrfWriter_putEntry (MrfWriter writer, MrfEntry *currEntry)
+{
+  mrfWriter_putLine (writer,mrfWriter_writeEntry (writer,currEntry));
+}
+
+
+
+/**
+ * Write an MrfEntry that has not been modified since it was read followed by a newline to stdout.
+ * If the reader keeps lines (see mrfReader_keepLines()) and the writer has the columns of the reader, 
+ * the input line is written unchanged instead of being formatted.
+ * @param[in] writer An MRF writer, see mrfWriter_create()
+ * @param[in] currEntry The entry as returned by the reader
+ * @see mrfWriter_putEntry()
+ */
+void mrfWriter_putUnmodifiedEntry (MrfWriter writer, MrfEntry *currEntry)
+{
+  if (writer->isPassThrough && currEntry->line != NULL) {
+    mrfWriter_putLine (writer,currEntry->line);
+  }
+  else {
+    mrfWriter_putEntry (writer,currEntry);
+  }
+}
+
+
+
+/**
+ * Write the mrf header, preceeded by comments, to stdout. 
+ * @pre The module has been initialized using mrf_init().
+ * @see mrfWriter_putHeader()
+ */
+void mrf_putHeader (void)
+{
+  mrfWriter_putHeader (defaultWriter);
+}
+
+
+
+/**
+ * Write an MrfEntry followed by a newline to stdout. The output is flushed by mrf_deInit().
+ * @pre The module has been initialized using mrf_init().
+ * @see mrfWriter_putEntry()
+ */
+void mrf_putEntry (MrfEntry *currEntry)
+{
+  mrfWriter_putEntry (defaultWriter,currEntry);
+}
+
+
+
+/**
+ * Write an unmodified MrfEntry followed by a newline to stdout. The output is flushed by mrf_deInit().
+ * @pre The module has been initialized using mrf_init().
+ * @see mrfWriter_putUnmodifiedEntry()
+ */
+void mrf_putUnmodifiedEntry (MrfEntry *currEntry)
+{
+  mrfWriter_putUnmodifiedEntry (defaultWriter,currEntry);
+}
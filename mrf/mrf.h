@@ -3,6 +3,11 @@
 
 
 
+#include <sys/types.h>
+#include "common.h"
+
+
+
 /**
  *   \file mrf.h
  */
@@ -25,12 +30,29 @@
 #define MRF_COLUMN_NAME_QUERY_ID "QueryId"
 
 
+/**
+ * Column masks, see mrfReader_setColumns(). The alignment blocks are always read.
+ */
+#define MRF_COLUMN_MASK(columnType) (1 << (columnType))
+#define MRF_COLUMNS_BLOCKS MRF_COLUMN_MASK (MRF_COLUMN_TYPE_BLOCKS)
+#define MRF_COLUMNS_ALL (MRF_COLUMNS_BLOCKS | MRF_COLUMN_MASK (MRF_COLUMN_TYPE_SEQUENCE) | \
+                         MRF_COLUMN_MASK (MRF_COLUMN_TYPE_QUALITY_SCORES) | MRF_COLUMN_MASK (MRF_COLUMN_TYPE_QUERY_ID))
+
+
+
+/**
+ * Default number of entries per batch, see mrfReader_nextBatch().
+ */
+#define MRF_DEFAULT_BATCH_SIZE 1000
+
+
 
 /**
  * MrfBlock.
  */
 typedef struct {
-  char *targetName;
+  char *targetName;  // interned, owned by the symbolTable module
+  int targetId;      // see symbolTable_getName()
   char strand;
   int targetStart;
   int targetEnd;
@@ -59,18 +81,96 @@ typedef struct {
   int isPairedEnd;
   MrfRead read1;
   MrfRead read2;
+  char *line;        // input line if kept by the reader, NULL otherwise, see mrfReader_keepLines()
 } MrfEntry;
 
 
 
+/**
+ * MrfTable. All entries of an MRF stream in column-wise layout, see mrfReader_load().
+ * Entry i consists of the reads readOffsets[i] .. readOffsets[i+1]-1 (two if paired-end) 
+ * and read j of the blocks blockOffsets[j] .. blockOffsets[j+1]-1.
+ */
+typedef struct _mrfTableStruct_ {
+  int numEntries;
+  int numReads;
+  int numBlocks;
+  Array readOffsets;     // of type int, numEntries + 1 elements
+  Array blockOffsets;    // of type int, numReads + 1 elements
+  Array targetIds;       // of type int, one element per block
+  Array strands;         // of type char, one element per block
+  Array targetStarts;    // of type int, one element per block
+  Array targetEnds;      // of type int, one element per block
+  Array queryStarts;     // of type int, one element per block
+  Array queryEnds;       // of type int, one element per block
+  Array sequences;       // of type int, one element per read: offset into strings, -1 if not present
+  Array qualityScores;   // of type int, one element per read: offset into strings, -1 if not present
+  Array queryIds;        // of type int, one element per read: offset into strings, -1 if not present
+  Array strings;         // of type char, null-terminated strings of all reads
+} *MrfTable;
+
+
+
+/**
+ * MrfReader. Reads an MRF stream; the members are private to mrf.c.
+ */
+typedef struct _mrfReaderStruct_ *MrfReader;
+
+
+
+/**
+ * MrfWriter. Formats MrfEntries according to a column layout; the members are private to mrf.c.
+ */
+typedef struct _mrfWriterStruct_ *MrfWriter;
+
+
+
+extern MrfReader mrfReader_open (char *fileName);
+extern MrfReader mrfReader_openFromPipe (char *cmd);
+extern MrfEntry* mrfReader_next (MrfReader reader);
+extern Array mrfReader_nextBatch (MrfReader reader, int maxEntries);
+extern void mrfReader_setNumThreads (MrfReader reader, int numThreads);
+extern void mrfReader_setColumns (MrfReader reader, int columnMask);
+extern void mrfReader_keepLines (MrfReader reader);
+extern void mrfReader_setArena (MrfReader reader, Arena arena);
+extern Array mrfReader_parse (MrfReader reader);
+extern MrfTable mrfReader_load (MrfReader reader);
+extern off_t mrfReader_tell (MrfReader reader);
+extern void mrfReader_seek (MrfReader reader, off_t offset);
+extern Array mrfReader_getColumnTypes (MrfReader reader);
+extern Texta mrfReader_getComments (MrfReader reader);
+extern void mrfReader_close (MrfReader reader);
+
+extern MrfWriter mrfWriter_create (MrfReader reader);
+extern void mrfWriter_addNewColumnType (MrfWriter writer, char *columnName);
+extern char* mrfWriter_writeHeader (MrfWriter writer);
+extern char* mrfWriter_writeEntry (MrfWriter writer, MrfEntry *currEntry);
+extern void mrfWriter_putHeader (MrfWriter writer);
+extern void mrfWriter_putEntry (MrfWriter writer, MrfEntry *currEntry);
+extern void mrfWriter_putUnmodifiedEntry (MrfWriter writer, MrfEntry *currEntry);
+extern void mrfWriter_setOutput (MrfWriter writer, char *fileName);
+extern void mrfWriter_flush (MrfWriter writer);
+extern void mrfWriter_destroy (MrfWriter writer);
+
 extern void mrf_init (char* fileName);
 extern void mrf_initFromPipe (char* cmd);
+extern void mrf_initWithColumns (char* fileName, int columnMask);
+extern void mrf_keepLines (void);
 extern void mrf_addNewColumnType (char* columnName);
 extern void mrf_deInit (void);
 extern MrfEntry* mrf_nextEntry (void);
+extern Array mrf_nextBatch (int maxEntries);
+extern void mrf_copyEntry (MrfEntry *to, MrfEntry *from);
+extern void mrf_copyEntryToArena (MrfEntry *to, MrfEntry *from, Arena arena);
 extern Array mrf_parse (void);
+extern MrfTable mrf_load (void);
+extern void mrfTable_getEntry (MrfTable table, int index, MrfEntry *currEntry);
+extern void mrfTable_destroy (MrfTable table);
 extern char* mrf_writeHeader (void);
 extern char* mrf_writeEntry (MrfEntry *currEntry);
+extern void mrf_putHeader (void);
+extern void mrf_putEntry (MrfEntry *currEntry);
+extern void mrf_putUnmodifiedEntry (MrfEntry *currEntry);
 extern int getReadLength (MrfRead *currRead);
 
 
@@ -1,5 +1,6 @@
 #include "log.h"
 #include "format.h"
+#include "symbolTable.h"
 #include "mrf.h"
 #include "format.h"
 
@@ -15,16 +16,17 @@
 
 
 typedef struct {
-  char *targetName;
+  int targetId;
   int start;
   int end;
 } Region;
 
 
 
-static int sortRegionsByTargetName (Region *a, Region *b)
+static uint64_t getRegionKey (Region *a)
 {
-  return strcmp (a->targetName,b->targetName);
+  // by target, then by start so that the coverage array is filled sequentially
+  return ((uint64_t)a->targetId << 32) | (uint32_t)a->start;
 }
 
 
@@ -50,7 +52,7 @@ static void processRead (Array regions, MrfRead *currRead)
   for(i = 0; i < arrayMax (currRead->blocks); i++) {
     currBlock = arrp (currRead->blocks,i,MrfBlock);
     currRegion = arrayp (regions,arrayMax (regions),Region);
-    currRegion->targetName = hlr_strdup (currBlock->targetName);
+    currRegion->targetId = currBlock->targetId;
     currRegion->start = currBlock->targetStart;
     currRegion->end = currBlock->targetEnd;
   }
@@ -69,11 +71,13 @@ int main (int argc, char *argv[])
 {
   Stringa buffer;
   int i,j,k;
+  Array batch;
   MrfEntry *currEntry;
   Array positions;
   FILE *fp;
   Array regions;
   Region *currRegion,*nextRegion;
+  char *targetName;
   long int totalNumNucleotides;
   int doNotNormalize;
 
@@ -86,20 +90,23 @@ int main (int argc, char *argv[])
     doNotNormalize = 1;
   }
   buffer = stringCreate (100);
-  mrf_init ("-");
+  mrf_initWithColumns ("-",MRF_COLUMNS_BLOCKS);
   regions = arrayCreate (10000000,Region);  
   totalNumNucleotides = 0;
-  while (currEntry = mrf_nextEntry ()) {
-    processRead (regions, &currEntry->read1);
-    totalNumNucleotides += getReadLength (&currEntry->read1); 
-    if (currEntry->isPairedEnd) {
-      processRead (regions,&currEntry->read2);
-      totalNumNucleotides += getReadLength (&currEntry->read2); 
+  while (batch = mrf_nextBatch (MRF_DEFAULT_BATCH_SIZE)) {
+    for (i = 0; i < arrayMax (batch); i++) {
+      currEntry = arrp (batch,i,MrfEntry);
+      processRead (regions, &currEntry->read1);
+      totalNumNucleotides += getReadLength (&currEntry->read1); 
+      if (currEntry->isPairedEnd) {
+        processRead (regions,&currEntry->read2);
+        totalNumNucleotides += getReadLength (&currEntry->read2); 
+      }
     }
   }
   mrf_deInit ();
   
-  arraySort (regions,(ARRAYORDERF)sortRegionsByTargetName);
+  arraySortByKey64 (regions,(ARRAYKEYF)getRegionKey);
   positions = arrayCreate (10000000,int);
   i = 0; 
   while (i < arrayMax (regions)) {
@@ -109,19 +116,20 @@ int main (int argc, char *argv[])
     j = i + 1;
     while (j < arrayMax (regions)) {
       nextRegion = arrp (regions,j,Region);
-      if (!strEqual (currRegion->targetName,nextRegion->targetName)) {
+      if (currRegion->targetId != nextRegion->targetId) {
         break;
       } 
       updateCounts (positions,nextRegion->start,nextRegion->end);
       j++;
     }
     i = j;
-    stringPrintf (buffer,"%s_%s.bgr",argv[1],currRegion->targetName);
+    targetName = symbolTable_getName (currRegion->targetId);
+    stringPrintf (buffer,"%s_%s.bgr",argv[1],targetName);
     fp = fopen (string (buffer),"w");
     if (fp == NULL) {
       die ("Unable to open file: %s",string (buffer));
     }
-    write_bedGraphHeader(fp, argv[1], currRegion->targetName,NULL);
+    write_bedGraphHeader(fp, argv[1], targetName,NULL);
     for (k = 0; k < arrayMax (positions); k++) {
       if (arru (positions,k,int) > 0) {
 	int offset=1;
@@ -130,10 +138,10 @@ int main (int argc, char *argv[])
 	  if( (k+offset) == arrayMax( positions ) ) { break; } // last element
 	}	       
 	if (doNotNormalize == 0) {
-          fprintf (fp,"%s\t%d\t%d\t%f\n",currRegion->targetName, k-1, (k-1)+offset, (double)arru (positions,k,int) / ((double) totalNumNucleotides / 1000000.0));
+          fprintf (fp,"%s\t%d\t%d\t%f\n",targetName, k-1, (k-1)+offset, (double)arru (positions,k,int) / ((double) totalNumNucleotides / 1000000.0));
         }
         else {
-          fprintf (fp,"%s\t%d\t%d\t%d\n",currRegion->targetName, k-1, (k-1)+offset, arru (positions,k,int));
+          fprintf (fp,"%s\t%d\t%d\t%d\n",targetName, k-1, (k-1)+offset, arru (positions,k,int));
         }
 	k=(k-1)+offset;
       }
@@ -0,0 +1,34 @@
+#include "log.h"
+#include "format.h"
+#include "mrf.h"
+#include "bmrf.h"
+#include <stdio.h>
+
+
+
+/** 
+ *   \file mrf2bmrf.c Module to convert MRF into binary MRF (BMRF).
+ *         Usage: mrf2bmrf < <file.mrf> > <file.bmrf> \n
+ *         The input may also be BMRF. BMRF files are accepted by all tools reading MRF via mrf_init().
+ */
+
+
+
+int main (int argc, char *argv[])
+{
+  MrfReader reader;
+  BmrfWriter writer;
+  MrfEntry *currEntry;
+
+  if (argc != 1) {
+    usage ("%s < <file.mrf> > <file.bmrf>",argv[0]);
+  }
+  reader = mrfReader_open ("-");
+  writer = bmrfWriter_create (stdout,mrfReader_getColumnTypes (reader),mrfReader_getComments (reader));
+  while (currEntry = mrfReader_next (reader)) {
+    bmrfWriter_writeEntry (writer,currEntry);
+  }
+  bmrfWriter_close (writer);
+  mrfReader_close (reader);
+  return 0;
+}
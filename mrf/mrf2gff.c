@@ -1,5 +1,6 @@
 #include "format.h"
 #include "log.h"
+#include "symbolTable.h"
 #include "mrf.h"
 
 
@@ -15,21 +16,15 @@
 
 typedef struct {
   int groupNumber;
-  char *targetName;
+  int targetId;
   char *line;
 } GffEntry;
 
 
 
-static int sortGffEntriesByTargetNameAndGroupNumber (GffEntry *a, GffEntry *b) 
+static uint64_t getGffEntryKey (GffEntry *a) 
 {
-  int diff;
-
-  diff = strcmp (a->targetName,b->targetName);
-  if (diff != 0) {
-    return diff;
-  }
-  return a->groupNumber - b->groupNumber;
+  return ((uint64_t)a->targetId << 32) | (uint32_t)a->groupNumber;
 }
 
 
@@ -54,7 +49,7 @@ static void processRead (Array gffEntries, MrfRead *currRead, int *groupNumber)
                   currBlock->targetEnd,
                   currBlock->strand,
                   *groupNumber);
-    currGffEntry->targetName = hlr_strdup (currBlock->targetName);
+    currGffEntry->targetId = currBlock->targetId;
     currGffEntry->line = hlr_strdup (string (buffer));
   }
   (*groupNumber)++;
@@ -67,6 +62,7 @@ int main (int argc, char *argv[])
   int i,j,groupNumber;
   MrfEntry *currEntry;
   GffEntry *currGffEntry,*nextGffEntry;
+  char *targetName;
   Array gffEntries;
   FILE *fp;
   Stringa buffer;
@@ -87,22 +83,23 @@ int main (int argc, char *argv[])
   }
   mrf_deInit ();
 
-  arraySort (gffEntries,(ARRAYORDERF)sortGffEntriesByTargetNameAndGroupNumber);
+  arraySortByKey64 (gffEntries,(ARRAYKEYF)getGffEntryKey);
   i = 0; 
   while (i < arrayMax (gffEntries)) {
     currGffEntry = arrp (gffEntries,i,GffEntry);
-    stringPrintf (buffer,"%s_%s.gff",argv[1],currGffEntry->targetName);
+    targetName = symbolTable_getName (currGffEntry->targetId);
+    stringPrintf (buffer,"%s_%s.gff",argv[1],targetName);
     fp = fopen (string (buffer),"w");
     if (fp == NULL) {
       die ("Unable to open file: %s",string (buffer));
     }
     fprintf (fp,"browser hide all\n");
-    fprintf (fp,"track name=\"%s_%s\" visibility=2\n",argv[1],currGffEntry->targetName);
+    fprintf (fp,"track name=\"%s_%s\" visibility=2\n",argv[1],targetName);
     fprintf (fp,"%s\n",currGffEntry->line);
     j = i + 1;
     while (j < arrayMax (gffEntries)) {
       nextGffEntry = arrp (gffEntries,j,GffEntry);
-      if (!strEqual (currGffEntry->targetName,nextGffEntry->targetName)) {
+      if (currGffEntry->targetId != nextGffEntry->targetId) {
         break;
       } 
       fprintf (fp,"%s\n",nextGffEntry->line);
@@ -1,5 +1,6 @@
 #include "log.h"
 #include "format.h"
+#include "symbolTable.h"
 #include "mrf.h"
 
 
@@ -15,16 +16,17 @@
 
 
 typedef struct {
-  char *targetName;
+  int targetId;
   int start;
   int end;
 } Region;
 
 
 
-static int sortRegionsByTargetName (Region *a, Region *b)
+static uint64_t getRegionKey (Region *a)
 {
-  return strcmp (a->targetName,b->targetName);
+  // by target, then by start so that the coverage array is filled sequentially
+  return ((uint64_t)a->targetId << 32) | (uint32_t)a->start;
 }
 
 
@@ -49,7 +51,7 @@ static void processRead (Array regions, MrfRead *currRead)
   for(i = 0; i < arrayMax (currRead->blocks); i++) {
     currBlock = arrp (currRead->blocks,i,MrfBlock);
     currRegion = arrayp (regions,arrayMax (regions),Region);
-    currRegion->targetName = hlr_strdup (currBlock->targetName);
+    currRegion->targetId = currBlock->targetId;
     currRegion->start = currBlock->targetStart;
     currRegion->end = currBlock->targetEnd;
   }
@@ -66,6 +68,7 @@ int main (int argc, char *argv[])
   FILE *fp;
   Array regions;
   Region *currRegion,*nextRegion;
+  char *targetName;
   int numberOfReads;
   int useCounts;
   
@@ -78,7 +81,7 @@ int main (int argc, char *argv[])
   }
   buffer = stringCreate (100);
   numberOfReads = 0;
-  mrf_init ("-");
+  mrf_initWithColumns ("-",MRF_COLUMNS_BLOCKS);
   regions = arrayCreate (10000000,Region);
   while (currEntry = mrf_nextEntry ()) {
     processRead (regions,&currEntry->read1);
@@ -90,7 +93,7 @@ int main (int argc, char *argv[])
   }
   mrf_deInit ();
   
-  arraySort (regions,(ARRAYORDERF)sortRegionsByTargetName);
+  arraySortByKey64 (regions,(ARRAYKEYF)getRegionKey);
   positions = arrayCreate (10000000,int);
   i = 0; 
   while (i < arrayMax (regions)) {
@@ -100,20 +103,21 @@ int main (int argc, char *argv[])
     j = i + 1;
     while (j < arrayMax (regions)) {
       nextRegion = arrp (regions,j,Region);
-      if (!strEqual (currRegion->targetName,nextRegion->targetName)) {
+      if (currRegion->targetId != nextRegion->targetId) {
         break;
       } 
       updateCounts (positions,nextRegion->start,nextRegion->end);
       j++;
     }
     i = j;
-    stringPrintf (buffer,"%s_%s.wig",argv[1],currRegion->targetName);
+    targetName = symbolTable_getName (currRegion->targetId);
+    stringPrintf (buffer,"%s_%s.wig",argv[1],targetName);
     fp = fopen (string (buffer),"w");
     if (fp == NULL) {
       die ("Unable to open file: %s",string (buffer));
     }
-    fprintf (fp,"track type=wiggle_0 name=\"%s_%s\"\n",argv[1],currRegion->targetName);
-    fprintf (fp,"variableStep chrom=%s span=1\n",currRegion->targetName);
+    fprintf (fp,"track type=wiggle_0 name=\"%s_%s\"\n",argv[1],targetName);
+    fprintf (fp,"variableStep chrom=%s span=1\n",targetName);
     for (k = 0; k < arrayMax (positions); k++) {
       if (arru (positions,k,int) > 0) {
         if (useCounts == 1) {
@@ -5,6 +5,7 @@
 #include "intervalFind.h"
 #include "numUtil.h"
 #include "mrf.h"
+#include "mrfIntervalCursor.h"
 
 
 
@@ -76,40 +77,32 @@ static double calculateCoverage (Array matches, double coverageFactor)
 
 
 
-static void intersectWithAnnotation (Array matches, char *chromosome, int start, int end) 
+static void intersectWithAnnotation (Array matches, IntervalCursor cursor, int chromosomeId, int start, int end) 
 {
-  Array annotatedTranscripts;
-  Interval *currTranscript;
-  SubInterval *currExon;
-  int overlap;
+  Array annotatedExons;
+  SubIntervalMatch *currExonMatch;
   Match *currMatch;
-  int i,j;
-
-  annotatedTranscripts = intervalFind_getOverlappingIntervals (chromosome,start,end);
-  for (i = 0; i < arrayMax (annotatedTranscripts); i++) {
-    currTranscript = arru (annotatedTranscripts,i,Interval*);
-    for (j = 0; j < arrayMax (currTranscript->subIntervals); j++) {
-      currExon = arrp (currTranscript->subIntervals,j,SubInterval);
-      overlap = rangeIntersection (start,end,currExon->start,currExon->end);
-      if (overlap > 0) {
-        currMatch = arrayp (matches,arrayMax (matches),Match);
-        currMatch->intervalPtr = currTranscript;
-        currMatch->overlap = overlap;
-      }
-    } 
+  int i;
+
+  annotatedExons = intervalCursor_getSubIntervalMatchesById (cursor,chromosomeId,start,end);
+  for (i = 0; i < arrayMax (annotatedExons); i++) {
+    currExonMatch = arrp (annotatedExons,i,SubIntervalMatch);
+    currMatch = arrayp (matches,arrayMax (matches),Match);
+    currMatch->intervalPtr = currExonMatch->interval;
+    currMatch->overlap = currExonMatch->overlap;
   }
 }
 
 
 
-static void processRead (Array matches, MrfRead *currRead) 
+static void processRead (Array matches, IntervalCursor cursor, MrfRead *currRead) 
 {
   MrfBlock *currBlock;
   int i;
   
   for (i = 0; i < arrayMax (currRead->blocks); i++) {
     currBlock = arrp (currRead->blocks,i,MrfBlock);
-    intersectWithAnnotation (matches,currBlock->targetName,
+    intersectWithAnnotation (matches,cursor,currBlock->targetId,
                              currBlock->targetStart,currBlock->targetEnd);
   }
 }
@@ -125,6 +118,7 @@ int main (int argc, char *argv[])
   double fractionDetected;
   int readsSampled;
   double coverageFactor;
+  MrfIntervalCursor cursor;
 
   if (argc != 5) {
     usage ("%s <file.annotation> <numTotalReads> <numReadsToSample> <coverageFactor>",argv[0]);
@@ -137,15 +131,16 @@ int main (int argc, char *argv[])
   fractionToSample = 1.0 * numReadsToSample / numTotalReads;
   readsSampled = 0;
   matches = arrayCreate (300000,Match);
+  cursor = mrfIntervalCursor_createForSubIntervals (intervalFind_getSearchSpace ());
   mrf_init ("-"); 
   while (currEntry = mrf_nextEntry ()) {
     if ((1.0 * rand () / RAND_MAX) > fractionToSample) {
       continue;
     }  
     readsSampled++;
-    processRead (matches,&currEntry->read1);
+    processRead (matches,mrfIntervalCursor_getCursor (cursor,currEntry,&currEntry->read1),&currEntry->read1);
     if (currEntry->isPairedEnd) {
-      processRead (matches,&currEntry->read2);
+      processRead (matches,mrfIntervalCursor_getCursor (cursor,currEntry,&currEntry->read2),&currEntry->read2);
     }
   }
   mrf_deInit ();
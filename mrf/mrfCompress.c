@@ -0,0 +1,31 @@
+#include "log.h"
+#include "format.h"
+#include "bgzf.h"
+#include <stdio.h>
+
+
+
+/** 
+ *   \file mrfCompress.c Module to compress MRF into block-compressed gzip (BGZF).
+ *         Usage: mrfCompress < <file.mrf> > <file.mrf.gz> \n
+ *         The output can be read by zcat and by all MRF tools, and it can be indexed with mrfIndex.
+ */
+
+
+
+int main (int argc, char *argv[])
+{
+  Bgzf bgzf;
+  char buffer[BGZF_MAX_BLOCK_INPUT];
+  int count;
+
+  if (argc != 1) {
+    usage ("%s < <file.mrf> > <file.mrf.gz>",argv[0]);
+  }
+  bgzf = bgzf_createWriter (stdout,-1);
+  while ((count = fread (buffer,1,sizeof (buffer),stdin)) > 0) {
+    bgzf_write (bgzf,buffer,count);
+  }
+  bgzf_destroy (bgzf);
+  return 0;
+}
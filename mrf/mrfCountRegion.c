@@ -1,26 +1,29 @@
 #include "log.h"
 #include "format.h"
 #include "numUtil.h"
+#include "symbolTable.h"
 #include "mrf.h"
+#include "mrfRegionIndex.h"
 
 
 
 /** 
  *   \file mrfCountRegion.c Module to count the total number of reads that overlap with a specified region.
- *         Usage:  mrfCountRegion targetName:targetStart:targetEnd \n
- *         Takes MRF from STDIN. \n
+ *         Usage:  mrfCountRegion targetName:targetStart:targetEnd [<file.mrf> [<file.mrf.mri>]] \n
+ *         Takes MRF from STDIN. If an MRF file is given, its region index (see mrfIndex.c) is used 
+ *         to read only the entries near the region. \n
  */
 
 
 
-static int isContained (MrfRead *currRead, char *targetName, int targetStart, int targetEnd)
+static int isContained (MrfRead *currRead, int targetId, int targetStart, int targetEnd)
 {
   MrfBlock* currBlock;
   int i;
 
   for (i = 0; i < arrayMax (currRead->blocks); i++) {
     currBlock = arrp (currRead->blocks,i,MrfBlock);
-    if (strEqual (currBlock->targetName,targetName)) {
+    if (currBlock->targetId == targetId) {
       if (rangeIntersection (currBlock->targetStart,currBlock->targetEnd,targetStart,targetEnd) > 0 ) {
         return 1;
       }     
@@ -31,14 +34,14 @@ static int isContained (MrfRead *currRead, char *targetName, int targetStart, in
 
 
 
-static int processEntry (MrfEntry *currEntry, char *targetName, int targetStart, int targetEnd) 
+static int processEntry (MrfEntry *currEntry, int targetId, int targetStart, int targetEnd) 
 {
   int containment;
 
   containment = 0;
-  containment += isContained (&currEntry->read1,targetName,targetStart,targetEnd);
+  containment += isContained (&currEntry->read1,targetId,targetStart,targetEnd);
   if (currEntry->isPairedEnd) {
-    containment += isContained (&currEntry->read2,targetName,targetStart,targetEnd);
+    containment += isContained (&currEntry->read2,targetId,targetStart,targetEnd);
   }
   return containment;
 }
@@ -47,15 +50,18 @@ static int processEntry (MrfEntry *currEntry, char *targetName, int targetStart,
 
 int main (int argc, char *argv[])
 {
+  MrfReader reader;
+  MrfRegionIndex index;
+  MrfRegionQuery query;
   MrfEntry *currEntry;
   char *targetName;
-  int targetStart,targetEnd;
+  int targetId,targetStart,targetEnd;
   WordIter w;
   int count=0;
   int currCount=0; 
 
-  if (argc != 2) {
-    usage ("%s <targetName:targetStart-targetEnd>",argv[0]);
+  if (argc < 2 || argc > 4) {
+    usage ("%s <targetName:targetStart-targetEnd> [<file.mrf> [<file.mrf%s>]]",argv[0],MRF_REGION_INDEX_SUFFIX);
   }
 
   w = wordIterCreate (argv[1],":- ",0);
@@ -63,14 +69,28 @@ int main (int argc, char *argv[])
   targetStart = atoi (wordNext (w));
   targetEnd = atoi (wordNext (w));
   wordIterDestroy (w);
-
-  mrf_init ("-");
-  while (currEntry = mrf_nextEntry ()) {
-    currCount = processEntry (currEntry,targetName,targetStart,targetEnd);
-    count = currCount+count;
+  targetId = symbolTable_intern (targetName);
+
+  reader = mrfReader_open (argc > 2 ? argv[2] : "-");
+  mrfReader_setColumns (reader,MRF_COLUMNS_BLOCKS);
+  if (argc == 2) {
+    while (currEntry = mrfReader_next (reader)) {
+      currCount = processEntry (currEntry,targetId,targetStart,targetEnd);
+      count = currCount+count;
+    }
+  }
+  else {
+    index = mrfRegionIndex_read (argc == 4 ? argv[3] : mrfRegionIndex_getDefaultFileName (argv[2]));
+    query = mrfRegionIndex_startQuery (index,reader,targetName,targetStart,targetEnd);
+    while (currEntry = mrfRegionIndex_nextEntry (query)) {
+      currCount = processEntry (currEntry,targetId,targetStart,targetEnd);
+      count = currCount+count;
+    }
+    mrfRegionIndex_endQuery (query);
+    mrfRegionIndex_destroy (index);
   }
   printf("Count for %s:%d-%d = %d\n", targetName, targetStart, targetEnd, count);
-  mrf_deInit ();
+  mrfReader_close (reader);
   hlr_free (targetName);
   return 0;
 }
@@ -0,0 +1,28 @@
+#include "log.h"
+#include "format.h"
+#include "mrf.h"
+#include "mrfRegionIndex.h"
+
+
+
+/** 
+ *   \file mrfIndex.c Module to build a region index of a coordinate-sorted MRF file.
+ *         Usage: mrfIndex <file.mrf> [<file.mrf.mri>] \n
+ *         The MRF entries must be sorted by the target name and start of the first block of read1. \n
+ *         The index is used by mrfSelectRegion and mrfCountRegion to read only the entries near a region.
+ */
+
+
+
+int main (int argc, char *argv[])
+{
+  MrfRegionIndex index;
+
+  if (argc != 2 && argc != 3) {
+    usage ("%s <file.mrf> [<file.mrf%s>]",argv[0],MRF_REGION_INDEX_SUFFIX);
+  }
+  index = mrfRegionIndex_build (argv[1]);
+  mrfRegionIndex_write (index,argc == 3 ? argv[2] : mrfRegionIndex_getDefaultFileName (argv[1]));
+  mrfRegionIndex_destroy (index);
+  return 0;
+}
@@ -0,0 +1,88 @@
+#include "log.h"
+#include "format.h"
+#include "common.h"
+#include "intervalFind.h"
+#include "mrf.h"
+#include "mrfIntervalCursor.h"
+
+
+
+/**
+ *   \file mrfIntervalCursor.c Module to intersect the alignment blocks of MRF entries with an IntervalIndex.
+ *   A sorted MRF file is sorted by the blocks of read1, and the blocks of read2 lag behind them 
+ *   by about the insert size. Each read therefore gets a cursor of its own, see IntervalCursor.
+ */
+
+
+
+struct _mrfIntervalCursorStruct_ {
+  IntervalCursor read1Cursor;
+  IntervalCursor read2Cursor;
+};
+
+
+
+static MrfIntervalCursor mrfIntervalCursor_createWithCursors (IntervalCursor read1Cursor, IntervalCursor read2Cursor)
+{
+  MrfIntervalCursor cursor;
+
+  AllocVar (cursor);
+  cursor->read1Cursor = read1Cursor;
+  cursor->read2Cursor = read2Cursor;
+  return cursor;
+}
+
+
+
+/**
+ * Create a pair of cursors to query the intervals of an index with the blocks of read1 and read2, see intervalCursor_create().
+ * @param[in] index An IntervalIndex; it must not be changed while the cursor is used
+ * @return An MrfIntervalCursor. Each thread needs its own.
+ */
+MrfIntervalCursor mrfIntervalCursor_create (IntervalIndex index)
+{
+  return mrfIntervalCursor_createWithCursors (intervalCursor_create (index),intervalCursor_create (index));
+}
+
+
+
+/**
+ * Create a pair of cursors to query the subintervals of an index with the blocks of read1 and read2, 
+   see intervalCursor_createForSubIntervals(). The subintervals are indexed if needed.
+ * @param[in] index An IntervalIndex; it must not be changed while the cursor is used
+ * @return An MrfIntervalCursor. Each thread needs its own.
+ */
+MrfIntervalCursor mrfIntervalCursor_createForSubIntervals (IntervalIndex index)
+{
+  intervalIndex_indexSubIntervals (index);
+  return mrfIntervalCursor_createWithCursors (intervalCursor_createForSubIntervals (index),intervalCursor_createForSubIntervals (index));
+}
+
+
+
+/**
+ * Get the cursor for the blocks of a read.
+ * @param[in] cursor An MrfIntervalCursor
+ * @param[in] currEntry An MRF entry
+ * @param[in] currRead Either &currEntry->read1 or &currEntry->read2
+ * @return The IntervalCursor to query with the blocks of currRead
+ */
+IntervalCursor mrfIntervalCursor_getCursor (MrfIntervalCursor cursor, MrfEntry *currEntry, MrfRead *currRead)
+{
+  return currRead == &currEntry->read2 ? cursor->read2Cursor : cursor->read1Cursor;
+}
+
+
+
+/**
+ * Destroy an MrfIntervalCursor. The index is not affected.
+ */
+void mrfIntervalCursor_destroy (MrfIntervalCursor cursor)
+{
+  if (cursor == NULL) {
+    return;
+  }
+  intervalCursor_destroy (cursor->read1Cursor);
+  intervalCursor_destroy (cursor->read2Cursor);
+  freeMem (cursor);
+}
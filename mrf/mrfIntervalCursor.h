@@ -0,0 +1,26 @@
+#ifndef DEF_MRF_INTERVAL_CURSOR_H
+#define DEF_MRF_INTERVAL_CURSOR_H
+
+
+
+/**
+ *   \file mrfIntervalCursor.h
+ */
+
+
+
+/**
+ * MrfIntervalCursor.
+ */
+typedef struct _mrfIntervalCursorStruct_ *MrfIntervalCursor;
+
+
+
+extern MrfIntervalCursor mrfIntervalCursor_create (IntervalIndex index);
+extern MrfIntervalCursor mrfIntervalCursor_createForSubIntervals (IntervalIndex index);
+extern IntervalCursor mrfIntervalCursor_getCursor (MrfIntervalCursor cursor, MrfEntry *currEntry, MrfRead *currRead);
+extern void mrfIntervalCursor_destroy (MrfIntervalCursor cursor);
+
+
+
+#endif
@@ -2,6 +2,7 @@
 #include "log.h"
 #include "mrf.h"
 #include "intervalFind.h"
+#include "mrfIntervalCursor.h"
 
 
 
@@ -38,7 +39,9 @@ int main (int argc, char *argv[])
   MrfBlock *currBlock;
   Array blocks;
   Array intervals;
-  Interval *currInterval;
+  MrfIntervalCursor cursor;
+  int numRead1Blocks;
+  Interval *currInterval,*matchingInterval;
   SubInterval *currSubInterval;
   int h,i,j,k;
   int count;
@@ -57,20 +60,25 @@ int main (int argc, char *argv[])
     normalizedCounts[k] = 0;
   } 
   blocks = arrayCreate (10,MrfBlock*);
-  mrf_init ("-");
+  cursor = mrfIntervalCursor_create (intervalFind_getSearchSpace ());
+  intervals = arrayCreate (20,Interval*);
+  mrf_initWithColumns ("-",MRF_COLUMNS_BLOCKS);
   while (currEntry = mrf_nextEntry ()) {
     arrayClear (blocks);
     collectAlignmentBlocks (blocks,&currEntry->read1);
+    numRead1Blocks = arrayMax (blocks);
     if (currEntry->isPairedEnd) {
       collectAlignmentBlocks (blocks,&currEntry->read2);
     }
     for (h = 0; h < arrayMax (blocks); h++) {
       currBlock = arru (blocks,h,MrfBlock*);
-      intervals = intervalFind_getOverlappingIntervals (currBlock->targetName,currBlock->targetStart,currBlock->targetEnd);
+      intervalCursor_getOverlappingIntervalsById (mrfIntervalCursor_getCursor (cursor,currEntry,h < numRead1Blocks ? &currEntry->read1 : &currEntry->read2),
+                                                  currBlock->targetId,currBlock->targetStart,currBlock->targetEnd,intervals);
       count = 0;
       for (i = 0; i < arrayMax (intervals); i++) {
         currInterval = arru (intervals,i,Interval*);
         if (currInterval->strand == currBlock->strand) {
+          matchingInterval = currInterval;
           count++;
         }
       }
@@ -79,7 +87,7 @@ int main (int argc, char *argv[])
       }
       exonBaseCount = 0;
       foundRelativeStart = 0;
-      currInterval = arru (intervals,0,Interval*);
+      currInterval = matchingInterval;
       for (j = 0; j < arrayMax (currInterval->subIntervals); j++) {
         currSubInterval = arrp (currInterval->subIntervals,j,SubInterval);
         for (k = currSubInterval->start; k <= currSubInterval->end; k++) {
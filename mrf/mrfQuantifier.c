@@ -3,7 +3,9 @@
 #include "numUtil.h"
 #include "common.h"
 #include "intervalFind.h"
+#include "hashTable.h"
 #include "mrf.h"
+#include "mrfIntervalCursor.h"
 
 
 
@@ -32,20 +34,6 @@ typedef struct {
 
 
 
-static int sortTranscriptEntriesByTranscriptPointer (TranscriptEntry *a, TranscriptEntry *b)
-{
-  return a->transcript - b->transcript;
-}
-
-
-
-static int sortTranscriptEntriesByTranscriptName (TranscriptEntry *a, TranscriptEntry *b)
-{
-  return strcmp (a->transcript->name,b->transcript->name);
-}
-
-
-
 static int sortTranscriptsByName (Interval *a, Interval *b)
 {
   return strcmp (a->name,b->name);
@@ -53,21 +41,11 @@ static int sortTranscriptsByName (Interval *a, Interval *b)
 
 
 
-static int sortTranscriptsPointers (Interval **a, Interval **b)
+static void addOverlap (HashTable transcriptEntries, Interval *currTranscript, int overlap) 
 {
-  return *a - *b;
-}
-
-
-
-static void addOverlap (Array transcriptEntries, Interval *currTranscript, int overlap) 
-{
-  TranscriptEntry *currTranscriptEntry,testTranscriptEntry;
-  int index;
+  TranscriptEntry *currTranscriptEntry;
 
-  testTranscriptEntry.transcript = currTranscript;
-  if (arrayFind (transcriptEntries,&testTranscriptEntry,&index,(ARRAYORDERF)sortTranscriptEntriesByTranscriptPointer)) {
-    currTranscriptEntry = arrp (transcriptEntries,index,TranscriptEntry);
+  if (currTranscriptEntry = hashTable_getInt (transcriptEntries,(intptr_t)currTranscript)) {
     currTranscriptEntry->overlap += overlap;
   }
   else {
@@ -77,81 +55,43 @@ static void addOverlap (Array transcriptEntries, Interval *currTranscript, int o
 
 
 
-static void intersectWithAnnotationSingleOverlapMode (Array transcriptEntries, char *chromosome, int start, int end) 
+static void intersectWithAnnotationSingleOverlapMode (HashTable transcriptEntries, IntervalCursor cursor, int chromosomeId, int start, int end) 
 {
-  Array annotatedTranscripts;
-  Interval *currTranscript,*thisTranscript;
-  SubInterval *currExon;
-  int overlap;
-  int i,j;
-  int numOverlappingTranscripts;
-  int overlapFound;
-
-  annotatedTranscripts = intervalFind_getOverlappingIntervals (chromosome,start,end);
-  if (arrayMax (annotatedTranscripts) > 1) {
-    numOverlappingTranscripts = 0;
-    for (i = 0; i < arrayMax (annotatedTranscripts); i++) {
-      currTranscript = arru (annotatedTranscripts,i,Interval*);
-      j = 0; 
-      overlapFound = 0;
-      while (j < arrayMax (currTranscript->subIntervals)) {
-        currExon = arrp (currTranscript->subIntervals,j,SubInterval);
-        if (rangeIntersection (start,end,currExon->start,currExon->end) > 0) {
-          overlapFound = 1;
-          break;
-        }
-        j++;
-      }
-      if (overlapFound == 1) {
-        numOverlappingTranscripts++;
-        thisTranscript = currTranscript;
-      }
-    }
-    if (numOverlappingTranscripts != 1) {
+  Array annotatedExons;
+  SubIntervalMatch *currMatch;
+  int i;
+
+  annotatedExons = intervalCursor_getSubIntervalMatchesById (cursor,chromosomeId,start,end);
+  // the block is ignored if it overlaps with exons of more than one transcript
+  for (i = 1; i < arrayMax (annotatedExons); i++) {
+    if (arrp (annotatedExons,i,SubIntervalMatch)->interval != arrp (annotatedExons,0,SubIntervalMatch)->interval) {
       return;
     }
   }
-  else if (arrayMax (annotatedTranscripts) == 1) {
-    thisTranscript = arru (annotatedTranscripts,0,Interval*);
-  }
-  else {
-    return;
+  for (i = 0; i < arrayMax (annotatedExons); i++) {
+    currMatch = arrp (annotatedExons,i,SubIntervalMatch);
+    addOverlap (transcriptEntries,currMatch->interval,currMatch->overlap);
   }
-  for (i = 0; i < arrayMax (thisTranscript->subIntervals); i++) {
-    currExon = arrp (thisTranscript->subIntervals,i,SubInterval);
-    overlap = rangeIntersection (start,end,currExon->start,currExon->end);
-    if (overlap > 0) {
-      addOverlap (transcriptEntries,thisTranscript,overlap); 
-    }
-  } 
 }
 
 
 
-static void intersectWithAnnotationMultipleOverlapMode (Array transcriptEntries, char *chromosome, int start, int end) 
+static void intersectWithAnnotationMultipleOverlapMode (HashTable transcriptEntries, IntervalCursor cursor, int chromosomeId, int start, int end) 
 {
-  Array annotatedTranscripts;
-  Interval *currTranscript;
-  SubInterval *currExon;
-  int overlap;
-  int i,j;
+  Array annotatedExons;
+  SubIntervalMatch *currMatch;
+  int i;
 
-  annotatedTranscripts = intervalFind_getOverlappingIntervals (chromosome,start,end);
-  for (i = 0; i < arrayMax (annotatedTranscripts); i++) {
-    currTranscript = arru (annotatedTranscripts,i,Interval*);
-    for (j = 0; j < arrayMax (currTranscript->subIntervals); j++) {
-      currExon = arrp (currTranscript->subIntervals,j,SubInterval);
-      overlap = rangeIntersection (start,end,currExon->start,currExon->end);
-      if (overlap > 0) {
-        addOverlap (transcriptEntries,currTranscript,overlap); 
-      }
-    } 
+  annotatedExons = intervalCursor_getSubIntervalMatchesById (cursor,chromosomeId,start,end);
+  for (i = 0; i < arrayMax (annotatedExons); i++) {
+    currMatch = arrp (annotatedExons,i,SubIntervalMatch);
+    addOverlap (transcriptEntries,currMatch->interval,currMatch->overlap);
   }
 }
 
 
 
-static void processRead (Array transcriptEntries, MrfRead *currRead, int mode) 
+static void processRead (HashTable transcriptEntries, IntervalCursor cursor, MrfRead *currRead, int mode) 
 {
   MrfBlock *currBlock;
   int i;
@@ -159,11 +99,11 @@ static void processRead (Array transcriptEntries, MrfRead *currRead, int mode)
   for (i = 0; i < arrayMax (currRead->blocks); i++) {
     currBlock = arrp (currRead->blocks,i,MrfBlock);
     if (mode == MODE_SINGLE_OVERLAP) {
-      intersectWithAnnotationSingleOverlapMode (transcriptEntries,currBlock->targetName,
+      intersectWithAnnotationSingleOverlapMode (transcriptEntries,cursor,currBlock->targetId,
                                                 currBlock->targetStart-1,currBlock->targetEnd); // Interval: zero-based; MRF: 1-based
     }
     else if (mode == MODE_MULTIPLE_OVERLAP) {
-      intersectWithAnnotationMultipleOverlapMode (transcriptEntries,currBlock->targetName,
+      intersectWithAnnotationMultipleOverlapMode (transcriptEntries,cursor,currBlock->targetId,
                                                   currBlock->targetStart-1,currBlock->targetEnd);// Interval: zero-based; MRF: 1-based
     }
   }
@@ -173,18 +113,20 @@ static void processRead (Array transcriptEntries, MrfRead *currRead, int mode)
   
 int main (int argc, char *argv[])
 {
+  Array batch;
   MrfEntry *currMRF;
   Array intervals;
   Array intervalPointers;
   Interval *currTranscript;
   SubInterval *currExon;
-  int i,j;
+  int i,j,k;
   Array transcriptEntries;
-  TranscriptEntry *currTranscriptEntry,testTranscriptEntry;
+  HashTable transcriptEntriesByPointer,transcriptEntriesByName;
+  MrfIntervalCursor cursor;
+  TranscriptEntry *currTranscriptEntry;
   int transcriptLength;
   int numMrfEntries;
   double factor;
-  int index;
   int mode;
   long int totalNumNucleotides; 
 
@@ -202,36 +144,50 @@ int main (int argc, char *argv[])
   }
   intervalFind_addIntervalsToSearchSpace (argv[1],0);
   intervalPointers = intervalFind_getIntervalPointers ();
-  arraySort (intervalPointers,(ARRAYORDERF)sortTranscriptsPointers);
   intervals = intervalFind_getAllIntervals ();  
   arraySort (intervals,(ARRAYORDERF)sortTranscriptsByName);
-  transcriptEntries = arrayCreate (1000000,TranscriptEntry);
+  transcriptEntries = arrayCreate (arrayMax (intervalPointers),TranscriptEntry);
   for (i = 0; i < arrayMax (intervalPointers); i++) {
     currTranscriptEntry = arrayp (transcriptEntries,arrayMax (transcriptEntries),TranscriptEntry);
     currTranscriptEntry->transcript = arru (intervalPointers,i,Interval*);
     currTranscriptEntry->overlap = 0;
   }
-  arraySort (transcriptEntries,(ARRAYORDERF)sortTranscriptEntriesByTranscriptPointer);
+  // transcriptEntries is complete, so pointers to its elements stay valid
+  transcriptEntriesByPointer = hashTable_create (HASH_TABLE_INT_KEYS,arrayMax (transcriptEntries));
+  for (i = 0; i < arrayMax (transcriptEntries); i++) {
+    currTranscriptEntry = arrp (transcriptEntries,i,TranscriptEntry);
+    hashTable_putInt (transcriptEntriesByPointer,(intptr_t)currTranscriptEntry->transcript,currTranscriptEntry);
+  }
+  cursor = mrfIntervalCursor_createForSubIntervals (intervalFind_getSearchSpace ());
   numMrfEntries = 0;
   totalNumNucleotides = 0;
-  mrf_init ("-");
-  while (currMRF = mrf_nextEntry ()) {
-    numMrfEntries++;
-    processRead (transcriptEntries,&currMRF->read1,mode);
-    totalNumNucleotides += getReadLength (&currMRF->read1);   
-    if (currMRF->isPairedEnd) {
-      processRead (transcriptEntries,&currMRF->read2,mode);
-      totalNumNucleotides += getReadLength (&currMRF->read2);
-    }
-    if ((numMrfEntries % 1000000) == 0) {
-      warn ("Processed %d MrfEntries...",numMrfEntries);
+  mrf_initWithColumns ("-",MRF_COLUMNS_BLOCKS);
+  while (batch = mrf_nextBatch (MRF_DEFAULT_BATCH_SIZE)) {
+    for (k = 0; k < arrayMax (batch); k++) {
+      currMRF = arrp (batch,k,MrfEntry);
+      numMrfEntries++;
+      processRead (transcriptEntriesByPointer,mrfIntervalCursor_getCursor (cursor,currMRF,&currMRF->read1),&currMRF->read1,mode);
+      totalNumNucleotides += getReadLength (&currMRF->read1);   
+      if (currMRF->isPairedEnd) {
+        processRead (transcriptEntriesByPointer,mrfIntervalCursor_getCursor (cursor,currMRF,&currMRF->read2),&currMRF->read2,mode);
+        totalNumNucleotides += getReadLength (&currMRF->read2);
+      }
+      if ((numMrfEntries % 1000000) == 0) {
+        warn ("Processed %d MrfEntries...",numMrfEntries);
+      }
     }
   }
   warn ("Processed %d MrfEntries...",numMrfEntries);
   warn ("Number of mapped nucleotides: %ld", totalNumNucleotides );
   mrf_deInit ();
   factor = (double)totalNumNucleotides / 1000000; 
-  arraySort (transcriptEntries,(ARRAYORDERF)sortTranscriptEntriesByTranscriptName);
+  transcriptEntriesByName = hashTable_create (HASH_TABLE_STRING_KEYS,arrayMax (transcriptEntries));
+  for (i = 0; i < arrayMax (transcriptEntries); i++) {
+    currTranscriptEntry = arrp (transcriptEntries,i,TranscriptEntry);
+    if (hashTable_getString (transcriptEntriesByName,currTranscriptEntry->transcript->name) == NULL) {
+      hashTable_putString (transcriptEntriesByName,currTranscriptEntry->transcript->name,currTranscriptEntry);
+    }
+  }
   for (i = 0; i < arrayMax (intervals); i++) {
     currTranscript = arrp (intervals,i,Interval);
     transcriptLength = 0;
@@ -239,17 +195,14 @@ int main (int argc, char *argv[])
       currExon = arrp (currTranscript->subIntervals,j,SubInterval);
       transcriptLength += currExon->end - currExon->start; // Interval: zero-based, half open
     }
-    AllocVar (testTranscriptEntry.transcript);
-    testTranscriptEntry.transcript->name = hlr_strdup (currTranscript->name);
-    if (arrayFind (transcriptEntries,&testTranscriptEntry,&index,(ARRAYORDERF)sortTranscriptEntriesByTranscriptName)) {
-      currTranscriptEntry = arrp (transcriptEntries,index,TranscriptEntry);
+    if (currTranscriptEntry = hashTable_getString (transcriptEntriesByName,currTranscript->name)) {
       printf ("%s\t%f\n",currTranscriptEntry->transcript->name,currTranscriptEntry->overlap / (transcriptLength * factor) * 1000.0);
     }
     else {
       die ("Expected to find transcript name");
     }
-    hlr_free (testTranscriptEntry.transcript->name);
-    freeMem (testTranscriptEntry.transcript);
   }
+  hashTable_destroy (transcriptEntriesByPointer);
+  hashTable_destroy (transcriptEntriesByName);
   return 0;
 }
@@ -0,0 +1,547 @@
+#include <errno.h>
+#include "log.h"
+#include "format.h"
+#include "linestream.h"
+#include "common.h"
+#include "symbolTable.h"
+#include "mrf.h"
+#include "mrfRegionIndex.h"
+
+
+
+/**
+ *   \file mrfRegionIndex.c Module to build and query a region index of a coordinate-sorted MRF file.
+ *   The MRF entries must be sorted by the first alignment block of read1: all entries of a target
+ *   are consecutive and their targetStart is non-decreasing. For each target, the index stores the
+ *   offset of the first entry that overlaps each window of 2^MRF_REGION_INDEX_WINDOW_SHIFT bases (linear index).
+ *   In the linear index, an entry covers all blocks of both reads that are located on the target of its first block.
+ *   Entries with blocks on other targets as well, e.g. a mate mapped to another chromosome, are listed 
+ *   under each of these targets as extra entries, with the span of their blocks on that target.
+ *   The index file is a text file:
+ *
+ *   \verbatim
+   #mrfRegionIndex <tab> version <tab> windowShift
+   targetName <tab> lookBack <tab> numWindows <tab> offset,offset,... <tab> numExtras <tab> offset:start:end,...
+   \endverbatim
+ *
+ *   lookBack is the maximal distance by which an entry extends upstream of its first block.
+ *   An offset of 0 denotes a window without entries (offset 0 is always the header line of the MRF file).
+ */
+
+
+
+#define MRF_REGION_INDEX_VERSION 2
+
+
+
+/**
+ * An entry whose first block is on another target.
+ */
+typedef struct {
+  off_t offset;
+  int start;         // span of the blocks of the entry on this target
+  int end;
+} IndexExtra;
+
+
+
+typedef struct {
+  char *targetName;
+  int lookBack;
+  Array offsets;     // of type off_t, one per window
+  Array extras;      // of type IndexExtra, in file order
+} IndexTarget;
+
+
+
+struct _mrfRegionIndexStruct_ {
+  Array targets;     // of type IndexTarget, sorted by targetName
+};
+
+
+
+struct _mrfRegionQueryStruct_ {
+  MrfReader reader;
+  int targetId;
+  int hasWindows;    // whether the linear index has entries that may overlap the region
+  off_t offset;      // where the entries located through the linear index start
+  int maxStart;      // entries whose first block starts after maxStart cannot overlap the region
+  int state;         // MRF_REGION_QUERY_*
+  Array extras;      // of type off_t, the extra entries overlapping the region, in file order
+  int nextExtra;
+};
+
+
+
+#define MRF_REGION_QUERY_EXTRAS_BEFORE 1   // extra entries before the linear index offset
+#define MRF_REGION_QUERY_WINDOWS 2         // entries read sequentially from the linear index offset
+#define MRF_REGION_QUERY_EXTRAS_AFTER 3    // extra entries after the sequentially read ones
+
+
+
+static int mrfRegionIndex_sortTargetsByName (IndexTarget *a, IndexTarget *b)
+{
+  return strcmp (a->targetName,b->targetName);
+}
+
+
+
+static void mrfRegionIndex_getSpan (MrfRead *currRead, int targetId, int *spanStart, int *spanEnd)
+{
+  MrfBlock *currBlock;
+  int i;
+
+  for (i = 0; i < arrayMax (currRead->blocks); i++) {
+    currBlock = arrp (currRead->blocks,i,MrfBlock);
+    if (currBlock->targetId != targetId) {
+      continue;
+    }
+    if (currBlock->targetStart < *spanStart) {
+      *spanStart = currBlock->targetStart;
+    }
+    if (currBlock->targetEnd > *spanEnd) {
+      *spanEnd = currBlock->targetEnd;
+    }
+  }
+}
+
+
+
+static void mrfRegionIndex_addEntry (IndexTarget *currTarget, MrfEntry *currEntry, off_t offset)
+{
+  MrfBlock *firstBlock;
+  off_t *currOffset;
+  int spanStart,spanEnd;
+  int window;
+
+  firstBlock = arrp (currEntry->read1.blocks,0,MrfBlock);
+  spanStart = firstBlock->targetStart;
+  spanEnd = firstBlock->targetEnd;
+  mrfRegionIndex_getSpan (&currEntry->read1,firstBlock->targetId,&spanStart,&spanEnd);
+  if (currEntry->isPairedEnd) {
+    mrfRegionIndex_getSpan (&currEntry->read2,firstBlock->targetId,&spanStart,&spanEnd);
+  }
+  if (firstBlock->targetStart - spanStart > currTarget->lookBack) {
+    currTarget->lookBack = firstBlock->targetStart - spanStart;
+  }
+  for (window = MAX (spanStart,0) >> MRF_REGION_INDEX_WINDOW_SHIFT; window <= MAX (spanEnd,0) >> MRF_REGION_INDEX_WINDOW_SHIFT; window++) {
+    currOffset = arrayp (currTarget->offsets,window,off_t);
+    if (*currOffset == 0) {
+      *currOffset = offset;
+    }
+  }
+}
+
+
+
+static int mrfRegionIndex_hasTarget (MrfRead *currRead, int numBlocks, int targetId)
+{
+  int i;
+
+  for (i = 0; i < numBlocks; i++) {
+    if (arrp (currRead->blocks,i,MrfBlock)->targetId == targetId) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+
+
+static IndexTarget* mrfRegionIndex_getTarget (MrfRegionIndex index, Array targetNumbers, int targetId)
+{
+  IndexTarget *currTarget;
+  int *number;
+
+  number = arrayp (targetNumbers,targetId,int);
+  if (*number == 0) {
+    currTarget = arrayp (index->targets,arrayMax (index->targets),IndexTarget);
+    currTarget->targetName = hlr_strdup (symbolTable_getName (targetId));
+    currTarget->lookBack = 0;
+    currTarget->offsets = arrayCreate (1000,off_t);
+    currTarget->extras = arrayCreate (100,IndexExtra);
+    *number = arrayMax (index->targets);
+  }
+  return arrp (index->targets,*number - 1,IndexTarget);
+}
+
+
+
+/**
+ * List an entry as an extra entry under each target other than the one of its first block.
+ */
+static void mrfRegionIndex_addExtras (MrfRegionIndex index, Array targetNumbers, MrfEntry *currEntry, off_t offset)
+{
+  MrfRead *reads[2];
+  MrfBlock *currBlock;
+  IndexTarget *extraTarget;
+  IndexExtra *currExtra;
+  int firstTargetId;
+  int r,i;
+
+  reads[0] = &currEntry->read1;
+  reads[1] = &currEntry->read2;
+  firstTargetId = arrp (currEntry->read1.blocks,0,MrfBlock)->targetId;
+  for (r = 0; r < (currEntry->isPairedEnd ? 2 : 1); r++) {
+    for (i = 0; i < arrayMax (reads[r]->blocks); i++) {
+      currBlock = arrp (reads[r]->blocks,i,MrfBlock);
+      if (currBlock->targetId == firstTargetId || 
+          mrfRegionIndex_hasTarget (reads[r],i,currBlock->targetId) || 
+          (r == 1 && mrfRegionIndex_hasTarget (reads[0],arrayMax (reads[0]->blocks),currBlock->targetId))) {
+        continue;
+      }
+      extraTarget = mrfRegionIndex_getTarget (index,targetNumbers,currBlock->targetId);
+      currExtra = arrayp (extraTarget->extras,arrayMax (extraTarget->extras),IndexExtra);
+      currExtra->offset = offset;
+      currExtra->start = currBlock->targetStart;
+      currExtra->end = currBlock->targetEnd;
+      mrfRegionIndex_getSpan (&currEntry->read1,currBlock->targetId,&currExtra->start,&currExtra->end);
+      if (currEntry->isPairedEnd) {
+        mrfRegionIndex_getSpan (&currEntry->read2,currBlock->targetId,&currExtra->start,&currExtra->end);
+      }
+    }
+  }
+}
+
+
+
+/**
+ * Build the region index of an MRF file.
+ * @param[in] mrfFileName Name of a coordinate-sorted MRF text file
+ * @return The index. Dies if the file is not sorted.
+ */
+MrfRegionIndex mrfRegionIndex_build (char *mrfFileName)
+{
+  MrfRegionIndex index;
+  MrfReader reader;
+  MrfEntry *currEntry;
+  MrfBlock *firstBlock;
+  IndexTarget *currTarget;
+  Array targetNumbers;
+  Array seenTargets;
+  int *seen;
+  int currTargetId;
+  int prevTargetStart;
+  int entryCount;
+  off_t offset;
+
+  if (strEqual (mrfFileName,"-")) {
+    die ("Cannot index MRF from stdin");
+  }
+  AllocVar (index);
+  index->targets = arrayCreate (100,IndexTarget);
+  targetNumbers = arrayCreate (100,int);
+  seenTargets = arrayCreate (100,int);
+  reader = mrfReader_open (mrfFileName);
+  currTargetId = -1;
+  prevTargetStart = 0;
+  entryCount = 0;
+  while (1) {
+    offset = mrfReader_tell (reader);
+    if (!(currEntry = mrfReader_next (reader))) {
+      break;
+    }
+    entryCount++;
+    if (arrayMax (currEntry->read1.blocks) == 0) {
+      continue;
+    }
+    firstBlock = arrp (currEntry->read1.blocks,0,MrfBlock);
+    if (firstBlock->targetId != currTargetId) {
+      seen = arrayp (seenTargets,firstBlock->targetId,int);
+      if (*seen) {
+        die ("MRF file is not sorted: entries of %s are not consecutive (entry %d)",firstBlock->targetName,entryCount);
+      }
+      *seen = 1;
+      currTargetId = firstBlock->targetId;
+    }
+    else if (firstBlock->targetStart < prevTargetStart) {
+      die ("MRF file is not sorted: %s:%d follows %s:%d (entry %d)",
+           firstBlock->targetName,firstBlock->targetStart,firstBlock->targetName,prevTargetStart,entryCount);
+    }
+    prevTargetStart = firstBlock->targetStart;
+    currTarget = mrfRegionIndex_getTarget (index,targetNumbers,currTargetId);
+    mrfRegionIndex_addEntry (currTarget,currEntry,offset);
+    mrfRegionIndex_addExtras (index,targetNumbers,currEntry,offset);
+  }
+  mrfReader_close (reader);
+  arrayDestroy (targetNumbers);
+  arrayDestroy (seenTargets);
+  arraySort (index->targets,(ARRAYORDERF)mrfRegionIndex_sortTargetsByName);
+  return index;
+}
+
+
+
+/**
+ * Write a region index to a file.
+ */
+void mrfRegionIndex_write (MrfRegionIndex index, char *indexFileName)
+{
+  FILE *fp;
+  IndexTarget *currTarget;
+  IndexExtra *currExtra;
+  int i,j;
+
+  if (!(fp = fopen (indexFileName,"w"))) {
+    die ("Unable to open file: %s",indexFileName);
+  }
+  fprintf (fp,"#mrfRegionIndex\t%d\t%d\n",MRF_REGION_INDEX_VERSION,MRF_REGION_INDEX_WINDOW_SHIFT);
+  for (i = 0; i < arrayMax (index->targets); i++) {
+    currTarget = arrp (index->targets,i,IndexTarget);
+    fprintf (fp,"%s\t%d\t%d\t",currTarget->targetName,currTarget->lookBack,(int)arrayMax (currTarget->offsets));
+    for (j = 0; j < arrayMax (currTarget->offsets); j++) {
+      fprintf (fp,"%s%lld",j > 0 ? "," : "",(long long)arru (currTarget->offsets,j,off_t));
+    }
+    fprintf (fp,"\t%d\t",(int)arrayMax (currTarget->extras));
+    for (j = 0; j < arrayMax (currTarget->extras); j++) {
+      currExtra = arrp (currTarget->extras,j,IndexExtra);
+      fprintf (fp,"%s%lld:%d:%d",j > 0 ? "," : "",(long long)currExtra->offset,currExtra->start,currExtra->end);
+    }
+    fputc ('\n',fp);
+  }
+  if (fclose (fp) != 0) {
+    die ("Unable to write file %s: %s",indexFileName,strerror (errno));
+  }
+}
+
+
+
+/**
+ * Read a region index written by mrfRegionIndex_write().
+ */
+MrfRegionIndex mrfRegionIndex_read (char *indexFileName)
+{
+  MrfRegionIndex index;
+  LineStream ls;
+  IndexTarget *currTarget;
+  IndexExtra *currExtra;
+  Texta tokens;
+  char *line;
+  char *pos;
+  int numWindows,numExtras;
+  int i;
+
+  if (!(ls = ls_createFromFile (indexFileName))) {
+    die ("Unable to open index file: %s",indexFileName);
+  }
+  line = ls_nextLine (ls);
+  if (line == NULL || !strStartsWithC (line,"#mrfRegionIndex\t")) {
+    die ("Not an MRF region index: %s",indexFileName);
+  }
+  tokens = textFieldtokP (line,"\t");
+  if (arrayMax (tokens) != 3 || atoi (textItem (tokens,1)) != MRF_REGION_INDEX_VERSION ||
+      atoi (textItem (tokens,2)) != MRF_REGION_INDEX_WINDOW_SHIFT) {
+    die ("Unsupported MRF region index: %s",indexFileName);
+  }
+  textDestroy (tokens);
+  AllocVar (index);
+  index->targets = arrayCreate (100,IndexTarget);
+  while (line = ls_nextLine (ls)) {
+    tokens = textFieldtokP (line,"\t");
+    if (arrayMax (tokens) != 6) {
+      die ("Invalid line in MRF region index %s: %s",indexFileName,line);
+    }
+    currTarget = arrayp (index->targets,arrayMax (index->targets),IndexTarget);
+    currTarget->targetName = hlr_strdup (textItem (tokens,0));
+    currTarget->lookBack = atoi (textItem (tokens,1));
+    numWindows = atoi (textItem (tokens,2));
+    currTarget->offsets = arrayCreate (numWindows,off_t);
+    pos = textItem (tokens,3);
+    for (i = 0; i < numWindows; i++) {
+      array (currTarget->offsets,i,off_t) = strtoll (pos,&pos,10);
+      if (*pos == ',') {
+        pos++;
+      }
+    }
+    numExtras = atoi (textItem (tokens,4));
+    currTarget->extras = arrayCreate (numExtras,IndexExtra);
+    pos = textItem (tokens,5);
+    for (i = 0; i < numExtras; i++) {
+      currExtra = arrayp (currTarget->extras,i,IndexExtra);
+      currExtra->offset = strtoll (pos,&pos,10);
+      currExtra->start = strtol (pos + 1,&pos,10);
+      currExtra->end = strtol (pos + 1,&pos,10);
+      if (*pos == ',') {
+        pos++;
+      }
+    }
+    textDestroy (tokens);
+  }
+  ls_destroy (ls);
+  arraySort (index->targets,(ARRAYORDERF)mrfRegionIndex_sortTargetsByName);
+  return index;
+}
+
+
+
+/**
+ * Get the default name of the index file of an MRF file.
+ * @return mrfFileName followed by MRF_REGION_INDEX_SUFFIX. The memory belongs to this routine.
+ */
+char* mrfRegionIndex_getDefaultFileName (char *mrfFileName)
+{
+  static Stringa buffer = NULL;
+
+  stringCreateClear (buffer,100);
+  stringPrintf (buffer,"%s%s",mrfFileName,MRF_REGION_INDEX_SUFFIX);
+  return string (buffer);
+}
+
+
+
+static IndexTarget* mrfRegionIndex_findTarget (MrfRegionIndex index, char *targetName)
+{
+  IndexTarget testTarget;
+  int position;
+
+  testTarget.targetName = targetName;
+  if (!arrayFind (index->targets,&testTarget,&position,(ARRAYORDERF)mrfRegionIndex_sortTargetsByName)) {
+    return NULL;
+  }
+  return arrp (index->targets,position,IndexTarget);
+}
+
+
+
+/**
+ * Start a query for the entries that overlap a region.
+ * @param[in] index A region index
+ * @param[in] reader Reader of the indexed MRF file, see mrfReader_seek()
+ * @param[in] targetName Target of the region
+ * @param[in] start Start of the region
+ * @param[in] end End of the region
+ * @return A query, see mrfRegionIndex_nextEntry()
+ */
+MrfRegionQuery mrfRegionIndex_startQuery (MrfRegionIndex index, MrfReader reader, char *targetName, int start, int end)
+{
+  MrfRegionQuery query;
+  IndexTarget *currTarget;
+  IndexExtra *currExtra;
+  off_t currOffset;
+  int window,lastWindow;
+  int i;
+
+  AllocVar (query);
+  query->reader = reader;
+  query->targetId = symbolTable_intern (targetName);
+  query->state = MRF_REGION_QUERY_EXTRAS_BEFORE;
+  query->extras = arrayCreate (100,off_t);
+  query->nextExtra = 0;
+  query->offset = 0;
+  if (!(currTarget = mrfRegionIndex_findTarget (index,targetName))) {
+    return query;
+  }
+  lastWindow = MIN (MAX (end,0) >> MRF_REGION_INDEX_WINDOW_SHIFT,arrayMax (currTarget->offsets) - 1);
+  for (window = MAX (start,0) >> MRF_REGION_INDEX_WINDOW_SHIFT; window <= lastWindow; window++) {
+    currOffset = arru (currTarget->offsets,window,off_t);
+    if (currOffset != 0 && (query->offset == 0 || currOffset < query->offset)) {
+      query->offset = currOffset;
+    }
+  }
+  query->hasWindows = query->offset != 0;
+  query->maxStart = end + currTarget->lookBack;
+  for (i = 0; i < arrayMax (currTarget->extras); i++) {
+    currExtra = arrp (currTarget->extras,i,IndexExtra);
+    if (currExtra->start <= end && currExtra->end >= start) {
+      array (query->extras,arrayMax (query->extras),off_t) = currExtra->offset;
+    }
+  }
+  return query;
+}
+
+
+
+/**
+ * Check whether an entry, and all entries following it in a sorted MRF file, lie beyond the region of a query.
+ */
+static int mrfRegionIndex_isPastRegion (MrfRegionQuery query, MrfEntry *currEntry)
+{
+  MrfBlock *firstBlock;
+
+  if (arrayMax (currEntry->read1.blocks) == 0) {
+    return 0;
+  }
+  firstBlock = arrp (currEntry->read1.blocks,0,MrfBlock);
+  return firstBlock->targetId != query->targetId || firstBlock->targetStart > query->maxStart;
+}
+
+
+
+static MrfEntry* mrfRegionIndex_readExtra (MrfRegionQuery query)
+{
+  mrfReader_seek (query->reader,arru (query->extras,query->nextExtra,off_t));
+  query->nextExtra++;
+  return mrfReader_next (query->reader);
+}
+
+
+
+/**
+ * Get the next entry of a query, in file order. 
+ * The entries are candidates: all entries overlapping the region are returned, but not all returned entries overlap the region.
+ * @param[in] query A query started by mrfRegionIndex_startQuery()
+ * @return The next entry, or NULL if there are no more entries. The memory belongs to the reader.
+ */
+MrfEntry* mrfRegionIndex_nextEntry (MrfRegionQuery query)
+{
+  MrfEntry *currEntry;
+
+  if (query->state == MRF_REGION_QUERY_EXTRAS_BEFORE) {
+    if (query->nextExtra < arrayMax (query->extras) && 
+        (!query->hasWindows || arru (query->extras,query->nextExtra,off_t) < query->offset)) {
+      return mrfRegionIndex_readExtra (query);
+    }
+    if (query->hasWindows) {
+      mrfReader_seek (query->reader,query->offset);
+    }
+    query->state = query->hasWindows ? MRF_REGION_QUERY_WINDOWS : MRF_REGION_QUERY_EXTRAS_AFTER;
+  }
+  if (query->state == MRF_REGION_QUERY_WINDOWS) {
+    // the extra entries of a target are never located between its own entries
+    if ((currEntry = mrfReader_next (query->reader)) && !mrfRegionIndex_isPastRegion (query,currEntry)) {
+      return currEntry;
+    }
+    query->state = MRF_REGION_QUERY_EXTRAS_AFTER;
+  }
+  if (query->nextExtra < arrayMax (query->extras)) {
+    return mrfRegionIndex_readExtra (query);
+  }
+  return NULL;
+}
+
+
+
+/**
+ * End a query started by mrfRegionIndex_startQuery().
+ */
+void mrfRegionIndex_endQuery (MrfRegionQuery query)
+{
+  if (query == NULL) {
+    return;
+  }
+  arrayDestroy (query->extras);
+  freeMem (query);
+}
+
+
+
+/**
+ * Destroy a region index.
+ */
+void mrfRegionIndex_destroy (MrfRegionIndex index)
+{
+  IndexTarget *currTarget;
+  int i;
+
+  if (index == NULL) {
+    return;
+  }
+  for (i = 0; i < arrayMax (index->targets); i++) {
+    currTarget = arrp (index->targets,i,IndexTarget);
+    hlr_free (currTarget->targetName);
+    arrayDestroy (currTarget->offsets);
+    arrayDestroy (currTarget->extras);
+  }
+  arrayDestroy (index->targets);
+  freeMem (index);
+}
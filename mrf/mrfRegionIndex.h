@@ -0,0 +1,51 @@
+#ifndef DEF_MRF_REGION_INDEX_H
+#define DEF_MRF_REGION_INDEX_H
+
+
+
+/**
+ *   \file mrfRegionIndex.h
+ */
+
+
+
+#include <sys/types.h>
+
+
+
+/**
+ * Default suffix of an index file, which is stored next to the MRF file.
+ */
+#define MRF_REGION_INDEX_SUFFIX ".mri"
+
+/**
+ * Each target is divided into windows of 2^MRF_REGION_INDEX_WINDOW_SHIFT bases.
+ */
+#define MRF_REGION_INDEX_WINDOW_SHIFT 14
+
+
+
+/**
+ * MrfRegionIndex.
+ */
+typedef struct _mrfRegionIndexStruct_ *MrfRegionIndex;
+
+/**
+ * MrfRegionQuery.
+ */
+typedef struct _mrfRegionQueryStruct_ *MrfRegionQuery;
+
+
+
+extern MrfRegionIndex mrfRegionIndex_build (char *mrfFileName);
+extern void mrfRegionIndex_write (MrfRegionIndex index, char *indexFileName);
+extern MrfRegionIndex mrfRegionIndex_read (char *indexFileName);
+extern char* mrfRegionIndex_getDefaultFileName (char *mrfFileName);
+extern MrfRegionQuery mrfRegionIndex_startQuery (MrfRegionIndex index, MrfReader reader, char *targetName, int start, int end);
+extern MrfEntry* mrfRegionIndex_nextEntry (MrfRegionQuery query);
+extern void mrfRegionIndex_endQuery (MrfRegionQuery query);
+extern void mrfRegionIndex_destroy (MrfRegionIndex index);
+
+
+
+#endif
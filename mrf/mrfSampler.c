@@ -25,12 +25,13 @@ int main (int argc, char *argv[])
   proportion = atof (argv[1]);
   srand (time (0));
   mrf_init ("-"); 
-  puts (mrf_writeHeader ());
+  mrf_keepLines ();
+  mrf_putHeader ();
   while (currEntry = mrf_nextEntry ()) {
     if ((1.0 * rand () / RAND_MAX) > proportion) {
       continue;
     }  
-    puts (mrf_writeEntry (currEntry));
+    mrf_putUnmodifiedEntry (currEntry);
   }
   mrf_deInit (); 
   return 0;
@@ -3,6 +3,7 @@
 #include "numUtil.h"
 #include "intervalFind.h"
 #include "mrf.h"
+#include "mrfIntervalCursor.h"
 
 
 
@@ -19,27 +20,15 @@
 
 
 
-static int isContained (MrfRead *currRead)
+static int isContained (IntervalCursor cursor, MrfRead *currRead)
 {
   MrfBlock* currBlock;
-  Array annotatedTranscripts;
-  Interval *currTranscript;
-  SubInterval *currExon;
-  int overlap;
-  int i,j,k;
+  int i;
 
   for (i = 0; i < arrayMax (currRead->blocks); i++) {
     currBlock = arrp (currRead->blocks,i,MrfBlock);
-    annotatedTranscripts = intervalFind_getOverlappingIntervals (currBlock->targetName,currBlock->targetStart,currBlock->targetEnd);
-    for (j = 0; j < arrayMax (annotatedTranscripts); j++) {
-      currTranscript = arru (annotatedTranscripts,j,Interval*);
-      for (k = 0; k < arrayMax (currTranscript->subIntervals); k++) {
-        currExon = arrp (currTranscript->subIntervals,k,SubInterval);
-        overlap = rangeIntersection (currBlock->targetStart,currBlock->targetEnd,currExon->start,currExon->end);
-        if (overlap > 0) {
-          return 1;
-        }
-      } 
+    if (arrayMax (intervalCursor_getSubIntervalMatchesById (cursor,currBlock->targetId,currBlock->targetStart,currBlock->targetEnd)) > 0) {
+      return 1;
     }
   }
   return 0;
@@ -47,18 +36,18 @@ static int isContained (MrfRead *currRead)
 
 
 
-static void processEntry (MrfEntry *currEntry, int mode) 
+static void processEntry (MrfIntervalCursor cursor, MrfEntry *currEntry, int mode) 
 {
   int containment;
 
   containment = 0;
-  containment += isContained (&currEntry->read1);
+  containment += isContained (mrfIntervalCursor_getCursor (cursor,currEntry,&currEntry->read1),&currEntry->read1);
   if (currEntry->isPairedEnd) {
-    containment += isContained (&currEntry->read2);
+    containment += isContained (mrfIntervalCursor_getCursor (cursor,currEntry,&currEntry->read2),&currEntry->read2);
   }
   if ((containment != 0 && mode == MODE_INCLUDE) ||
       (containment == 0 && mode == MODE_EXCLUDE)) {
-    puts (mrf_writeEntry (currEntry));
+    mrf_putUnmodifiedEntry (currEntry);
   }
 }
 
@@ -66,8 +55,10 @@ static void processEntry (MrfEntry *currEntry, int mode)
 
 int main (int argc, char *argv[])
 {
-  MrfEntry *currEntry;
+  Array batch;
+  MrfIntervalCursor cursor;
   int mode;
+  int i;
  
   if (argc != 3) {
     usage ("%s <file.annotation> <include|exclude>",argv[0]);
@@ -82,11 +73,14 @@ int main (int argc, char *argv[])
   else {
      usage ("%s <file.annotation> <include|exclude>",argv[0]);
   }
-
+  cursor = mrfIntervalCursor_createForSubIntervals (intervalFind_getSearchSpace ());
   mrf_init ("-");
-  puts (mrf_writeHeader ());
-  while (currEntry = mrf_nextEntry ()) {
-    processEntry (currEntry,mode);
+  mrf_keepLines ();
+  mrf_putHeader ();
+  while (batch = mrf_nextBatch (MRF_DEFAULT_BATCH_SIZE)) {
+    for (i = 0; i < arrayMax (batch); i++) {
+      processEntry (cursor,arrp (batch,i,MrfEntry),mode);
+    }
   }
   mrf_deInit ();
   return 0;
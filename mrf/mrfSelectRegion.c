@@ -1,26 +1,29 @@
 #include "log.h"
 #include "format.h"
 #include "numUtil.h"
+#include "symbolTable.h"
 #include "mrf.h"
+#include "mrfRegionIndex.h"
 
 
 
 /** 
  *   \file mrfSelectRegion.c Module to select a subset of reads that overlap with a specified region.
- *         Usage:  mrfSelectRegion targetName:targetStart:targetEnd \n
- *         Takes MRF from STDIN. \n
+ *         Usage:  mrfSelectRegion targetName:targetStart:targetEnd [<file.mrf> [<file.mrf.mri>]] \n
+ *         Takes MRF from STDIN. If an MRF file is given, its region index (see mrfIndex.c) is used 
+ *         to read only the entries near the region. \n
  */
 
 
 
-static int isContained (MrfRead *currRead, char *targetName, int targetStart, int targetEnd)
+static int isContained (MrfRead *currRead, int targetId, int targetStart, int targetEnd)
 {
   MrfBlock* currBlock;
   int i;
 
   for (i = 0; i < arrayMax (currRead->blocks); i++) {
     currBlock = arrp (currRead->blocks,i,MrfBlock);
-    if (strEqual (currBlock->targetName,targetName)) {
+    if (currBlock->targetId == targetId) {
       if (rangeIntersection (currBlock->targetStart,currBlock->targetEnd,targetStart,targetEnd) > 0 ) {
         return 1;
       }     
@@ -31,17 +34,17 @@ static int isContained (MrfRead *currRead, char *targetName, int targetStart, in
 
 
 
-static void processEntry (MrfEntry *currEntry, char *targetName, int targetStart, int targetEnd) 
+static void processEntry (MrfWriter writer, MrfEntry *currEntry, int targetId, int targetStart, int targetEnd) 
 {
   int containment;
 
   containment = 0;
-  containment += isContained (&currEntry->read1,targetName,targetStart,targetEnd);
+  containment += isContained (&currEntry->read1,targetId,targetStart,targetEnd);
   if (currEntry->isPairedEnd) {
-    containment += isContained (&currEntry->read2,targetName,targetStart,targetEnd);
+    containment += isContained (&currEntry->read2,targetId,targetStart,targetEnd);
   }
   if (containment != 0) {
-    puts (mrf_writeEntry (currEntry));
+    mrfWriter_putUnmodifiedEntry (writer,currEntry);
   }
 }
 
@@ -49,26 +52,49 @@ static void processEntry (MrfEntry *currEntry, char *targetName, int targetStart
 
 int main (int argc, char *argv[])
 {
+  MrfReader reader;
+  MrfWriter writer;
+  MrfRegionIndex index;
+  MrfRegionQuery query;
+  Array batch;
   MrfEntry *currEntry;
   char *targetName;
-  int targetStart,targetEnd;
+  int targetId,targetStart,targetEnd;
   WordIter w;
+  int i;
  
-  if (argc != 2) {
-    usage ("%s <targetName:targetStart-targetEnd>",argv[0]);
+  if (argc < 2 || argc > 4) {
+    usage ("%s <targetName:targetStart-targetEnd> [<file.mrf> [<file.mrf%s>]]",argv[0],MRF_REGION_INDEX_SUFFIX);
   }
   w = wordIterCreate (argv[1],":- ",0);
   targetName = hlr_strdup (wordNext (w));
   targetStart = atoi (wordNext (w));
   targetEnd = atoi (wordNext (w));
   wordIterDestroy (w);
+  targetId = symbolTable_intern (targetName);
 
-  mrf_init ("-");
-  puts (mrf_writeHeader ());
-  while (currEntry = mrf_nextEntry ()) {
-    processEntry (currEntry,targetName,targetStart,targetEnd);
+  reader = mrfReader_open (argc > 2 ? argv[2] : "-");
+  mrfReader_keepLines (reader);
+  writer = mrfWriter_create (reader);
+  mrfWriter_putHeader (writer);
+  if (argc == 2) {
+    while (batch = mrfReader_nextBatch (reader,MRF_DEFAULT_BATCH_SIZE)) {
+      for (i = 0; i < arrayMax (batch); i++) {
+        processEntry (writer,arrp (batch,i,MrfEntry),targetId,targetStart,targetEnd);
+      }
+    }
+  }
+  else {
+    index = mrfRegionIndex_read (argc == 4 ? argv[3] : mrfRegionIndex_getDefaultFileName (argv[2]));
+    query = mrfRegionIndex_startQuery (index,reader,targetName,targetStart,targetEnd);
+    while (currEntry = mrfRegionIndex_nextEntry (query)) {
+      processEntry (writer,currEntry,targetId,targetStart,targetEnd);
+    }
+    mrfRegionIndex_endQuery (query);
+    mrfRegionIndex_destroy (index);
   }
-  mrf_deInit ();
+  mrfWriter_destroy (writer);
+  mrfReader_close (reader);
   hlr_free (targetName);
   return 0;
 }
@@ -25,7 +25,7 @@ static void processEntry (MrfEntry *currEntry)
     }
   }
   if (isSpliced != 0) {
-    puts (mrf_writeEntry (currEntry));
+    mrf_putUnmodifiedEntry (currEntry);
   }
 }
 
@@ -33,12 +33,16 @@ static void processEntry (MrfEntry *currEntry)
 
 int main (int argc, char *argv[])
 {
-  MrfEntry *currEntry;
+  Array batch;
+  int i;
  
   mrf_init ("-");
-  puts (mrf_writeHeader ());
-  while (currEntry = mrf_nextEntry ()) {
-    processEntry (currEntry);
+  mrf_keepLines ();
+  mrf_putHeader ();
+  while (batch = mrf_nextBatch (MRF_DEFAULT_BATCH_SIZE)) {
+    for (i = 0; i < arrayMax (batch); i++) {
+      processEntry (arrp (batch,i,MrfEntry));
+    }
   }
   mrf_deInit ();
   return 0;
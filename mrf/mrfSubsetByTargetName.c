@@ -1,5 +1,8 @@
 #include "log.h"
 #include "format.h"
+#include "common.h"
+#include "outStream.h"
+#include "hashTable.h"
 #include "mrf.h"
 #include <stdio.h>
 
@@ -8,20 +11,21 @@
 /** 
  *   \file mrfSubsetByTargetName.c Module to subset MRF file by TargetName.
  *         Usage: subsetMrfByTargetName <file.mrf> \n
+ *         The output files are compressed if the environment variable OUTSTREAM_COMPRESS is set, see outStream_create().
  */
 
 
 
 typedef struct {
-  FILE *fp;
+  OutStream stream;
   char *targetName;
 } Target;
 
 
 
-static int sortTargets (Target *a, Target *b) 
+static int sortTargetPointers (Target **a, Target **b) 
 {
-  return strcmp (a->targetName,b->targetName);
+  return strcmp ((*a)->targetName,(*b)->targetName);
 }
 
 
@@ -39,14 +43,12 @@ static void addTargetNames (Texta targetNames, Array alignmentBlocks)
 
 
 
-static void processEntry (Array targets, MrfEntry *currEntry, char *prefix)
+static void processEntry (Array targets, HashTable targetsByName, MrfEntry *currEntry, char *prefix)
 {
   int i;
   static Texta targetNames = NULL;
-  Target testEntry;
   Target *currTarget;
   static Stringa buffer = NULL;
-  int index;
 
   textCreateClear (targetNames,10);
   addTargetNames (targetNames,currEntry->read1.blocks);
@@ -56,24 +58,18 @@ static void processEntry (Array targets, MrfEntry *currEntry, char *prefix)
   arraySort (targetNames,(ARRAYORDERF)arrayStrcmp);
   arrayUniq (targetNames,NULL,(ARRAYORDERF)arrayStrcmp);
   for (i = 0; i < arrayMax (targetNames); i++) {
-    testEntry.targetName = hlr_strdup (textItem (targetNames,i));
-    testEntry.fp = NULL;
-    if (arrayFindInsert (targets,&testEntry,&index,(ARRAYORDERF)sortTargets) == 1) {
-      // new target inserted
-      currTarget = arrp (targets,index,Target);
+    if (!(currTarget = hashTable_getString (targetsByName,textItem (targetNames,i)))) {
+      // new target
+      AllocVar (currTarget);
+      currTarget->targetName = hlr_strdup (textItem (targetNames,i));
       stringCreateClear (buffer,100);
       stringPrintf (buffer,"%s_%s.mrf",prefix,textItem (targetNames,i));
-      if (!(currTarget->fp = fopen (string (buffer),"w"))) {
-        die ("Unable to open file: %s",string (buffer));
-      }
-      fprintf (currTarget->fp,"%s\n",mrf_writeHeader ());
+      currTarget->stream = outStream_create (string (buffer));
+      outStream_puts (currTarget->stream,mrf_writeHeader ());
+      hashTable_putString (targetsByName,currTarget->targetName,currTarget);
+      array (targets,arrayMax (targets),Target*) = currTarget;
     }
-    else {
-      // target is already present      
-      hlr_free (testEntry.targetName);
-    }
-    currTarget = arrp (targets,index,Target);
-    fprintf (currTarget->fp,"%s\n",mrf_writeEntry (currEntry));
+    outStream_puts (currTarget->stream,mrf_writeEntry (currEntry));
   }
 }
 
@@ -84,20 +80,23 @@ int main (int argc, char *argv[])
   MrfEntry *currMRF;
   Target *currTarget;
   Array targets;
+  HashTable targetsByName;
   int i;
 
   if (argc != 2) {
     usage ("%s <prefix>",argv[0]);
   }
-  targets = arrayCreate (100,Target);
+  targets = arrayCreate (100,Target*);
+  targetsByName = hashTable_create (HASH_TABLE_STRING_KEYS,100);
   mrf_init ("-");
   while (currMRF = mrf_nextEntry ()) {
-    processEntry (targets,currMRF,argv[1]);
+    processEntry (targets,targetsByName,currMRF,argv[1]);
   }
   mrf_deInit ();
+  arraySort (targets,(ARRAYORDERF)sortTargetPointers);
   for (i = 0; i < arrayMax (targets); i++) {
-    currTarget = arrp (targets,i,Target);
-    fclose (currTarget->fp);
+    currTarget = arru (targets,i,Target*);
+    outStream_destroy (currTarget->stream);
     warn ("Closed file for target: %s",currTarget->targetName);
   }
   return 0;
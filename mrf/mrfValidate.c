@@ -20,7 +20,7 @@ int processBlock ( MrfBlock* currBlock, MrfBlock* prevBlock, int gaps ) {
     errorCode += 4;
 
   if( prevBlock != NULL ) {
-    if( !strEqual( prevBlock->targetName, currBlock->targetName) )
+    if( prevBlock->targetId != currBlock->targetId )
       errorCode += 8;
     if( prevBlock->strand != currBlock->strand )
       errorCode += 16;
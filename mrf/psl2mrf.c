@@ -16,10 +16,13 @@ int main (int argc, char *argv[])
 {
   BlatQuery *currQuery;
   PslEntry *currEntry;
+  Arena arena;
   int i,j,k;
   
   printf ("%s\n",MRF_COLUMN_NAME_BLOCKS);
   blatParser_initFromFile ("-");
+  arena = arena_create (0,0);
+  blatParser_setArena (arena);
   while (currQuery = blatParser_nextQuery ()) {
     for (i = 0; i < arrayMax (currQuery->entries); i++) {
       currEntry = arrp (currQuery->entries,i,PslEntry);
@@ -59,6 +62,7 @@ int main (int argc, char *argv[])
     puts ("");
   } 
   blatParser_deInit ();
+  arena_destroy (arena);
   return 0;
 }
 
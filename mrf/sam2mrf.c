@@ -4,6 +4,7 @@
 #include "mrf.h"
 #include "sam.h"
 #include "common.h"
+#include "outStream.h"
 #include <stdlib.h>
 #include <string.h>
 #include "seq.h"
@@ -20,15 +21,19 @@
 
 
 
+static OutStream out = NULL;
+
+
+
 static void printMrfAlignBlocks (SamEntry *e, int _strand)
 {
   char strand = '.';
   int len, intronic;
   int q, pos;
-  int i;
-  Texta tokens;
+  FieldCursor ops;
+  Field lenField, intronicField;
 
-  tokens = textFieldtokP (e->cigar, "MN");
+  fieldCursorInit (&ops, e->cigar, "MN");
 
   if (_strand == R_FIRST) {
     if (e->flags & S_QUERY_STRAND)
@@ -43,46 +48,52 @@ static void printMrfAlignBlocks (SamEntry *e, int _strand)
   }
 
   // Process first item in cigar
-  len = atoi (textItem (tokens, 0));
+  fieldNext (&ops, &lenField);
+  len = parseInt (lenField);
   pos = e->pos;
   q   = 1;
-  printf ("%s:%c:%d:%d:%d:%d",
+  outStream_printf (out,"%s:%c:%d:%d:%d:%d",
           e->rname, strand, e->pos, pos + len - 1, 1, len);
   pos += len - 1;
   q += len;
 
   // Process rest of cigar
-  if (arrayMax (tokens) > 2) {
-    for (i = 2; i < arrayMax (tokens) - 1; i += 2) {
-      len = atoi (textItem (tokens, i));
-      intronic = atoi (textItem (tokens, i - 1));
-      pos += intronic + 1;
-      printf(",%s:%c:%d:%d:%d:%d",
-             e->rname, strand, pos, pos + len - 1, q, q + len - 1);
-      pos += len - 1;
-      q += len;
-    }
+  // pairs of N and M lengths; the empty field after the final 'M' is not a pair
+  while (fieldNext (&ops, &intronicField) && fieldNext (&ops, &lenField) && ops.pos != NULL) {
+    len = parseInt (lenField);
+    intronic = parseInt (intronicField);
+    pos += intronic + 1;
+    outStream_printf (out,",%s:%c:%d:%d:%d:%d",
+           e->rname, strand, pos, pos + len - 1, q, q + len - 1);
+    pos += len - 1;
+    q += len;
   }
-
-  textDestroy (tokens);
 }
 
 
 
-int generateSamEntry ( Texta tokens, SamEntry *currSamE, 
+int generateSamEntry ( char *line, SamEntry *currSamE, 
 		       int* hasSeqs, 
 		       int* hasQual)
 {
-  int j;
-  currSamE->qname = strdup (textItem (tokens, 0));
-  currSamE->flags = atoi (textItem (tokens, 1));
-  currSamE->rname = strdup (textItem (tokens, 2));
-  currSamE->pos   = atoi (textItem (tokens, 3));
-  currSamE->mapq  = atoi (textItem (tokens, 4));
-  currSamE->cigar = strdup (textItem (tokens, 5));
-  currSamE->mrnm  = strdup (textItem (tokens, 6));
-  currSamE->mpos  = atoi (textItem (tokens, 7));
-  currSamE->isize = atoi (textItem (tokens, 8));
+  FieldCursor columns;
+  Field fields[11];
+  int numFields = 0;
+
+  fieldCursorInit (&columns, line, "\t");
+  while (numFields < 11 && fieldNext (&columns, &fields[numFields]))
+    numFields++;
+  if (numFields < 11)
+    die ("Invalid SAM entry: %s", line);
+  currSamE->qname = fieldDup (fields[0]);
+  currSamE->flags = parseInt (fields[1]);
+  currSamE->rname = fieldDup (fields[2]);
+  currSamE->pos   = parseInt (fields[3]);
+  currSamE->mapq  = parseInt (fields[4]);
+  currSamE->cigar = fieldDup (fields[5]);
+  currSamE->mrnm  = fieldDup (fields[6]);
+  currSamE->mpos  = parseInt (fields[7]);
+  currSamE->isize = parseInt (fields[8]);
   currSamE->seq   = NULL;
   currSamE->qual  = NULL;
   currSamE->tags  = NULL;
@@ -93,25 +104,17 @@ int generateSamEntry ( Texta tokens, SamEntry *currSamE,
       currSamE->flags & S_FAILS_CHECKS)
     return 0;
   
-  // Get tokens
-  if (arrayMax (tokens) > 11) {
-    Stringa tags = stringCreate (10);
-    for (j = 11; j < arrayMax (tokens); j++) {
-      if (j > 11)
-	stringAppendf (tags, "\t");
-      stringAppendf (tags, "%s", textItem (tokens, j));
-    }
-    currSamE->tags = strdup (string(tags));
-    stringDestroy (tags);
-  }
+  // Get tags: the rest of the line
+  if (columns.pos != NULL)
+    currSamE->tags = hlr_strdup (columns.pos);
   
-  if (strcmp (textItem (tokens, 9),  "*") != 0) {
+  if (!fieldEqual (fields[9], "*")) {
     *hasSeqs = 1;
-    currSamE->seq = strdup (textItem (tokens, 9));
+    currSamE->seq = fieldDup (fields[9]);
   }
-  if (strcmp (textItem (tokens, 10), "*") != 0) {
+  if (!fieldEqual (fields[10], "*")) {
     *hasQual = 1;
-    currSamE->qual = strdup (textItem (tokens, 10));
+    currSamE->qual = fieldDup (fields[10]);
   }
   return 1;
 }
@@ -119,16 +122,13 @@ int generateSamEntry ( Texta tokens, SamEntry *currSamE,
 
 
 void destroySamEntry ( SamEntry* currSamE ) {
-  free (currSamE->qname);
-  free (currSamE->rname);
-  free (currSamE->cigar);
-  free (currSamE->mrnm);
-  if (currSamE->seq)
-      free (currSamE->seq);
-  if (currSamE->qual)
-    free (currSamE->qual);
-  if (currSamE->tags)
-    free (currSamE->tags);
+  hlr_free (currSamE->qname);
+  hlr_free (currSamE->rname);
+  hlr_free (currSamE->cigar);
+  hlr_free (currSamE->mrnm);
+  hlr_free (currSamE->seq);
+  hlr_free (currSamE->qual);
+  hlr_free (currSamE->tags);
 }
 
 int isPaired( SamEntry* samE )
@@ -142,7 +142,6 @@ int isPaired( SamEntry* samE )
 int main (int argc, char **argv)
 {
   LineStream ls;
-  Texta tokens = NULL;
   char *line;
 
   int hasQual = 0;
@@ -150,25 +149,19 @@ int main (int argc, char **argv)
   int start=1;
  
   ls = ls_createFromFile ("-");
+  out = outStream_create ("-");
   while (line = ls_nextLine (ls)) {
     // Put all the lines of the SAM header in comments
     if (line[0] == '@') {
-      printf ("# %s\n", line);
+      outStream_printf (out,"# %s\n", line);
       continue;
     }
-    // Parse each SAM entry and store into array   
-    tokens = textFieldtokP (line, "\t");
-    if (arrayMax (tokens) < 11) {
-      textDestroy( tokens );
-      ls_destroy (ls);
-      die ("Invalid SAM entry: %s", line);
-    }
+    // Parse each SAM entry
     SamEntry *currSamE = NULL;
     SamEntry *mateSamE = NULL;
     AllocVar(currSamE ); 
 
-    int ret = generateSamEntry( tokens, currSamE, &hasSeqs, &hasQual );
-    textDestroy( tokens );
+    int ret = generateSamEntry( line, currSamE, &hasSeqs, &hasQual );
     if ( ret==0 ) {
       if ( isPaired ( currSamE ) )
 	ls_nextLine( ls ); // discarding next entry too (the mate)
@@ -179,10 +172,7 @@ int main (int argc, char **argv)
     if ( isPaired( currSamE ) )   {
       int hasQual2, hasSeq2;
       AllocVar( mateSamE );
-      Texta secondEnd = NULL;
-      secondEnd = textFieldtok (ls_nextLine( ls ) , "\t");
-      ret = generateSamEntry( secondEnd, mateSamE, &hasSeq2, &hasQual2 );
-      textDestroy( secondEnd );
+      ret = generateSamEntry( ls_nextLine( ls ), mateSamE, &hasSeq2, &hasQual2 );
       if( ret == 0 ) {
 	destroySamEntry( currSamE );
 	destroySamEntry( mateSamE );
@@ -197,17 +187,17 @@ int main (int argc, char **argv)
 
     // Print MRF headers
     if( start ) {
-      printf ("%s", MRF_COLUMN_NAME_BLOCKS);
-      if (hasSeqs) printf("\t%s", MRF_COLUMN_NAME_SEQUENCE);
-      if (hasQual) printf("\t%s", MRF_COLUMN_NAME_QUALITY_SCORES);
-      printf ("\t%s\n", MRF_COLUMN_NAME_QUERY_ID);
+      outStream_printf (out,"%s", MRF_COLUMN_NAME_BLOCKS);
+      if (hasSeqs) outStream_printf (out,"\t%s", MRF_COLUMN_NAME_SEQUENCE);
+      if (hasQual) outStream_printf (out,"\t%s", MRF_COLUMN_NAME_QUALITY_SCORES);
+      outStream_printf (out,"\t%s\n", MRF_COLUMN_NAME_QUERY_ID);
       start=0;
     }
     
     // Print AlignmentBlocks   
     printMrfAlignBlocks (currSamE, R_FIRST);
     if( isPaired ( currSamE ) ) {  
-      printf ("|");
+      outStream_printf (out,"|");
       printMrfAlignBlocks (mateSamE, R_SECOND);
     }
 
@@ -218,45 +208,46 @@ int main (int argc, char **argv)
         die ("Entry missing sequence column\n");
       if( currSamE->flags & S_QUERY_STRAND )
 	seq_reverseComplement( currSamE->seq, strlen(currSamE->seq));
-      printf ("\t%s", currSamE->seq);
+      outStream_printf (out,"\t%s", currSamE->seq);
       if (mateSamE) {
         if (!mateSamE->seq)
           die ("Entry missing sequence column\n");
         if( mateSamE->flags & S_MATE_STRAND )
 	  seq_reverseComplement( mateSamE->seq, strlen(mateSamE->seq));
-	printf ("|%s", mateSamE->seq);
+	outStream_printf (out,"|%s", mateSamE->seq);
       }
     }
     // Print quality scores
     if (hasQual) {
       if (!currSamE->qual)
         die ("Entry missing quality scores column\n");
-      printf ("\t%s", currSamE->qual);
+      outStream_printf (out,"\t%s", currSamE->qual);
       if (mateSamE) {
         if (!mateSamE->qual)
           die ("Entry missing quality scores column\n");
-        printf ("|%s", mateSamE->qual);
+        outStream_printf (out,"|%s", mateSamE->qual);
       }
     }
 
     // Print queryID
 
     if (mateSamE) {
-      printf ("\t%s|%s", currSamE->qname,"2"); // No need to print out both IDs, but need the pipe symbol for consistency
+      outStream_printf (out,"\t%s|%s", currSamE->qname,"2"); // No need to print out both IDs, but need the pipe symbol for consistency
     }
     else {
-      printf ("\t%s", currSamE->qname);
+      outStream_printf (out,"\t%s", currSamE->qname);
     }
-    printf("\n");
+    outStream_printf (out,"\n");
     
     destroySamEntry( currSamE );
     freeMem( currSamE ); 
-    if( isPaired( currSamE ) ) {
+    if( mateSamE ) {
       destroySamEntry ( mateSamE );
       freeMem( mateSamE );
     }
   }
   // clean up
+  outStream_destroy (out);
   ls_destroy (ls);
   return EXIT_SUCCESS;
 }
@@ -12,12 +12,25 @@
 
 
 
-static void freeMemory (char *read, char *quality, char *chromosome, char *partnerChromosome) 
+static Field nextField (FieldCursor *fields) 
 {
-  hlr_free (read);
-  hlr_free (quality);
-  hlr_free (chromosome);
-  hlr_free (partnerChromosome);
+  Field field;
+
+  if (!fieldNext (fields,&field)) {
+    die ("Missing field in ELAND export line");
+  }
+  return field;
+}
+
+
+
+static char* nextColumn (FieldCursor *fields) 
+{
+  Field field;
+
+  field = nextField (fields);
+  field.s[field.len] = '\0';
+  return field.s;
 }
 
 
@@ -40,18 +53,13 @@ int main (int argc, char *argv[])
 {
   LineStream ls;
   char *line;
-  WordIter w;
+  FieldCursor columns,parts;
   char *read;
-  char *quality;
   int readLength;
   int position;
-  int offset;
-  char *chromosome = NULL;
-  char *partnerChromosome = NULL;
+  char *chromosome;
   char strand;
   char *contig;
-  char *partnerContig;
-  char partnerStrand;
   char filter;
   char *pos;
   Stringa id;
@@ -66,34 +74,33 @@ int main (int argc, char *argv[])
   ls = ls_createFromFile ("-");
   while (line = ls_nextLine (ls)) {
     stringClear (id);
-    w = wordIterCreate (line,"\t",0);
-    stringAppendf (id,"%s_",wordNext (w)); // 1 machine
-    wordNext (w); // 2 run number
-    stringAppendf (id,"%s_",wordNext (w)); // 3 lane
-    stringAppendf (id,"%s_",wordNext (w)); // 4 tile
-    stringAppendf (id,"%s_",wordNext (w)); // 5 x coordinate of cluster
-    stringAppendf (id,"%s_",wordNext (w)); // 6 y coordinate of cluster
-    stringAppendf (id,"%s",wordNext (w)); // 7 index string
-    wordNext (w); // 8 read number
-    read = hlr_strdup (wordNext (w)); // 9 read
+    // the strings point into the line, which is not copied
+    fieldCursorInit (&columns,line,"\t");
+    stringAppendf (id,"%s_",nextColumn (&columns)); // 1 machine
+    nextField (&columns); // 2 run number
+    stringAppendf (id,"%s_",nextColumn (&columns)); // 3 lane
+    stringAppendf (id,"%s_",nextColumn (&columns)); // 4 tile
+    stringAppendf (id,"%s_",nextColumn (&columns)); // 5 x coordinate of cluster
+    stringAppendf (id,"%s_",nextColumn (&columns)); // 6 y coordinate of cluster
+    stringAppendf (id,"%s",nextColumn (&columns)); // 7 index string
+    nextField (&columns); // 8 read number
+    read = nextColumn (&columns); // 9 read
     readLength = strlen (read); 
-    quality = hlr_strdup (wordNext (w)); // 10 quality
-    chromosome = hlr_strdup (wordNext (w)); // 11 match chromosome
-    contig = wordNext (w); // 12 match contig, true if splice junction
-    position = atoi (wordNext (w)); // 13 match position
-    strand = wordNext (w)[0]; // 14 match strand
-    wordNext (w); // 15 match descriptor
-    wordNext (w); // 16 single read alignment score
-    wordNext (w); // 17 paired end alignment score
-    partnerChromosome = hlr_strdup (wordNext (w)); // 18 partner chromosome
-    partnerContig = wordNext (w); // 19 partner contig
-    offset = atoi (wordNext (w)); // 20 partner offset
-    partnerStrand = wordNext (w)[0]; // 21 partner strand
-    filter = wordNext (w)[0]; // 22 filter
-    wordIterDestroy (w);
+    nextField (&columns); // 10 quality
+    chromosome = nextColumn (&columns); // 11 match chromosome
+    contig = nextColumn (&columns); // 12 match contig, true if splice junction
+    position = parseInt (nextField (&columns)); // 13 match position
+    strand = nextField (&columns).s[0]; // 14 match strand
+    nextField (&columns); // 15 match descriptor
+    nextField (&columns); // 16 single read alignment score
+    nextField (&columns); // 17 paired end alignment score
+    nextField (&columns); // 18 partner chromosome
+    nextField (&columns); // 19 partner contig
+    nextField (&columns); // 20 partner offset
+    nextField (&columns); // 21 partner strand
+    filter = nextField (&columns).s[0]; // 22 filter
     // only accept reads that pass quality filtering
     if(filter != 'Y') {
-      freeMemory (read,quality,chromosome,partnerChromosome); 
       continue;
     }
     // skip reads with NM, QC, RM, multi-hits 
@@ -101,11 +108,9 @@ int main (int argc, char *argv[])
         strEqual (chromosome,"QC") || 
         strEqual (chromosome,"RM") || 
         strchr (chromosome,':')) {
-      freeMemory (read,quality,chromosome,partnerChromosome); 
       continue;
     }    
     if (position < 0) {
-      freeMemory (read,quality,chromosome,partnerChromosome); 
       continue;
     }
     if (strStartsWith (chromosome,"chr")) {
@@ -114,12 +119,11 @@ int main (int argc, char *argv[])
       printf ("%s:%c:%d:%d:1:%d\n",chromosome,convertStrand (strand),position,position + readLength - 1,readLength);
     } 
     else if (strstr (chromosome,"splice") != NULL) {
-      w = wordIterCreate (contig,"|",0);
-      strReplace (&chromosome,wordNext (w));
-      startFirstExon = atoi (wordNext (w));
-      startSecondExon = atoi (wordNext (w));
-      sizeExonOverlap = atoi (wordNext (w));
-      wordIterDestroy (w);
+      fieldCursorInit (&parts,contig,"|");
+      chromosome = nextColumn (&parts);
+      startFirstExon = parseInt (nextField (&parts));
+      startSecondExon = parseInt (nextField (&parts));
+      sizeExonOverlap = parseInt (nextField (&parts));
       numNucleotidesFirstExon = sizeExonOverlap - position + 1;
       numNucleotidesSecondExon = readLength - numNucleotidesFirstExon;
       printf ("%s:%c:%d:%d:%d:%d",
@@ -144,7 +148,6 @@ int main (int argc, char *argv[])
     else {
       die ("Unexpected case: %s, %s",chromosome,contig);
     }
-    freeMemory (read,quality,chromosome,partnerChromosome); 
   }
   ls_destroy (ls);
   stringDestroy (id);